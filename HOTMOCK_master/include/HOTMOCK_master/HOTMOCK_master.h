@@ -13,8 +13,15 @@
 #ifndef HOTMOCK_MASTER_H
 #define HOTMOCK_MASTER_H
 #include "hotmockclient.h"
+#include "hotmockclientmanager.h"
 #include "hotmocksetting.h"
 
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
 #include <rtm/Manager.h>
 #include <rtm/DataFlowComponentBase.h>
 #include <rtm/CorbaPort.h>
@@ -23,6 +30,8 @@
 #include <rtm/idl/BasicDataTypeSkel.h>
 #include <rtm/idl/ExtendedDataTypesSkel.h>
 #include <rtm/idl/InterfaceDataTypesSkel.h>
+#include <rtm/ExtTrigExecutionContext.h>
+#include <rtm/ConnectorListener.h>
 #include "dynamic_port.hpp"
 #include "VectorConvert.h"
 
@@ -38,6 +47,255 @@
 
 using namespace RTC;
 
+/*!
+ * @class PublishFilter
+ * @brief AI,PI,TS,GSの値をOutPortに出力するかを判定する条件
+ *
+ * Configuration(PublishDeadband等)から作成し、データの種類ごとに1つ
+ * 使用する。
+ */
+class PublishFilter
+{
+ public:
+  PublishFilter() : deadband(-1.0), relative(0.0), min_interval_ns(0), max_interval_ns(0) {}
+
+  double deadband; /*!< 絶対不感帯(負ならば不感帯による抑制を行わない) */
+  double relative; /*!< 相対不感帯(前回出力した値の大きさに対する比) */
+  unsigned long long min_interval_ns; /*!< 出力する最小の間隔[ns](0ならば制限しない) */
+  unsigned long long max_interval_ns; /*!< 不感帯内でも出力する間隔[ns](0ならば出力しない) */
+};
+
+/*!
+ * @class PublishState
+ * @brief 1つのポートに最後に出力した値と時刻(PublishFilterの判定に使用する)
+ */
+class PublishState
+{
+ public:
+  PublishState() : valid(false), time_ns(0) {value[0] = value[1] = value[2] = 0.0;}
+
+  bool valid; /*!< 値を出力したことがある場合true */
+  unsigned long long time_ns; /*!< 最後に出力した値の受信時刻[ns] */
+  double value[3]; /*!< 最後に出力した値(GSはx,y,z) */
+};
+
+/*!
+ * @enum HotmockChannelKind
+ * @brief .hmstファイルの設定から構成するチャンネル(コネクタとそのポート)の種類
+ */
+enum HotmockChannelKind{
+  CH_DO, /*!< DO(InPort:DO) */
+  CH_AO, /*!< AO(InPort:AO) */
+  CH_PI, /*!< PI(InPort:Reset_PI, OutPort:PI) */
+  CH_DI, /*!< DI(OutPort:DI) */
+  CH_AI, /*!< AI(OutPort:AI) */
+  channel_kind_num
+};
+
+/*!
+ * @class HotmockChannel
+ * @brief 使用している1つのチャンネル
+ *
+ * HotmockBoard::channelListに種類の順に並べて保持する。
+ */
+class HotmockChannel
+{
+ public:
+  HotmockChannel(HotmockChannelKind kind, unsigned short connectID, unsigned short portNo)
+    : kind(kind), connectID(connectID), portNo(portNo) {}
+
+  HotmockChannelKind kind;
+  unsigned short connectID; /*!< ソケット通信用のID(HOTMOCKSettingの表示) */
+  unsigned short portNo; /*!< ポート名の番号(デバイス本体の表示) ex) 3ならばポート名はDI3 */
+  PublishState publish; /*!< 最後に出力した値(AI,PIのみ使用) */
+};
+
+/*!
+ * @class HotmockBoard
+ * @brief HOTMOCK_masterが使用する1台のHOTMOCKデバイス(ボード)
+ *
+ * ボードごとの設定ファイル、データポートと使用中のコネクタの一覧を
+ * 保持する。ソケット通信と受信データはHotmockClientManagerのboard
+ * 番目のクライアントが保持する。
+ */
+class HotmockBoard
+{
+ public:
+  /*!
+   * @brief constructor
+   * @param prefix ポート名の接頭辞(1台目は"")
+   */
+  HotmockBoard(const std::string &prefix);
+
+  /*!
+   * @brief destructor
+   */
+  ~HotmockBoard();
+
+  std::string prefix; /*!< ポート名の接頭辞 */
+  int board; /*!< HotmockClientManagerのボード番号 */
+  hotmock::HotmockSetting hmst;
+  unsigned long long planHash; /*!< ポートを構成した.hmstファイルのハッシュ値(0ならば未構成) */
+
+  /*!
+   * HOTMOCKデバイスのDO*に送信するデジタル出力値を取得するポート。
+   * - Type: TimedShort
+   */
+  DynamicInPort<TimedShort> m_DOIn;
+  /*!
+   * HOTMOCKデバイスのAO*に送信するアナログ出力値を取得するポート。
+   * - Type: TimedDouble
+   */
+  DynamicInPort<TimedDouble> m_AOIn;
+  /*!
+   * HOTMOCKデバイスのPI*につながっているパルス入力の積算値をリセ
+   * ットするためのフラグを取得するポート。
+   * - Type: TimedBoolean
+   */
+  DynamicInPort<TimedBoolean> m_Reset_PIIn;
+  /*!
+   * HOTMOCKデバイスのDI*から受信したデジタル入力値を送るポート。
+   * - Type: TimedShort
+   */
+  DynamicOutPort<TimedShort> m_DIOut;
+  /*!
+   * HOTMOCKデバイスのAI*から受信したアナログ入力値を送るポート。
+   * - Type: TimedDouble
+   */
+  DynamicOutPort<TimedDouble> m_AIOut;
+  /*!
+   * HOTMOCKデバイスのPI*から受信したパルス入力値を送るポート。
+   * - Type: TimedDouble
+   */
+  DynamicOutPort<TimedDouble> m_PIOut;
+
+  RTC::TimedDouble m_TS;
+  /*!
+   * HOTMOCKデバイス内蔵の温度センサから受信した値を送るポート。
+   * - Type: TimedDouble
+   */
+  OutPort<RTC::TimedDouble> m_TSOut;
+
+  RTC::TimedDoubleSeq m_GS;
+  /*!
+   * HOTMOCKデバイス内蔵の加速度センサから受信した値を送るポート。
+   * 値は要素数0から順にx,y,zの配列として送られる。
+   * - Type: TimedDoubleSeq
+   */
+  OutPort<RTC::TimedDoubleSeq> m_GSOut;
+
+  RTC::TimedBoolean m_Stale;
+  /*!
+   * HOTMOCKSettingとの接続が切れている(再接続中)ためデータが更新され
+   * ない間はtrueを送るポート。接続状態が変化したときに送られる。
+   * - Type: TimedBoolean
+   */
+  OutPort<RTC::TimedBoolean> m_StaleOut;
+
+  RTC::TimedShortSeq m_DIAll;
+  /*!
+   * 使用しているすべてのDIの値をまとめて送るポート。
+   * 要素iはchannels(CH_DI)[i]のDIの値。
+   * - Type: TimedShortSeq
+   */
+  OutPort<RTC::TimedShortSeq> m_DIAllOut;
+
+  RTC::TimedDoubleSeq m_AIAll;
+  /*!
+   * 使用しているすべてのAIの値をまとめて送るポート。
+   * 要素iはchannels(CH_AI)[i]のAIの値。
+   * - Type: TimedDoubleSeq
+   */
+  OutPort<RTC::TimedDoubleSeq> m_AIAllOut;
+
+  RTC::TimedDoubleSeq m_PIAll;
+  /*!
+   * 使用しているすべてのPIの値をまとめて送るポート。
+   * 要素iはchannels(CH_PI)[i]のPIの値。
+   * - Type: TimedDoubleSeq
+   */
+  OutPort<RTC::TimedDoubleSeq> m_PIAllOut;
+
+  bool aggregate; /*!< DIAll,AIAll,PIAllポートをRTCへ登録している場合true */
+
+  /*!
+   * AI*から前の周期以降に受信したすべての値を送るポート。
+   * 配列は受信した順に[受信時刻,値]の組を並べたもの。
+   * 受信時刻はtm(最新の値の受信時刻)からの差[s](0以下)。
+   * - Type: TimedDoubleSeq
+   */
+  DynamicOutPort<TimedDoubleSeq> m_AIBatchOut;
+  /*!
+   * PI*から前の周期以降に受信したすべての値を送るポート。
+   * 配列の形式はAIBatchと同じ。
+   * - Type: TimedDoubleSeq
+   */
+  DynamicOutPort<TimedDoubleSeq> m_PIBatchOut;
+
+  RTC::TimedDoubleSeq m_GSBatch;
+  /*!
+   * GSから前の周期以降に受信したすべての値を送るポート。
+   * 配列は受信した順に[受信時刻,x,y,z]の組を並べたもの。
+   * - Type: TimedDoubleSeq
+   */
+  OutPort<RTC::TimedDoubleSeq> m_GSBatchOut;
+
+  bool batch; /*!< AIBatch*,PIBatch*,GSBatchポートをRTCへ登録している場合true */
+  std::vector<unsigned short> batchPortList_AI; /*!< RTCへ登録しているAIBatchポートの番号 */
+  std::vector<unsigned short> batchPortList_PI; /*!< RTCへ登録しているPIBatchポートの番号 */
+
+  RTC::TimedULongSeq m_PublishCount;
+  /*!
+   * AI,PI,TS,GSの値を出力した数と出力を抑制した数を送るポート。
+   * 配列は[AIの出力数,AIの抑制数,PIの出力数,PIの抑制数,TS…,GS…]。
+   * 値はアクティブ化してからの累計で、変化したとき最大1秒に1回送られる。
+   * - Type: TimedULongSeq
+   */
+  OutPort<RTC::TimedULongSeq> m_PublishCountOut;
+
+  PublishState publishState_TS; /*!< TSに最後に出力した値 */
+  PublishState publishState_GS; /*!< GSに最後に出力した値 */
+  unsigned long publishedCount[4]; /*!< AI,PI,TS,GSの値を出力した数 */
+  unsigned long suppressedCount[4]; /*!< AI,PI,TS,GSの値の出力を抑制した数 */
+  bool publishCountChanged; /*!< PublishCountを前回送ってから数が変化した場合true */
+  unsigned long long publishCountTime_ns; /*!< PublishCountを前回送った時刻[ns] */
+
+  std::vector<HotmockChannel> channelList; /*!< 使用しているチャンネル(種類の順、種類内はIDの順) */
+  unsigned int channelBegin[channel_kind_num+1]; /*!< channelList内の種類ごとの開始位置 */
+
+  /*!
+   * @brief 使用している種類kindのチャンネルの先頭を取得する
+   * @return channelNum(kind)個のチャンネルの配列
+   */
+  HotmockChannel *channels(HotmockChannelKind kind) {return channelList.empty() ? NULL : &channelList[0] + channelBegin[kind];}
+  /*!
+   * @brief 使用している種類kindのチャンネルの数を取得する
+   */
+  unsigned int channelNum(HotmockChannelKind kind) const {return channelBegin[kind+1] - channelBegin[kind];}
+};
+
+/*!
+ * @class HotmockInputListener
+ * @brief DO,Reset_PI等のInPortにデータが届いたことを通知するリスナ
+ *
+ * DataTriggerが1の場合、HotmockClientManager::waitEvent()で待ってい
+ * るスレッドを起こし、onExecuteを実行させる。
+ */
+class HotmockInputListener
+  : public RTC::ConnectorDataListener
+{
+ public:
+  HotmockInputListener(hotmock::HotmockClientManager &manager) : m_manager(manager) {}
+  virtual ~HotmockInputListener() {}
+  virtual void operator()(const RTC::ConnectorInfo& info, const cdrMemoryStream& data)
+  {
+    m_manager.notifyEvent();
+  }
+
+ private:
+  hotmock::HotmockClientManager &m_manager;
+};
+
 /*!
  * @class HOTMOCK_master
  * @brief Connect HOTMOCK devices with RTC
@@ -45,6 +303,9 @@ using namespace RTC;
  * HOTMOCKSettingとソケット通信を行い、HOTMOCKデバイスを使用するた
  * めのコンポーネント。
  * 初期化時にデバイス設定ファイルを読み込み、ポートが生成される。
+ * 複数のHOTMOCKデバイス(ボード)を1つのコンポーネントで使用できる。
+ * 2台目以降のボードのポート名には接頭辞"B<ボード番号>_"が付く。
+ * 　　ex) 2台目のボードのDI1 ---> ポート名:B2_DI1
  *
  * InPort:<name>/<datatype>/<documentation>
  * DO/TimedShort/
@@ -65,15 +326,90 @@ using namespace RTC;
  * るポート。
  * GS/TimedDoubleSeq/HOTMOCKデバイス内蔵の加速度センサから受信した
  * 値を送るポート。値は要素数0から順にx,y,zの配列として送られる。
+ * Stale/TimedBoolean/HOTMOCKSettingとの接続が切れている(再接続中)
+ * ためデータが更新されない間はtrueを送るポート。
+ * PublishCount/TimedULongSeq/AI,PI,TS,GSの値を出力した数と不感帯等に
+ * より出力を抑制した数を送るポート。配列は[AIの出力数,AIの抑制数,PI
+ * の出力数,PIの抑制数,TS…,GS…]。
+ * DIAll/TimedShortSeq/使用しているすべてのDIの値を配列として送るポ
+ * ート(AggregatePortsが1の場合)。要素の順序はポート番号の順。
+ * AIAll/TimedDoubleSeq/使用しているすべてのAIの値を配列として送るポ
+ * ート(AggregatePortsが1の場合)。
+ * PIAll/TimedDoubleSeq/使用しているすべてのPIの値を配列として送るポ
+ * ート(AggregatePortsが1の場合)。
+ * AIBatch/TimedDoubleSeq/AI*から前の周期以降に受信したすべての値を
+ * 送るポート(BatchPublishが1の場合)。配列は受信した順に[受信時刻,
+ * 値]の組を並べたもの。受信時刻はtm(最新の値の受信時刻)からの差[s]。
+ * PIBatch/TimedDoubleSeq/PI*から受信したすべての値を送るポート。配列
+ * の形式はAIBatchと同じ。
+ * GSBatch/TimedDoubleSeq/GSから受信したすべての値を送るポート。配列
+ * は[受信時刻,x,y,z]の組を並べたもの。
  * Configuration:<name>/<datatype>/<default>
  * /<widget>/<documentation>
  * SettingFilename/string/*.hmst/text/HOTMOCKSettingによって作成さ
- * れたHOTMOCKデバイスの設定ファイル名。
- * IPAddress/string/127.0.0.1/text/HOTMOCKSettingのIPアドレス。
- * PortNumber/int/8888/text/HOTMOCKSettingのPort番号。
+ * れたHOTMOCKデバイスの設定ファイル名。複数のボードを使用する場合は
+ * ボードごとの設定ファイル名をカンマ区切りで指定する。
+ * IPAddress/string/127.0.0.1/text/HOTMOCKSettingのIPアドレス。ボード
+ * ごとにカンマ区切りで指定する。指定が足りない場合は最後の値を使用する。
+ * PortNumber/std::vector<int>/8888/text/HOTMOCKSettingのPort番号。ボ
+ * ードごとにカンマ区切りで指定する。指定が足りない場合は最後の値を使用
+ * する。
  * GetDataType/std::vector<int>/0,0,0,0/ordered_list/HOTMOCKデバイ
  * スからの入力を取得する際、0ならば生値を取得、1ならば工業変換値を
  * 取得する。配列0から順にAI,PI, TS,GSの設定をする。
+ * RecvBufferSize/int/65536/text/HOTMOCKSettingから受信したデータを
+ * 読み込む受信バッファのサイズ[byte]。1周期で受信できる最大量となる。
+ * IOThread/int/0/radio/1ならば専用のI/Oスレッドでソケット通信と受信デ
+ * ータの解析を行い、onExecuteはロックフリーキューの読み出しとポートへ
+ * の書き込みのみを行う。0ならばonExecute内で通信する。
+ * RequestWindow/int/1/text/1つのコネクタに対して応答を待たずに送
+ * 信できるREQUESTの最大数。1ならば応答が届くまで次の要求を送らない。
+ * RequestTimeout/int/500/text/REQUESTの応答を待つ時間[ms]。時間内に
+ * 応答が無ければ待ち時間を2倍にして再送する。0ならばタイムアウトしない。
+ * RequestMaxRetry/int/3/text/応答の無いREQUESTを再送する最大回数。
+ * 超えた場合はその要求を破棄して次の要求を送る。
+ * LogLevel/string/INFO/radio/ログの出力レベル。DEBUGならば入出力した値を
+ * すべて出力する。ログは別スレッドで出力されるため、onExecuteの周期
+ * には影響しない。
+ * DataTrigger/int/0/radio/1ならばHOTMOCKSettingからデータを受信したとき、またはDO,
+ * Reset_PIに入力があったときにonExecuteを実行する。実行コンテキストに
+ * ExtTrigExecutionContextを使用すること。1の場合はIOThreadも1となる。
+ * TriggerMinInterval/int/1000/text/DataTriggerが1の場合にonExecuteを実行する
+ * 最小間隔[us]。データが連続して届いてもこれより短い間隔では実行しない。
+ * TriggerMaxInterval/int/100/text/DataTriggerが1の場合にonExecuteを実行する
+ * 最大間隔[ms]。データが届かなくてもこの間隔で実行し、AI等の要求を送信する。
+ * AggregatePorts/int/0/radio/1ならばボードのすべてのDI,AI,PIの値をまとめて
+ * 送るポート(DIAll,AIAll,PIAll)を追加する。
+ * BatchPublish/int/0/radio/1ならば前の周期から受信したAI,PI,GSのすべての値
+ * を、チャンネルごとのポート(AIBatch*,PIBatch*,GSBatch)に1周期1回
+ * まとめて出力する。0ならば最新の値のみ出力し、途中の値は破棄する。
+ * PublishDeadband/std::vector<double>/-1,-1,-1,-1/text/前回出力した値
+ * からの変化がこの値以下の場合、値をOutPortに出力しない(絶対不感
+ * 帯)。0ならば値が変化した場合のみ出力する。負ならば不感帯による抑
+ * 制を行わない。配列0から順にAI,PI,TS,GSの設定をする。
+ * PublishRelativeDeadband/std::vector<double>/0,0,0,0/text/前回出力し
+ * た値の大きさに対する比で表した不感帯(相対不感帯)。PublishDeadband
+ * と大きい方を使用する。PublishDeadbandが負の場合は使用しない。配列
+ * 0から順にAI,PI,TS,GSの設定をする。
+ * PublishMinInterval/std::vector<int>/0,0,0,0/text/1つのポートに値を
+ * 出力する最小の間隔[ms]。前回の出力からこの時間が経過していない値
+ * は出力しない。0ならば制限しない。配列0から順にAI,PI,TS,GSの設定
+ * をする。
+ * PublishMaxInterval/std::vector<int>/0,0,0,0/text/前回の出力からこの
+ * 時間[ms]が経過した場合、不感帯内の値でも出力する(ハートビート)。
+ * 0ならば不感帯内の値は出力しない。配列0から順にAI,PI,TS,GSの設定を
+ * する。
+ * PlanCache/int/1/radio/.hmstファイルの解析結果(ポート構成)のキャッシ
+ * ュの使い方。0:使用しない、1:プロセス内のキャッシュを使用する、2:1
+ * に加えて.hmstファイルの隣の.planファイルを使用する、3:キャッシュ
+ * を使用せずに解析し、キャッシュと.planファイルを作り直す。キャッシ
+ * ュは.hmstファイルの内容のハッシュ値で照合する。
+ * WatchSetting/int/0/radio/1ならばACTIVEの間、.hmstファイルの変更と
+ * SettingFilenameの変更を監視し、ポート構成の差分(追加・削除するポー
+ * ト)のみを反映する。ソケット通信は継続する。ボードの数・型の変更は
+ * 再アクティブ化が必要。
+ * WatchInterval/int/500/text/WatchSettingが1の場合に.hmstファイルの変
+ * 更を確認する間隔[ms]。
  *
  */
 class HOTMOCK_master
@@ -124,6 +460,8 @@ class HOTMOCK_master
    virtual RTC::ReturnCode_t onFinalize();
 
   /***
+   * DataTriggerが1の場合、実行コンテキストを起動(tick)するスレッドを
+   * 開始する。
    *
    * The startup action when ExecutionContext startup
    * former rtc_starting_entry()
@@ -134,9 +472,10 @@ class HOTMOCK_master
    * 
    * 
    */
-  // virtual RTC::ReturnCode_t onStartup(RTC::UniqueId ec_id);
+   virtual RTC::ReturnCode_t onStartup(RTC::UniqueId ec_id);
 
   /***
+   * 実行コンテキストを起動(tick)するスレッドを終了する。
    *
    * The shutdown action when ExecutionContext stop
    * former rtc_stopping_entry()
@@ -147,7 +486,7 @@ class HOTMOCK_master
    * 
    * 
    */
-  // virtual RTC::ReturnCode_t onShutdown(RTC::UniqueId ec_id);
+   virtual RTC::ReturnCode_t onShutdown(RTC::UniqueId ec_id);
 
   /***
    * HOTMOCKデバイスの設定ファイルを読み込み、データポートの生成・
@@ -275,23 +614,26 @@ class HOTMOCK_master
   // <rtc-template block="config_declare">
   /*!
    * HOTMOCKSettingによって作成されたHOTMOCKデバイスの設定ファイル
-   * 名。
+   * 名。複数のボードを使用する場合はボードごとにカンマ区切りで指定す
+   * る。ボードの数は設定ファイルの数となる。
    * - Name: SettingFilename SettingFilename
    * - DefaultValue: *.hmst
    */
   std::string m_SettingFilename;
   /*!
-   * HOTMOCKSettingのIPアドレス。
+   * HOTMOCKSettingのIPアドレス。ボードごとにカンマ区切りで指定する。
+   * 指定が足りない場合は最後の値を使用する。
    * - Name: IPAddress IPAddress
    * - DefaultValue: 127.0.0.1
    */
   std::string m_IPAddress;
   /*!
-   * HOTMOCKSettingのPort番号。
+   * HOTMOCKSettingのPort番号。ボードごとにカンマ区切りで指定する。
+   * 指定が足りない場合は最後の値を使用する。
    * - Name: PortNumber PortNumber
    * - DefaultValue: 8888
    */
-  int m_PortNumber;
+  std::vector<int> m_PortNumber;
   /*!
    * HOTMOCKデバイスからの入力を取得する際、
    * 0ならば生値を取得、1ならば工業変換値を取得する。
@@ -300,78 +642,172 @@ class HOTMOCK_master
    * - DefaultValue: 0,0,0,0
    */
   std::vector<int> m_GetDataType;
-
-   // </rtc-template>
-
-  // DataInPort declaration
-  // <rtc-template block="inport_declare">
-  //RTC::TimedShort m_DO;
   /*!
-   * HOTMOCKデバイスのDO*に送信するデジタル出力値を取得するポート。
-   * - Type: TimedShort
+   * HOTMOCKSettingから受信したデータを読み込む受信バッファのサイズ[byte]。
+   * 1周期で受信できる最大量となる。
+   * - Name: RecvBufferSize RecvBufferSize
+   * - DefaultValue: 65536
    */
-  //InPort<RTC::TimedShort> m_DOIn;
-  DynamicInPort<TimedShort> m_DOIn;
-
-  //RTC::TimedDouble m_AO;
+  int m_RecvBufferSize;
   /*!
-   * HOTMOCKデバイスのAO*に送信するアナログ出力値を取得するポート。
-   * - Type: TimedDouble
+   * 1ならば専用のI/Oスレッドでソケット通信と受信データの解析を行い、
+   * onExecuteはロックフリーキューの読み出しとポートへの書き込みのみを
+   * 行う。0ならばonExecute内で通信する。
+   * - Name: IOThread IOThread
+   * - DefaultValue: 0
+   * - Constraint: (0,1)
    */
-  //InPort<RTC::TimedDouble> m_AOIn;
-  DynamicInPort<TimedDouble> m_AOIn;
-
-  //RTC::TimedBoolean m_Reset_PI;
+  int m_IOThread;
   /*!
-   * HOTMOCKデバイスのPI01につながっているパルス入力の積算値をリセ
-   * ットするためのフラグを取得するポート。
-   * - Type: TimedBoolean
+   * 1つのコネクタに対して応答を待たずに送信できるREQUESTの最大数。
+   * 1ならば応答が届くまで次の要求を送らない。
+   * 大きくすると通信の往復時間に制限されずにAI,GS等のデータを取得できる。
+   * - Name: RequestWindow RequestWindow
+   * - DefaultValue: 1
+   * - Constraint: 1<=x<=8
    */
-  //InPort<RTC::TimedBoolean> m_Reset_PIIn;
-  DynamicInPort<TimedBoolean> m_Reset_PIIn;
-  
-  // </rtc-template>
-
-  // DataOutPort declaration
-  // <rtc-template block="outport_declare">
-  //RTC::TimedShort m_DI;
+  int m_RequestWindow;
   /*!
-   * HOTMOCKデバイスのDI*から受信したデジタル入力値を送るポート。
-   * - Type: TimedShort
+   * REQUESTの応答を待つ時間[ms]。時間内に応答が無ければ待ち時間を
+   * 2倍にして再送する。0ならばタイムアウトしない。
+   * - Name: RequestTimeout RequestTimeout
+   * - DefaultValue: 500
+   * - Constraint: 0<=x
    */
-  //OutPort<RTC::TimedShort> m_DIOut;
-  DynamicOutPort<TimedShort> m_DIOut;
-
-  //RTC::TimedDouble m_AI;
+  int m_RequestTimeout;
   /*!
-   * HOTMOCKデバイスのAI*から受信したアナログ入力値を送るポート。
-   * - Type: TimedDouble
+   * 応答の無いREQUESTを再送する最大回数。
+   * 超えた場合はその要求を破棄して次の要求を送る。
+   * - Name: RequestMaxRetry RequestMaxRetry
+   * - DefaultValue: 3
+   * - Constraint: 0<=x<=10
    */
-  //OutPort<RTC::TimedDouble> m_AIOut;
-  DynamicOutPort<TimedDouble> m_AIOut;
-
-  //RTC::TimedDouble m_PI;
+  int m_RequestMaxRetry;
   /*!
-   * HOTMOCKデバイスのPI*から受信したパルス入力値を送るポート。
-   * - Type: TimedDouble
+   * ログの出力レベル。DEBUGならば入出力した値をすべて出力する。
+   * ログは別スレッドで出力されるため、onExecuteの周期には影響しない。
+   * - Name: LogLevel LogLevel
+   * - DefaultValue: INFO
+   * - Constraint: (OFF,ERROR,WARN,INFO,DEBUG)
    */
-  //OutPort<RTC::TimedDouble> m_PIOut;
-  DynamicOutPort<TimedDouble> m_PIOut;
-
-  RTC::TimedDouble m_TS;
+  std::string m_LogLevel;
   /*!
-   * HOTMOCKデバイス内蔵の温度センサから受信した値を送るポート。
-   * - Type: TimedDouble
+   * 1ならばHOTMOCKSettingからデータを受信したとき、またはDO,Reset_PIに
+   * 入力があったときにExtTrigExecutionContextを起動(tick)してonExecuteを
+   * 実行する。受信から出力までの遅れが周期に依存しなくなり、データが
+   * 無い間はCPUを使用しない。1の場合はIOThreadも1として動作する。
+   * - Name: DataTrigger DataTrigger
+   * - DefaultValue: 0
+   * - Constraint: (0,1)
    */
-  OutPort<RTC::TimedDouble> m_TSOut;
-
-  RTC::TimedDoubleSeq m_GS;
+  int m_DataTrigger;
   /*!
-   * HOTMOCKデバイス内蔵の加速度センサから受信した値を送るポート。
-   * 値は要素数0から順にx,y,zの配列として送られる。
-   * - Type: TimedDoubleSeq
+   * DataTriggerが1の場合にonExecuteを実行する最小間隔[us]。
+   * データが連続して届いてもこれより短い間隔では実行しない。
+   * - Name: TriggerMinInterval TriggerMinInterval
+   * - DefaultValue: 1000
+   * - Constraint: 0<=x
    */
-  OutPort<RTC::TimedDoubleSeq> m_GSOut;
+  int m_TriggerMinInterval;
+  /*!
+   * DataTriggerが1の場合にonExecuteを実行する最大間隔[ms]。
+   * データが届かなくてもこの間隔で実行し、AI等の要求や再接続を行う。
+   * - Name: TriggerMaxInterval TriggerMaxInterval
+   * - DefaultValue: 100
+   * - Constraint: 1<=x
+   */
+  int m_TriggerMaxInterval;
+  /*!
+   * 1ならばボードで使用しているすべてのDI,AI,PIの値をまとめて送る
+   * ポート(DIAll,AIAll,PIAll)を追加する。値が更新された周期に1回だけ
+   * 同じ周期の値をまとめて出力する。
+   * - Name: AggregatePorts AggregatePorts
+   * - DefaultValue: 0
+   * - Constraint: (0,1)
+   */
+  int m_AggregatePorts;
+  /*!
+   * 1ならば前の周期から受信したAI,PI,GSのすべての値を、チャンネル
+   * ごとのポート(AIBatch*,PIBatch*,GSBatch)に1周期1回まとめて出力する。
+   * 0ならば最新の値のみを出力し、1周期の間に届いた途中の値は破棄する。
+   * - Name: BatchPublish BatchPublish
+   * - DefaultValue: 0
+   * - Constraint: (0,1)
+   */
+  int m_BatchPublish;
+  /*!
+   * 前回出力した値からの変化がこの値以下の場合、値をOutPortに出力しない
+   * (絶対不感帯)。0ならば値が変化した場合のみ出力する。負ならば不感帯に
+   * よる抑制を行わない。配列0から順にAI,PI,TS,GSの設定をする。
+   * - Name: PublishDeadband PublishDeadband
+   * - DefaultValue: -1,-1,-1,-1
+   */
+  std::vector<double> m_PublishDeadband;
+  /*!
+   * 前回出力した値の大きさに対する比で表した不感帯(相対不感帯)。
+   * PublishDeadbandと大きい方を使用する。PublishDeadbandが負の場合は使用
+   * しない。配列0から順にAI,PI,TS,GSの設定をする。
+   * - Name: PublishRelativeDeadband PublishRelativeDeadband
+   * - DefaultValue: 0,0,0,0
+   */
+  std::vector<double> m_PublishRelativeDeadband;
+  /*!
+   * 1つのポートに値を出力する最小の間隔[ms]。前回の出力からこの時間が
+   * 経過していない値は出力しない。0ならば制限しない。
+   * 配列0から順にAI,PI,TS,GSの設定をする。
+   * - Name: PublishMinInterval PublishMinInterval
+   * - DefaultValue: 0,0,0,0
+   */
+  std::vector<int> m_PublishMinInterval;
+  /*!
+   * 前回の出力からこの時間[ms]が経過した場合、不感帯内の値でも出力する
+   * (ハートビート)。0ならば不感帯内の値は出力しない。
+   * 配列0から順にAI,PI,TS,GSの設定をする。
+   * - Name: PublishMaxInterval PublishMaxInterval
+   * - DefaultValue: 0,0,0,0
+   */
+  std::vector<int> m_PublishMaxInterval;
+  /*!
+   * .hmstファイルの解析結果(ポート構成)のキャッシュの使い方。
+   * 0:使用しない、1:プロセス内のキャッシュを使用する、
+   * 2:1に加えて.hmstファイルの隣の.planファイルを使用する、
+   * 3:キャッシュを使用せずに解析し、キャッシュと.planファイルを作り直す。
+   * キャッシュは.hmstファイルの内容のハッシュ値で照合し、内容が前回の
+   * アクティブ化と同じボードはポートの再構成を省略する。
+   * - Name: PlanCache PlanCache
+   * - DefaultValue: 1
+   * - Constraint: (0,1,2,3)
+   */
+  int m_PlanCache;
+  /*!
+   * 1ならばACTIVEの間、.hmstファイルの変更とSettingFilenameの変更を監視
+   * し、ポート構成の差分(追加・削除するポート)のみを反映する。
+   * 設定ファイルの解析は別スレッドで行い、ソケット通信は継続する。
+   * ボードの数・型の変更は再アクティブ化が必要。
+   * - Name: WatchSetting WatchSetting
+   * - DefaultValue: 0
+   * - Constraint: (0,1)
+   */
+  int m_WatchSetting;
+  /*!
+   * WatchSettingが1の場合に.hmstファイルの変更を確認する間隔[ms]。
+   * - Name: WatchInterval WatchInterval
+   * - DefaultValue: 500
+   * - Constraint: 100<=x
+   */
+  int m_WatchInterval;
+
+   // </rtc-template>
+
+  // DataInPort declaration
+  // <rtc-template block="inport_declare">
+  // DO,AO,Reset_PIはボードごとにHotmockBoardが保持する
+  
+  // </rtc-template>
+
+  // DataOutPort declaration
+  // <rtc-template block="outport_declare">
+  // DI,AI,PI,TS,GS,StaleはボードごとにHotmockBoardが保持する
   
   // </rtc-template>
 
@@ -392,30 +828,54 @@ class HOTMOCK_master
 
  private:
   // <rtc-template block="private_attribute">
-	hotmock::HotmockSetting hmst;
-	hotmock::HotmockClient hmc;
-
-	std::vector<unsigned short> lastFlagList_DO;
-	std::vector<unsigned short> lastFlagList_AO;
-	std::vector<unsigned short> lastFlagList_DI;
-	std::vector<unsigned short> lastFlagList_AI;
-	std::vector<unsigned short> lastFlagList_PI;
-
-	std::vector<unsigned short> connectIDList_DO;
-	std::vector<unsigned short> connectIDList_AO;
-	std::vector<unsigned short> connectIDList_DI;
-	std::vector<unsigned short> connectIDList_AI;
-	std::vector<unsigned short> connectIDList_PI;
-
-	//!AI,DOはコネクタ位置がデバイス本体の表示とHOTMOCKSettingの表示が異なっている!
-	std::vector<unsigned short> portNameList_AI;
-	std::vector<unsigned short> portNameList_DO;
+	hotmock::HotmockClientManager hmm;
+	std::vector< std::unique_ptr<HotmockBoard> > m_boards; //m_boards[0]は1台目のボード
+	PublishFilter m_publishFilter[4]; //AI,PI,TS,GSの値を出力する条件
 
 	int on_or_off;
+
+	//DataTriggerが1の場合に実行コンテキストを起動(tick)するスレッド
+	OpenRTM::ExtTrigExecutionContextService_var m_trigger;
+	std::thread m_triggerThread;
+	std::atomic<bool> m_triggerRunning;
+
+	//WatchSettingが1の場合に.hmstファイルの変更を監視するスレッド
+	std::thread m_watchThread;
+	std::atomic<bool> m_watchRunning;
+	std::mutex m_watchMutex; //以下の3つのメンバを保護する
+	std::condition_variable m_watchCond;
+	std::vector<std::string> m_watchFilenames; //監視する.hmstファイル(ボードの順)
+	std::vector< std::unique_ptr<hotmock::HotmockSetting> > m_reloadSettings; //解析済みで未反映の設定(ボードの順)
+	std::atomic<bool> m_reloadPending; //m_reloadSettingsに未反映の設定がある場合true
+	std::string m_activeSettingFilename; //反映済みのSettingFilename
   
   // </rtc-template>
 
   // <rtc-template block="private_operation">
+	HotmockBoard *createBoard();
+	void deleteBoard();
+	void updatePorts(HotmockBoard &board);
+	void registerChannel(HotmockBoard &board, const HotmockChannel &channel, bool enable);
+	template <class DataType> void registerPort(DynamicInPort<DataType> &port, unsigned int i, bool enable);
+	template <class DataType> void registerPort(DynamicOutPort<DataType> &port, unsigned int i, bool enable);
+	void removePorts(HotmockBoard &board);
+	void updateAggregatePorts(HotmockBoard &board, bool enable);
+	void updateBatchPorts(HotmockBoard &board, bool enable);
+	void resetPublishState(HotmockBoard &board);
+	void updatePublishFilters();
+	bool checkPublish(HotmockBoard &board, int type, PublishState &state, const double *value, unsigned int width, unsigned long long recv_ns);
+	void writePublishCount(HotmockBoard &board, long long clock_offset);
+	void addCommandInPort(const char* name, RTC::InPortBase& port);
+	void startTrigger(RTC::UniqueId ec_id);
+	void stopTrigger();
+	void triggerThreadMain(int min_interval_us, int max_interval_ms);
+	void startWatch();
+	void stopWatch();
+	void watchThreadMain(int interval_ms, std::vector<unsigned long long> hashes);
+	void applyReload();
+	void writeOutputs(HotmockBoard &board);
+	void readDigitalInputs(HotmockBoard &board, long long clock_offset);
+	void requestInputs(HotmockBoard &board, const std::vector<int> &param, long long clock_offset);
   
   // </rtc-template>
 
@@ -21,6 +21,8 @@
 #include <vector>
 #include <new>
 #include <stdexcept>
+#include <cassert>
+#include <utility>
 
 //not necessary -- the following RTM files have already been included in the "ComponentName.h".
 //#include <rtm/RTObject.h> 
@@ -30,6 +32,202 @@
 template <class DataType> class DynamicInPort;
 template <class DataType> class DynamicOutPort;
 
+/*!
+ * @class PortPool
+ * @brief Pooled storage of objects with stable indices
+ *
+ * Objects are constructed in place in slabs (arrays allocated once and never moved),
+ * so the address and the index of an object do not change while other objects are
+ * added, reset or deleted. Consecutive objects share a slab (contiguous in memory);
+ * reserve() makes the next n objects share one slab.
+ * An object is reset by create() and replace(): the new object is constructed in spare
+ * storage before the old one is destroyed, so a failed constructor leaves the old object.
+ * remove() of an object in the middle leaves an empty index: size() still counts it and
+ * get() returns NULL for it, so check exists() before using an index which may have been removed.
+ */
+template <class T>
+class PortPool{
+	std::vector< T* > m_ptr; //pointer to the object of each index (NULL if destroyed)
+	std::vector< void* > m_store; //storage of each index
+	std::vector< void* > m_free; //spare storage released by replace() (reused by create())
+	std::vector< unsigned char* > m_slab; //allocated slabs
+	unsigned int m_slab_capacity; //# of objects in the last slab
+	unsigned int m_slab_used; //# of objects used in the last slab
+	unsigned int m_next_capacity; //# of objects in the next slab
+
+	PortPool(const PortPool &);
+	PortPool &operator=(const PortPool &);
+
+	/*!
+	 * @brief Get storage for one object at the end of the last slab (allocates a new slab if full)
+	 * @return pointer to the storage
+	 */
+	void *allocate(){
+		if(m_slab.empty() || m_slab_used >= m_slab_capacity){
+			unsigned int capacity = m_next_capacity;
+			if(capacity < m_ptr.size()){ //grow geometrically
+				capacity = (unsigned int)m_ptr.size();
+			}
+			m_slab.reserve(m_slab.size()+1);
+			m_slab.push_back(static_cast<unsigned char*>(::operator new(sizeof(T)*capacity)));
+			m_slab_capacity = capacity;
+			m_slab_used = 0;
+			m_next_capacity = default_slab_capacity;
+		}
+		return m_slab.back() + sizeof(T)*(m_slab_used++);
+	}
+
+public:
+	static const unsigned int default_slab_capacity = 8; /*!< Min # of objects in a slab */
+
+	PortPool() : m_slab_capacity(0), m_slab_used(0), m_next_capacity(default_slab_capacity) {}
+	~PortPool(){
+		clear();
+	}
+
+	/*!
+	 * @brief Make the next n objects contiguous (allocated in one slab)
+	 * @param n # of objects to be added
+	 */
+	void reserve(unsigned int n){
+		if(m_slab.empty() || m_slab_capacity - m_slab_used < n){
+			m_slab_used = m_slab_capacity; //start a new slab at next add()
+			m_next_capacity = n;
+		}
+		m_ptr.reserve(m_ptr.size()+n);
+		m_store.reserve(m_store.size()+n);
+	}
+
+	/*!
+	 * @brief Construct a new object at the end (index = size()-1)
+	 * @param args arguments of the constructor
+	 * @return pointer to the object
+	 */
+	template <class... Args>
+	T *add(Args&&... args){
+		m_ptr.reserve(m_ptr.size()+1);
+		m_store.reserve(m_store.size()+1);
+		void *pt = allocate();
+		T *obj;
+		try{
+			obj = new(pt) T(std::forward<Args>(args)...);
+		}
+		catch(...){
+			m_slab_used--;
+			throw;
+		}
+		m_ptr.push_back(obj);
+		m_store.push_back(pt);
+		return obj;
+	}
+
+	/*!
+	 * @brief Construct an object in spare storage without giving it an index (see replace())
+	 * @param args arguments of the constructor
+	 * @return pointer to the object (exception of the constructor or bad_alloc is thrown to the caller)
+	 */
+	template <class... Args>
+	T *create(Args&&... args){
+		m_free.reserve(m_free.size()+2); //replace() and discard() do not allocate
+		void *pt;
+		if(m_free.empty()){
+			pt = allocate();
+		}else{
+			pt = m_free.back();
+			m_free.pop_back();
+		}
+		try{
+			return new(pt) T(std::forward<Args>(args)...);
+		}
+		catch(...){
+			m_free.push_back(pt);
+			throw;
+		}
+	}
+
+	/*!
+	 * @brief Destroy an object made by create() which is not used
+	 * @param obj Object made by create()
+	 */
+	void discard(T *obj){
+		obj->~T();
+		m_free.push_back(obj);
+	}
+
+	/*!
+	 * @brief Give the index of an object to an object made by create() and destroy the old object
+	 * (its storage is reused by the next create())
+	 * @param i Index of the object
+	 * @param obj Object made by create()
+	 */
+	void replace(unsigned int i, T *obj){
+		destroy(i);
+		m_free.push_back(m_store[i]);
+		m_ptr[i] = obj;
+		m_store[i] = obj;
+	}
+
+	/*!
+	 * @brief Destroy the object but keep its index and storage
+	 * @param i Index of the object
+	 */
+	void destroy(unsigned int i){
+		if(m_ptr[i] != NULL){
+			T *pt = m_ptr[i];
+			m_ptr[i] = NULL;
+			pt->~T();
+		}
+	}
+
+	/*!
+	 * @brief Destroy the object. Indices of the other objects do not change.
+	 * The storage is reused only if the object is the last one
+	 * @param i Index of the object
+	 */
+	void remove(unsigned int i){
+		destroy(i);
+		while(!m_ptr.empty() && m_ptr.back() == NULL){ //trailing indices can be removed
+			if(m_slab_used > 0 && m_store.back() == m_slab.back() + sizeof(T)*(m_slab_used-1)){
+				m_slab_used--; //storage at the end of the last slab can be reused
+			}
+			m_ptr.pop_back();
+			m_store.pop_back();
+		}
+	}
+
+	/*!
+	 * @brief Destroy all objects and release the slabs
+	 */
+	void clear(){
+		for(typename std::vector< T* >::size_type i=0;i<m_ptr.size();i++){
+			destroy((unsigned int)i);
+		}
+		m_ptr.clear();
+		m_store.clear();
+		m_free.clear();
+		for(std::vector< unsigned char* >::size_type i=0;i<m_slab.size();i++){
+			::operator delete(m_slab[i]);
+		}
+		m_slab.clear();
+		m_slab_capacity = 0;
+		m_slab_used = 0;
+		m_next_capacity = default_slab_capacity;
+	}
+
+	/*!
+	 * @brief Get # of indices (including the empty indices left by remove() in the middle)
+	 * @return size
+	 */
+	typename std::vector< T* >::size_type size() const {return m_ptr.size();}
+	/*!
+	 * @brief Check if an index has an object
+	 * @param i Index
+	 * @return true if i < size() and the object was not removed
+	 */
+	bool exists(unsigned int i) const {return i < m_ptr.size() && m_ptr[i] != NULL;}
+	T *get(unsigned int i) const {return m_ptr[i];}
+};
+
 /*!
  * @class PortDataVect
  * @brief PortDataVect class
@@ -39,7 +237,7 @@ class PortDataVect{
 	friend class DynamicInPort<DataType>;
 	friend class DynamicOutPort<DataType>;
 
-	std::vector< DataType* > DataPtr;
+	PortPool< DataType > m_pool;
 
 	int addData();
 	int deleteData(unsigned int i);
@@ -48,8 +246,8 @@ class PortDataVect{
 	 * @return 0 if no error
 	 */
 	int deleteData(){ //default: delete last data
-		if(DataPtr.empty()){return 1;}
-		return deleteData(DataPtr.size()-1);
+		if(m_pool.size()==0){return 1;}
+		return deleteData(m_pool.size()-1);
 	}
 
 public:
@@ -57,8 +255,14 @@ public:
 	//PortDataVect(const PortDataVect &cp);
 	~PortDataVect();
 
-	typename std::vector< DataType* >::size_type getSize(){return DataPtr.size();}
-	DataType &operator [](int i) const {return *(DataPtr[i]);}
+	typename std::vector< DataType* >::size_type getSize(){return m_pool.size();}
+	/*!
+	 * @brief Check if data exists at an index (false if deleted)
+	 * @param i Index of data
+	 * @return true if exists
+	 */
+	bool exists(unsigned int i) const {return m_pool.exists(i);}
+	DataType &operator [](int i) const {assert(m_pool.exists(i)); return *(m_pool.get(i));}
 };
 
 /*!
@@ -69,7 +273,7 @@ template <class DataType>
 class InPortVect{
 	friend class DynamicInPort<DataType>;
 
-	std::vector< RTC::InPort<DataType>* > InPortPtr;
+	PortPool< RTC::InPort<DataType> > m_pool;
 
 	int addInPort(const char* name, DataType& data);
 	int deleteInPort(unsigned int i);
@@ -78,8 +282,8 @@ class InPortVect{
 	 * @return 0 if no error
 	 */
 	int deleteInPort(){
-		if(InPortPtr.empty()){return 1;}
-		return deleteInPort(InPortPtr.size()-1);
+		if(m_pool.size()==0){return 1;}
+		return deleteInPort(m_pool.size()-1);
 	}
 
 public:
@@ -87,8 +291,14 @@ public:
 	//InPortVect(const InPortVect &cp);
 	~InPortVect();
 
-	typename std::vector< RTC::InPort<DataType>* >::size_type getSize(){return InPortPtr.size();}
-	RTC::InPort<DataType> &operator [](int i) const { return *(InPortPtr[i]); }
+	typename std::vector< RTC::InPort<DataType>* >::size_type getSize(){return m_pool.size();}
+	/*!
+	 * @brief Check if a port exists at an index (false if deleted)
+	 * @param i Index of port
+	 * @return true if exists
+	 */
+	bool exists(unsigned int i) const {return m_pool.exists(i);}
+	RTC::InPort<DataType> &operator [](int i) const {assert(m_pool.exists(i)); return *(m_pool.get(i));}
 };
 
 /*!
@@ -99,7 +309,7 @@ template <class DataType>
 class OutPortVect{
 	friend class DynamicOutPort<DataType>;
 
-	std::vector< RTC::OutPort<DataType>* > OutPortPtr;
+	PortPool< RTC::OutPort<DataType> > m_pool;
 
 	int addOutPort(const char* name, DataType& data);
 	int deleteOutPort(unsigned int i);
@@ -108,8 +318,8 @@ class OutPortVect{
 	 * @return 0 if no error
 	 */
 	int deleteOutPort(){
-		if(OutPortPtr.empty()){return 1;}
-		return deleteOutPort(OutPortPtr.size()-1);
+		if(m_pool.size()==0){return 1;}
+		return deleteOutPort(m_pool.size()-1);
 	}
 
 public:
@@ -117,8 +327,14 @@ public:
 	//OutPortVect(const OutPortVect &cp);
 	~OutPortVect();
 
-	typename std::vector< RTC::OutPort<DataType> >::size_type getSize(){return OutPortPtr.size();}
-	RTC::OutPort<DataType> &operator [](int i) const { return *(OutPortPtr[i]); }
+	typename std::vector< RTC::OutPort<DataType>* >::size_type getSize(){return m_pool.size();}
+	/*!
+	 * @brief Check if a port exists at an index (false if deleted)
+	 * @param i Index of port
+	 * @return true if exists
+	 */
+	bool exists(unsigned int i) const {return m_pool.exists(i);}
+	RTC::OutPort<DataType> &operator [](int i) const {assert(m_pool.exists(i)); return *(m_pool.get(i));}
 };
 
 /*!
@@ -139,6 +355,7 @@ public:
 	//DynamicInPort(const DynamicInPort &cp);
 	~DynamicInPort();
 
+	void reserve(unsigned int n);
 	int addPort();
 	int resetPort(unsigned int i);
 	int deletePort(unsigned int i);
@@ -152,16 +369,24 @@ public:
 	}
 
 	/*!
-	 * @brief Get # of ports
-	 * @return How many ports are registered
+	 * @brief Get # of port indices. A port deleted in the middle keeps its index, so check exists()
+	 * before using an index which may have been deleted
+	 * @return How many port indices are registered
 	 */
 	std::vector< std::string >::size_type getSize(){return m_register_name.size();}
+	/*!
+	 * @brief Check if a port exists at an index
+	 * @param i Port index
+	 * @return true if i < getSize() and the port was not deleted
+	 */
+	bool exists(unsigned int i) const {return m_port.m_pool.exists(i);}
 	/*!
 	 * @brief Get port name from port index
 	 * @param i Port index
-	 * @return Port name or NULL (if i >= port_size)
+	 * @return Port name or NULL (if i >= port_size or the port was deleted)
 	 */
 	const char* getName(unsigned int i){
+		if(i < getSize() && !exists(i)){return NULL;}
 		try{
 			return m_register_name.at(i).c_str();
 		}
@@ -189,6 +414,7 @@ public:
 	//DynamicOutPort(const DynamicOutPort &cp);
 	~DynamicOutPort();
 
+	void reserve(unsigned int n);
 	int addPort();
 	int resetPort(unsigned int i);
 	int deletePort(unsigned int i);
@@ -202,16 +428,24 @@ public:
 	}
 
 	/*!
-	 * @brief Get # of ports
-	 * @return How many ports are registered
+	 * @brief Get # of port indices. A port deleted in the middle keeps its index, so check exists()
+	 * before using an index which may have been deleted
+	 * @return How many port indices are registered
 	 */
 	std::vector< std::string >::size_type getSize(){return m_register_name.size();}
+	/*!
+	 * @brief Check if a port exists at an index
+	 * @param i Port index
+	 * @return true if i < getSize() and the port was not deleted
+	 */
+	bool exists(unsigned int i) const {return m_port.m_pool.exists(i);}
 	/*!
 	 * @brief Get port name from port index
 	 * @param i Port index
-	 * @return Port name (or NULL if invalid index)
+	 * @return Port name (or NULL if invalid index or the port was deleted)
 	 */
 	const char* getName(std::vector< std::string >::size_type i){
+		if(i < getSize() && !exists((unsigned int)i)){return NULL;}
 		try{
 			return m_register_name.at(i).c_str();
 		}
@@ -234,86 +468,41 @@ PortDataVect<DataType>::PortDataVect(){
  */
 template <class DataType >
 PortDataVect<DataType>::~PortDataVect(){
-	int result;
-
-	//delete all ports
-	while(!DataPtr.empty()){
-		result = deleteData();
-		if(result != 0){
-			std::cerr << "Error in PortDataVect::~PortDataVect()" << std::endl;
-		}
-	}
+	//delete all data
+	m_pool.clear();
 }
 
-/****************************************************************/
-/* PortDataVect<DataType>::PortDataVect(const PortDataVect &cp) */
-/*  Copy constructor                                            */
-/****************************************************************/
-/*
-template <class DataType> 
-PortDataVect<DataType>::PortDataVect(const PortDataVect &cp){
-	int size = cp.getSize();
-	int i,result;
-
-	for(i=0;i<size;i++){
-		result = addData();
-		if(result!=0){std::exit(1);}
-		*(DataPtr[i]) = *(cp.DataPtr[i]);
-	}
-}
-*/
-
 /*!
- * @brief Add new data to DataPtr
+ * @brief Add new data to the pool
  * @return 0 if no error, 1 if allocation error
  */
 template <class DataType> 
 int PortDataVect<DataType>::addData(){
-	DataType* pt = NULL;
-
-	//dynamic memory allocation
 	try{
-		pt = new DataType;
+		m_pool.add();
 	}
 	catch(std::bad_alloc){
 		std::cerr << "Error in PortDataVect::addData(): BAD ALLOC Exception" << std::endl;
 		return 1;
 	}
 
-	try{
-		DataPtr.push_back(pt);
-	}
-	catch(std::bad_alloc){
-		std::cerr << "Error in PortDataVect::addData(): BAD ALLOC Exception" << std::endl;
-		delete pt;
-		return 1;
-	}
-
 	return 0;
 }
 
 /*!
- * @brief Delete data from the DataPtr
+ * @brief Delete data from the pool (indices of the other data do not change)
  * @param i Index of data to be deleted
  * @return 0 if no error, 1 if invalid index
  */
 template <class DataType> 
 int PortDataVect<DataType>::deleteData(unsigned int i){
 	//check argument
-	if(i>=DataPtr.size()){
+	if(i>=m_pool.size()){
 		std::cerr << "Error in PortDataVect::deleteData(): Invalid argument" << std::endl;
 		return 1;
 	}
 
-	//delete data
-	if(DataPtr[i] != NULL){
-		delete DataPtr[i];
-	}
-
-	//delete pointer to data
-	typename std::vector<DataType *>::iterator it = DataPtr.begin();
-	std::advance(it,i);
-	it = DataPtr.erase(it);
+	m_pool.remove(i);
 
 	return 0;
 }
@@ -333,81 +522,43 @@ InPortVect<DataType>::InPortVect(){
  */
 template <class DataType> 
 InPortVect<DataType>::~InPortVect(){
-	int result;
-
 	//delete all ports
-	while(!InPortPtr.empty()){
-		result = deleteInPort();
-		if(result != 0){
-			std::cerr << "Error in InPortVect::~InPortVect()" << std::endl;
-		}
-	}
+	m_pool.clear();
 }
 
-/**********************************************************/
-/* InPortVect<DataType>::InPortVect(const InPortVect &cp) */
-/*  Copy constructor                                      */
-/**********************************************************/
-/*
-template <class DataType> 
-InPortVect<DataType>::InPortVect(const InPortVect &cp){
-
-}
-*/
-
 /*!
- * @brief Add data to InPortPtr
+ * @brief Add new port to the pool
  * @param name Name (with index) of InPort
  * @param data Reference of a data variable (input data will be stored here)
  * @return 0 if no error, 1 if allocation error
  */
 template <class DataType> 
 int InPortVect<DataType>::addInPort(const char* name, DataType& data){
-	RTC::InPort<DataType>* pt = NULL;
-
-	//dynamic memory allocation
 	try{
-		pt = new RTC::InPort < DataType >(name, data);
+		m_pool.add(name, data);
 	}
 	catch(std::bad_alloc){
 		std::cerr << "Error in InPortVect::addInPort(): BAD ALLOC Exception" << std::endl;
 		return 1;
 	}
 
-	try{
-		InPortPtr.push_back(pt);
-	}
-	catch(std::bad_alloc){
-		std::cerr << "Error in InPortVect::addInPort(): BAD ALLOC Exception" << std::endl;
-		delete pt;
-		return 1;
-	}
-
 	return 0;
 }
 
 /*!
- * @brief Delete data from InPortPtr
+ * @brief Delete port from the pool (indices of the other ports do not change)
  * @param i Index of port to be deleted
  * @return 0 if no error, 1 if invalid index
  */
 template <class DataType> 
 int InPortVect<DataType>::deleteInPort(unsigned int i){
 	//check argument
-	if(i>=InPortPtr.size()){
+	if(i>=m_pool.size()){
 		std::cerr << "Error in InPortVect::deleteInPort(): Invalid argument" << std::endl;
 		return 1;
 	}
 
-	//delete port
-	if(InPortPtr[i] != NULL){
-		delete InPortPtr[i];
-	}
-
-	//delete pointer to port
-	typename std::vector< RTC::InPort<DataType>* >::iterator it=InPortPtr.begin();
-	std::advance(it,i);
-	it = InPortPtr.erase(it);
+	m_pool.remove(i);
 
 	return 0;
 }
@@ -427,81 +578,43 @@ OutPortVect<DataType>::OutPortVect(){
  */
 template <class DataType> 
 OutPortVect<DataType>::~OutPortVect(){
-	int result;
-
 	//delete all ports
-	while(!OutPortPtr.empty()){
-		result = deleteOutPort();
-		if(result != 0){
-			std::cerr << "Error in OutPortVect::~OutPortVect()" << std::endl;
-		}
-	}
+	m_pool.clear();
 }
 
-/*************************************************************/
-/* OutPortVect<DataType>::OutPortVect(const OutPortVect &cp) */
-/*  Copy constructor                                         */
-/*************************************************************/
-/*
-template <class DataType> 
-OutPortVect<DataType>::OutPortVect(const OutPortVect &cp){
-
-}
-*/
-
 /*!
- * @brief Add data to InPortPtr
+ * @brief Add new port to the pool
  * @param name Name (with index) of OutPort
  * @param data Reference of a data variable (output data will be stored here)
  * @return 0 if no error, 1 if allocation error
  */
 template <class DataType> 
 int OutPortVect<DataType>::addOutPort(const char* name, DataType& data){
-	RTC::OutPort<DataType>* pt = NULL;
-
-	//dynamic memory allocation
 	try{
-		pt = new RTC::OutPort < DataType >(name, data);
+		m_pool.add(name, data);
 	}
 	catch(std::bad_alloc){
 		std::cerr << "Error in OutPortVect::addOutPort(): BAD ALLOC Exception" << std::endl;
 		return 1;
 	}
 
-	try{
-		OutPortPtr.push_back(pt);
-	}
-	catch(std::bad_alloc){
-		std::cerr << "Error in OutPortVect::addOutPort(): BAD ALLOC Exception" << std::endl;
-		delete pt;
-		return 1;
-	}
-
 	return 0;
 }
 
 /*!
- * @brief Delete data from OutPortPtr
+ * @brief Delete port from the pool (indices of the other ports do not change)
  * @param i Index of port to be deleted
  * @return 0 if no error, 1 if invalid index
  */
 template <class DataType> 
 int OutPortVect<DataType>::deleteOutPort(unsigned int i){
 	//check argument
-	if(i>=OutPortPtr.size()){
+	if(i>=m_pool.size()){
 		std::cerr << "Error in OutPortVect::deleteOutPort(): Invalid argument" << std::endl;
 		return 1;
 	}
 
-	//delete port
-	if(OutPortPtr[i] != NULL){
-		delete OutPortPtr[i];
-	}
-
-	//delete pointer to port
-	typename std::vector< RTC::OutPort<DataType>* >::iterator it=OutPortPtr.begin();
-	std::advance(it,i);
-	it = OutPortPtr.erase(it);
+	m_pool.remove(i);
 
 	return 0;
 }
@@ -540,39 +653,16 @@ DynamicInPort<DataType>::~DynamicInPort(){
 	}
 }
 
-/*******************************************************************/
-/* DynamicInPort<DataType>::DynamicInPort(const DynamicInPort &cp) */
-/*  Copy constructor                                               */
-/*******************************************************************/
-/*
+/*!
+ * @brief Make the data and the ports of the next n addPort() contiguous
+ * @param n # of ports to be added
+ */
 template <class DataType> 
-DynamicInPort<DataType>::DynamicInPort(const DynamicInPort &cp){
-	int size = cp.getSize();
-	int i, result;
-	std::string name;
-
-	m_id_used = cp.m_id_used;
-	m_name_base = cp.m_name_base;
-
-	for(i=0;i<size;i++){
-		name = cp.getName(i);
-		m_register_name.push_back(name);
-
-		//create data
-		result = m_data.addData();
-		if(result != 0){
-			std::exit(1);
-		}
-
-		//create port
-		result = m_port.addInPort(m_register_name[m_register_name.size()-1].c_str(), m_data[m_data.getSize()-1]);
-		if(result != 0){
-			std::exit(1);
-		}
-	}
-
+void DynamicInPort<DataType>::reserve(unsigned int n){
+	m_register_name.reserve(m_register_name.size()+n);
+	m_data.m_pool.reserve(n);
+	m_port.m_pool.reserve(n);
 }
-*/
 
 /*!
  * @brief Add new port
@@ -615,81 +705,78 @@ int DynamicInPort<DataType>::addPort(){
 }
 
 /*!
- * @brief Reset port
+ * @brief Reset port (port and data are constructed again with the same index).
+ * The new port and data are constructed before the old ones are destroyed,
+ * so the old port and data are left unchanged if construction fails
  * @param i Index of port to be reset
- * @return 0 if no error, 1 if invalid index
+ * @return 0 if no error, 1 if invalid or deleted index, or construction error
  */
 template <class DataType> 
 int DynamicInPort<DataType>::resetPort(unsigned int i){
-	//check argument
-	if(i>=getSize()){
+	DataType *data;
+	RTC::InPort<DataType> *port;
+
+	//check argument (a deleted port is not reset)
+	if(!exists(i)){
 		std::cerr << "Error in DynamicInPort::resetPort(): Invalid argument" << std::endl;
 		return 1;
 	}
 
-	//reset data
-	//delete data
-	if(m_data.DataPtr[i]!=NULL){
-		delete m_data.DataPtr[i];
-		m_data.DataPtr[i]=NULL;
-	}
-	//dynamic memory allocation
+	//construct new data and port
 	try{
-		m_data.DataPtr[i] = new DataType;
+		data = m_data.m_pool.create();
 	}
-	catch(std::bad_alloc){
-		std::cerr << "Error in PortDataVect::addData(): BAD ALLOC Exception" << std::endl;
+	catch(...){
+		std::cerr << "Error in DynamicInPort::resetPort(): data can not be reset" << std::endl;
 		return 1;
 	}
-
-	//reset port
-	//delete port
-	if(m_port.InPortPtr[i] != NULL){
-		delete m_port.InPortPtr[i];
-		m_port.InPortPtr[i] = NULL;
-	}
-	//dynamic memory allocation
 	try{
-		m_port.InPortPtr[i] = new RTC::InPort < DataType >(m_register_name[i].c_str(), m_data[i]);
+		port = m_port.m_pool.create(m_register_name[i].c_str(), *data);
 	}
-	catch(std::bad_alloc){
-		std::cerr << "Error in InPortVect::addInPort(): BAD ALLOC Exception" << std::endl;
+	catch(...){
+		m_data.m_pool.discard(data);
+		std::cerr << "Error in DynamicInPort::resetPort(): port can not be reset" << std::endl;
 		return 1;
 	}
 
+	//replace the old ones (the old port refers to the old data, so it is destroyed first)
+	m_port.m_pool.replace(i, port);
+	m_data.m_pool.replace(i, data);
+
 	return 0;
 }
 
 /*!
- * @brief Delete port
+ * @brief Delete port. Indices of the other ports do not change
+ * (getSize() decreases only if the last port is deleted)
  * @param i Index of port to be deleted
- * @return 0 if no error, 1 if invalid index
+ * @return 0 if no error, 1 if invalid or already deleted index
  */
 template <class DataType> 
 int DynamicInPort<DataType>::deletePort(unsigned int i){
 	int result;
 
 	//check argument
-	if(i>=getSize()){
+	if(!exists(i)){
 		std::cerr << "Error in DynamicInPort::deletePort(): Invalid argument" << std::endl;
 		return 1;
 	}
 
-	//delete data
-	result = m_data.deleteData(i);
+	//delete port (the port refers to the data, so it is deleted first)
+	result = m_port.deleteInPort(i);
 	if(result != 0){
 		return 1;
 	}
-	//delete port
-	result = m_port.deleteInPort(i);
+	//delete data
+	result = m_data.deleteData(i);
 	if(result != 0){
 		return 1;
 	}
 
-	//delete name
-	std::vector< std::string >::iterator it=m_register_name.begin();
-	std::advance(it,i);
-	it = m_register_name.erase(it);
+	//delete names of the trailing deleted ports (indices of the other ports do not change)
+	while(m_register_name.size() > m_port.m_pool.size()){
+		m_register_name.pop_back();
+	}
 
 	return 0;
 }
@@ -728,39 +815,16 @@ DynamicOutPort<DataType>::~DynamicOutPort(){
 	}
 }
 
-/**********************************************************************/
-/* DynamicOutPort<DataType>::DynamicOutPort(const DynamicOutPort &cp) */
-/*  Copy constructor                                                  */
-/**********************************************************************/
-/*
+/*!
+ * @brief Make the data and the ports of the next n addPort() contiguous
+ * @param n # of ports to be added
+ */
 template <class DataType> 
-DynamicOutPort<DataType>::DynamicOutPort(const DynamicOutPort &cp){
-	int size = cp.getSize();
-	int i, result;
-	std::string name;
-
-	m_id_used = cp.m_id_used;
-	m_name_base = cp.m_name_base;
-
-	for(i=0;i<size;i++){
-		name = cp.getName(i);
-		m_register_name.push_back(name);
-
-		//create data
-		result = m_data.addData();
-		if(result != 0){
-			std::exit(1);
-		}
-
-		//create port
-		result = m_port.addOutPort(m_register_name[m_register_name.size()-1].c_str(), m_data[m_data.getSize()-1]);
-		if(result != 0){
-			std::exit(1);
-		}
-	}
-
+void DynamicOutPort<DataType>::reserve(unsigned int n){
+	m_register_name.reserve(m_register_name.size()+n);
+	m_data.m_pool.reserve(n);
+	m_port.m_pool.reserve(n);
 }
-*/
 
 /*!
  * @brief Add new port
@@ -803,82 +867,79 @@ int DynamicOutPort<DataType>::addPort(){
 }
 
 /*!
- * @brief Reset port
+ * @brief Reset port (port and data are constructed again with the same index).
+ * The new port and data are constructed before the old ones are destroyed,
+ * so the old port and data are left unchanged if construction fails
  * @param i Index of port to be reset
- * @return 0 if no error, 1 if invalid index
+ * @return 0 if no error, 1 if invalid or deleted index, or construction error
  */
 template <class DataType> 
 int DynamicOutPort<DataType>::resetPort(unsigned int i){
-	//check argument
-	if(i>=getSize()){
+	DataType *data;
+	RTC::OutPort<DataType> *port;
+
+	//check argument (a deleted port is not reset)
+	if(!exists(i)){
 		std::cerr << "Error in DynamicOutPort::resetPort(): Invalid argument" << std::endl;
 		return 1;
 	}
 
-	//reset data
-	//delete data
-	if(m_data.DataPtr[i]!=NULL){
-		delete m_data.DataPtr[i];
-		m_data.DataPtr[i]=NULL;
-	}
-	//dynamic memory allocation
+	//construct new data and port
 	try{
-		m_data.DataPtr[i] = new DataType;
+		data = m_data.m_pool.create();
 	}
-	catch(std::bad_alloc){
-		std::cerr << "Error in PortDataVect::addData(): BAD ALLOC Exception" << std::endl;
+	catch(...){
+		std::cerr << "Error in DynamicOutPort::resetPort(): data can not be reset" << std::endl;
 		return 1;
 	}
-
-	//reset port
-	//delete port
-	if(m_port.OutPortPtr[i] != NULL){
-		delete m_port.OutPortPtr[i];
-		m_port.OutPortPtr[i] = NULL;
-	}
-	//dynamic memory allocation
 	try{
-		m_port.OutPortPtr[i] = new RTC::OutPort < DataType >(m_register_name[i].c_str(), m_data[i]);
+		port = m_port.m_pool.create(m_register_name[i].c_str(), *data);
 	}
-	catch(std::bad_alloc){
-		std::cerr << "Error in OutPortVect::addOutPort(): BAD ALLOC Exception" << std::endl;
+	catch(...){
+		m_data.m_pool.discard(data);
+		std::cerr << "Error in DynamicOutPort::resetPort(): port can not be reset" << std::endl;
 		return 1;
 	}
 
+	//replace the old ones (the old port refers to the old data, so it is destroyed first)
+	m_port.m_pool.replace(i, port);
+	m_data.m_pool.replace(i, data);
+
 	return 0;
 }
 
 
 /*!
- * @brief Delete port
+ * @brief Delete port. Indices of the other ports do not change
+ * (getSize() decreases only if the last port is deleted)
  * @param i Index of port to be deleted
- * @return 0 if no error, 1 if invalid index
+ * @return 0 if no error, 1 if invalid or already deleted index
  */
 template <class DataType> 
 int DynamicOutPort<DataType>::deletePort(unsigned int i){
 	int result;
 
 	//check argument
-	if(i>=getSize()){
+	if(!exists(i)){
 		std::cerr << "Error in DynamicOutPort::deletePort(): Invalid argument" << std::endl;
 		return 1;
 	}
 
-	//delete data
-	result = m_data.deleteData(i);
+	//delete port (the port refers to the data, so it is deleted first)
+	result = m_port.deleteOutPort(i);
 	if(result != 0){
 		return 1;
 	}
-	//delete port
-	result = m_port.deleteOutPort(i);
+	//delete data
+	result = m_data.deleteData(i);
 	if(result != 0){
 		return 1;
 	}
 
-	//delete name
-	std::vector< std::string >::iterator it=m_register_name.begin();
-	std::advance(it,i);
-	it = m_register_name.erase(it);
+	//delete names of the trailing deleted ports (indices of the other ports do not change)
+	while(m_register_name.size() > m_port.m_pool.size()){
+		m_register_name.pop_back();
+	}
 
 	return 0;
 }
@@ -12,14 +12,17 @@
 #ifndef HOTMOCKCLIENT_H
 #define HOTMOCKCLIENT_H
 
-//needed for socket
-#include <winsock2.h> //must be included before #include <windows.h>
-#include <ws2tcpip.h> //must be included before #include <windows.h>
-#include <windows.h>
+#include "hotmocktransport.h" //must be included before #include <windows.h>
 
 #include <string>
 #include <vector>
-#include <deque>
+#include <memory>
+#include <atomic>
+#include <thread>
+
+#include "spscqueue.h"
+#include "hotmocktimer.h"
+#include "hotmock/hotmocklog.h"
 
 namespace hotmock{
 
@@ -80,6 +83,16 @@ namespace hotmock{
 		TS /*!< Temperature Sensor (onboard) */
 	};
 
+	/*!
+	 * @enum HotmockConnectionState
+	 * @brief State of the connection to Hotmock server
+	 */
+	enum HotmockConnectionState{
+		Disconnected, /*!< Not connected (waiting for the next connect attempt) */
+		Connecting, /*!< Non-blocking connect in progress */
+		Connected /*!< Connected */
+	};
+
 	/*!
 	 * @enum HotmockClientCommand
 	 * @brief Command used to send message to hotmock
@@ -118,14 +131,61 @@ namespace hotmock{
 	/*!
 	 * @class HotmockData
 	 * @brief HotmockData class
+	 *
+	 * Each connector has a contiguous fixed-capacity ring buffer which is safe for one producer
+	 * thread (setData) and one consumer thread (isNew, getNextData, getLatestData, drain, discard).
+	 * Memory is allocated only in initialize(). When a ring is full, the oldest data is dropped and counted
+	 * so that the newest data is always kept. The producer removes it under a per-connector flag which the
+	 * consumer also holds while taking data out, so the two never take out the same entry; the producer
+	 * pushes without the flag, and the consumer waits only while the producer drops one entry.
+	 * The consumer should still empty every ring which received data each cycle with getLatestData(), drain()
+	 * or discard(); then a ring is full only if more than Capacity data arrive in one cycle.
 	 */
-	template <class DataType>
+	template <class DataType, std::size_t Capacity = 32>
 	class HotmockData{
-		std::vector< std::deque<DataType> > data; //ring buffer
+		/*!
+		 * @brief Data with the time it was received
+		 */
+		struct Entry{
+			DataType value;
+			unsigned long long time_ns; //monotonic receive time [ns]
+		};
+
+		/*!
+		 * @brief Ring buffer of a connector
+		 */
+		struct Ring{
+			SPSCQueue<Entry, Capacity> queue;
+			std::atomic<unsigned long> overflow; //# of data dropped because the ring was full
+			std::atomic<bool> busy; //true while data is taken out (by the consumer, or by the producer dropping the oldest data)
+		};
+
+		std::unique_ptr<Ring[]> data; //ring buffer
+		typename std::vector<DataType>::size_type data_size;
 		int index_offset;
 
+		HotmockData(const HotmockData &);
+		HotmockData &operator=(const HotmockData &);
+
+		/*!
+		 * @brief Start taking data out of a ring (waits while the other thread takes data out)
+		 * @param ring Ring of a connector
+		 */
+		static void lock(Ring &ring){
+			while(ring.busy.exchange(true, std::memory_order_acquire)){
+				std::this_thread::yield();
+			}
+		}
+		/*!
+		 * @brief End taking data out of a ring
+		 * @param ring Ring of a connector
+		 */
+		static void unlock(Ring &ring){
+			ring.busy.store(false, std::memory_order_release);
+		}
+
 	public:
-		static const int max_data_store = 20;
+		static const std::size_t capacity = Capacity; /*!< # of data stored per connector */
 
 		HotmockData(typename std::vector<DataType>::size_type size=0, unsigned short firstConnectorID=0);
 		~HotmockData();
@@ -133,10 +193,134 @@ namespace hotmock{
 		//void finalize();
 
 		bool isNew(unsigned short connectorID);
-		int setData(unsigned short connectorID, DataType value);
+		int setData(unsigned short connectorID, DataType value, unsigned long long time_ns = monotonicNanoseconds());
 
 		DataType getNextData(unsigned short connectorID);
+		DataType getNextData(unsigned short connectorID, unsigned long long &time_ns);
 		DataType getLatestData(unsigned short connectorID);
+		DataType getLatestData(unsigned short connectorID, unsigned long long &time_ns);
+		std::size_t drain(unsigned short connectorID, DataType *out, std::size_t max, unsigned long long *time_ns = NULL);
+		std::size_t discard(unsigned short connectorID);
+		unsigned long getOverflowCount(unsigned short connectorID);
+	};
+
+	/*!
+	 * @class HotmockSample
+	 * @brief One data value decoded from a message
+	 */
+	class HotmockSample{
+	public:
+		HotmockConnectorType type; /*!< Connector type */
+		unsigned short connectorID; /*!< Connector ID */
+		double value[3]; /*!< Data value (x,y,z for GS, value[0] for the others) */
+		unsigned long long time_ns; /*!< Monotonic time the data was received [ns] */
+	};
+
+	/*!
+	 * @brief Function called when a data value is decoded (see HotmockClient::subscribe())
+	 * @param sample decoded data value
+	 * @param context pointer given to subscribe()
+	 */
+	typedef void (*HotmockDataCallback)(const HotmockSample &sample, void *context);
+
+	/*!
+	 * @class HotmockSubscription
+	 * @brief Callback registered for a connector type or a connector
+	 */
+	class HotmockSubscription{
+	public:
+		HotmockDataCallback callback; /*!< NULL if not registered */
+		void *context; /*!< Passed to callback */
+	};
+
+	/*!
+	 * @class HotmockCommand
+	 * @brief Command handed from the execution context to I/O thread
+	 */
+	class HotmockCommand{
+	public:
+		HotmockClientCommand cmd; /*!< Command */
+		HotmockConnectorType type; /*!< Connector type */
+		unsigned short connectorID; /*!< Connector ID */
+		int param; /*!< Parameter for the command */
+	};
+
+	/*!
+	 * @class HotmockInFlight
+	 * @brief REQUESTs of a connector which are not answered yet.
+	 * Hotmock answers the requests of a connector in order, so each response is matched to the oldest outstanding request
+	 */
+	class HotmockInFlight{
+	public:
+		static const unsigned int max_window = 8; /*!< Upper limit of outstanding requests per connector */
+		unsigned int sent; /*!< # of requests sent (sequence number of the next request) */
+		unsigned int answered; /*!< # of requests answered (sequence number of the oldest outstanding request) */
+		int param[max_window]; /*!< Parameter of each outstanding request, indexed by sequence number % max_window */
+		unsigned long long deadline[max_window]; /*!< Time [ns] by which each outstanding request should be answered */
+		unsigned char retry[max_window]; /*!< # of retransmissions of each outstanding request */
+		unsigned long unmatched; /*!< # of responses arrived with no outstanding request */
+		HotmockTimerNode timer; /*!< Expires at the deadline of the oldest outstanding request */
+		HotmockConnectorType type; /*!< Connector type */
+		unsigned short connectorID; /*!< Connector ID */
+		std::atomic<unsigned long> timeouts; /*!< # of requests not answered by the deadline */
+		std::atomic<unsigned long> dropped; /*!< # of requests given up after the max # of retransmissions */
+
+		void reset(HotmockConnectorType connector_type, unsigned short id);
+
+		/*!
+		 * @brief Get # of outstanding requests
+		 * @return # of requests sent and not answered yet
+		 */
+		unsigned int outstanding() const {return sent - answered;}
+	};
+
+	/*!
+	 * @class HotmockCommandTemplate
+	 * @brief Precompiled bytes of a command up to the parameter (ex. "REQUEST,AI01,")
+	 */
+	class HotmockCommandTemplate{
+	public:
+		static const int max_size = 16; /*!< Longest template ("REQUEST,AI01," is 13 bytes) */
+		char bytes[max_size]; /*!< Command, connector type, connector ID and ',' */
+		unsigned char len; /*!< # of bytes in bytes[] */
+	};
+
+	/*!
+	 * @class HotmockCommandPlan
+	 * @brief Templates of one (command, connector type) combination, indexed by connector ID
+	 */
+	class HotmockCommandPlan{
+	public:
+		unsigned short firstConnectorID; /*!< ID number assigned to first connector */
+		unsigned int connectorNum; /*!< # of connectors */
+		std::vector<HotmockCommandTemplate> templates; /*!< Empty if the combination is invalid */
+		std::vector<int> pending; /*!< Latest parameter of OUTPUT/INIT issued while not connected (no_pending if none) */
+		static const int no_pending = -0x7fffffff; /*!< pending value meaning no command is waiting */
+	};
+
+	/*!
+	 * @class HotmockRecvStatus
+	 * @brief Statistics of the last recvDataFromHotmock() call
+	 */
+	class HotmockRecvStatus{
+	public:
+		unsigned int bytes; /*!< # of bytes received */
+		unsigned int frames; /*!< # of valid frames parsed */
+		unsigned int recv_calls; /*!< # of recv() calls */
+		bool buffer_full; /*!< true if draining stopped after reading one receive buffer size (the rest is read by the next call) */
+	};
+
+	/*!
+	 * @class HotmockSendStatus
+	 * @brief Statistics of the commands sent in the last batch (beginBatch() ... flush()).
+	 * In I/O thread mode flush() only hands the batch to the I/O thread: commands is the # of commands
+	 * queued by the batch and bytes and send_calls are 0 (see HotmockClient::getIOSendStatus())
+	 */
+	class HotmockSendStatus{
+	public:
+		unsigned int commands; /*!< # of commands written */
+		unsigned int bytes; /*!< # of bytes sent */
+		unsigned int send_calls; /*!< # of send() calls */
 	};
 
 	/*!
@@ -147,40 +331,178 @@ namespace hotmock{
 		HotmockConnectorInformation connector_info;
 
 		//communication
-		SOCKET sock;
-		WSADATA wsaData;
-		bool wsa_set;
-		std::string message; //message
-
-		int connectToHotmock(const char *ip, unsigned short port);
-		void parseMessage();
-
-		std::string HMConnectorTyepe2String(HotmockConnectorType type);
-		std::string HMClientCommand2String(HotmockClientCommand command);
+		HotmockTransport transport;
+
+		//connection state machine (driven by the thread which owns the socket)
+		std::string server_ip;
+		unsigned short server_port;
+		std::atomic<int> connection_state; //HotmockConnectionState
+		std::atomic<bool> connection_lost; //set when the connection is lost, reported once by recvDataFromHotmock()
+		std::atomic<unsigned long> reconnect_count; //# of connections established after a disconnection
+		bool ever_connected; //true after the first connection
+		unsigned long long reconnect_delay_ns; //backoff before the next connect attempt
+		unsigned long long reconnect_time_ns; //time of the next connect attempt
+		unsigned int jitter_seed; //state of the jitter generator
+		static const unsigned long long reconnect_min_delay_ns = 50000000ULL; /*!< First backoff (50ms) */
+		static const unsigned long long reconnect_max_delay_ns = 5000000000ULL; /*!< Upper limit of backoff (5s) */
+
+		//receive buffer (scratch area of each recv(); the chunk is parsed before the next recv() reuses it)
+		std::vector<char> recv_buffer;
+		std::vector<char>::size_type recv_buffer_size; //requested buffer size
+		unsigned long long recv_time_ns; //monotonic time of the last recv() which returned data
+		HotmockRecvStatus recv_status;
+
+		//command templates built by initialize()
+		static const int command_num = INIT+1; /*!< # of HotmockClientCommand values */
+		static const int connector_type_num = TS+1; /*!< # of HotmockConnectorType values */
+		HotmockCommandPlan command_plan[command_num][connector_type_num];
+
+		//subscriptions (invoked by the thread which parses the data)
+		static const unsigned int max_connector_id = 63; /*!< Largest connector ID which can be subscribed or marked ready */
+		HotmockSubscription type_subscription[connector_type_num]; //called for every connector of the type
+		HotmockSubscription connector_subscription[connector_type_num][max_connector_id+1]; //indexed by connector ID
+		std::atomic<unsigned long long> ready_mask[connector_type_num]; //bit n set if connector ID n has new data
+
+		//outstanding requests (owned by the thread which owns the socket)
+		std::unique_ptr<HotmockInFlight[]> in_flight[connector_type_num]; //indexed by connector ID - first connector ID
+		unsigned int in_flight_num[connector_type_num];
+		unsigned int request_window; //max # of outstanding requests per connector
+
+		//request timeouts
+		HotmockTimerWheel timer_wheel; //timers of HotmockInFlight
+		unsigned long long request_timeout_ns; //0: no timeout
+		unsigned int request_max_retry; //retransmissions before a request is given up
+		unsigned long long timer_now; //time passed to the timer callbacks
+
+		//send buffer (commands of one batch are sent with a single send())
+		static const int send_buffer_size = 4096; /*!< Size of the send buffer */
+		char send_buffer[send_buffer_size];
+		int send_len; //bytes waiting in send_buffer
+		bool batching; //true between beginBatch() and flush()
+		unsigned int batch_commands; //commands queued since beginBatch() (I/O thread mode, the I/O thread is woken up by flush())
+		HotmockSendStatus send_count; //counted by the thread which owns the socket
+		HotmockSendStatus send_status; //statistics of the last batch
+
+		//frame split across recv() calls
+		static const int max_frame_size = 64; /*!< Longest frame kept until its delimiter arrives */
+		char frame[max_frame_size]; //incomplete frame carried over to the next recv()
+		int frame_len; //bytes stored in frame
+		bool frame_overflow; //true while discarding a frame longer than max_frame_size
+
+		//I/O thread (optional)
+		bool io_thread_mode; //true if I/O thread owns the socket
+		bool io_external; //true if the I/O thread of HotmockClientManager drives this client instead of io_thread
+		HotmockPoller io_poller; //socket and wakeup of io_thread (the poller of HotmockClientManager is used if io_external)
+		std::thread io_thread;
+		std::atomic<bool> io_running;
+		std::atomic<unsigned int> io_bytes; //bytes received since last recvDataFromHotmock()
+		std::atomic<unsigned int> io_frames; //frames parsed since last recvDataFromHotmock()
+		std::atomic<unsigned int> io_recv_calls; //recv() calls since last recvDataFromHotmock()
+		std::atomic<unsigned int> io_send_commands; //commands sent since last getIOSendStatus()
+		std::atomic<unsigned int> io_send_bytes; //bytes sent since last getIOSendStatus()
+		std::atomic<unsigned int> io_send_calls; //send() calls since last getIOSendStatus()
+		SPSCQueue<HotmockCommand, 256> command_queue; //execution context -> I/O thread
+		static const int io_retry_wait_ms = 1; /*!< Wait before retrying to send data not accepted by the socket (or polling if the poller fails) */
+		static const int io_max_wait_ms = 1000; /*!< Max time I/O thread sleeps without any event */
+
+		void startConnect();
+		bool updateConnection(int timeout_ms);
+		void onConnected();
+		void handleDisconnect();
+		void scheduleReconnect();
+		void rearmRequests();
+		void sendPendingCommands();
+
+		void ioThreadMain();
+		void ioWakeup();
+		bool ioPrepare(int timeout_ms);
+		void ioReceive(int ready);
+		unsigned long long ioDeadline(unsigned long long now_ns) const;
+		int receiveData(HotmockRecvStatus &status);
+		int parseMessage(const char *buf, int len);
+		int parseFrame(const char *begin, const char *end);
+		int storeSample(const HotmockSample &sample);
+		int setSample(const HotmockSample &sample);
+		void notifySample(const HotmockSample &sample);
+
+		bool getConnectorRange(HotmockConnectorType type, unsigned short &firstConnectorID, unsigned int &connectorNum) const;
+		HotmockInFlight *getInFlight(HotmockConnectorType type, unsigned short connectorID) const;
+		void checkTimeouts();
+		void handleRequestTimeout(HotmockInFlight &requests);
+		void armRequestTimer(HotmockInFlight &requests);
+		static void requestTimeoutCallback(HotmockTimerNode *node, void *context);
+		void buildCommandPlan();
+		int checkCommand(HotmockClientCommand cmd, HotmockConnectorType type, unsigned short connectorID, int param);
+		int writeCommand(HotmockClientCommand cmd, HotmockConnectorType type, unsigned short connectorID, int param);
+		int appendCommand(const HotmockCommandTemplate &tmpl, int param);
+		int flushSendBuffer();
+
+		const char *HMConnectorTyepe2String(HotmockConnectorType type) const;
+		const char *HMClientCommand2String(HotmockClientCommand command) const;
+
+		friend class HotmockClientManager;
 	public:
+		static const unsigned int default_recv_buffer_size = 65536; /*!< Default size of the receive buffer */
+		static const unsigned int min_recv_buffer_size = 256; /*!< Smallest receive buffer */
+
 		HotmockClient();
 		~HotmockClient();
 		int initialize(HotmockBoardType hmtype, const char *ip="127.0.0.1", unsigned short port=8888);
 		void finalize();
 
+		void setRecvBufferSize(unsigned int size);
+		void setIOThreadMode(bool enable);
+		void setRequestWindow(unsigned int window);
+		void setRequestTimeout(unsigned int timeout_ms, unsigned int max_retry);
+
+		/*!
+		 * @brief Get state of the connection
+		 * @return Disconnected, Connecting or Connected
+		 */
+		HotmockConnectionState getConnectionState() const {return (HotmockConnectionState)connection_state.load();}
+		/*!
+		 * @brief Check if connected to Hotmock server (data is stale while not connected)
+		 * @return true if connected
+		 */
+		bool isConnected() const {return connection_state.load() == Connected;}
+		/*!
+		 * @brief Get # of connections established again after the connection was lost
+		 * @return # of reconnections
+		 */
+		unsigned long getReconnectCount() const {return reconnect_count.load();}
+		unsigned long getTimeoutCount(HotmockConnectorType type, unsigned short connectorID) const;
+		unsigned long getDroppedRequestCount(HotmockConnectorType type, unsigned short connectorID) const;
+		/*!
+		 * @brief Get statistics of the last recvDataFromHotmock() call
+		 * @return received bytes, parsed frames and recv() calls
+		 */
+		const HotmockRecvStatus &getRecvStatus() const {return recv_status;}
+
+		int subscribe(HotmockConnectorType type, unsigned short connectorID, HotmockDataCallback callback, void *context=NULL);
+		int unsubscribe(HotmockConnectorType type, unsigned short connectorID);
+		unsigned long long takeReadyConnectors(HotmockConnectorType type);
+
 		//bool isNewData(HotmockConnectorType type, unsigned short connectorID);
 		//int getData(HotmockConnectorType type, unsigned short connectorID);
 
 		int sendCommandToHotmock(HotmockClientCommand cmd, HotmockConnectorType type, unsigned short connectorID, int param=-1);
 		int recvDataFromHotmock();
 
-		//data
+		void beginBatch();
+		int flush();
+		/*!
+		 * @brief Get statistics of the last batch (beginBatch() ... flush())
+		 * @return # of commands, bytes and send() calls
+		 */
+		const HotmockSendStatus &getSendStatus() const {return send_status;}
+		HotmockSendStatus getIOSendStatus();
+
+		//data (written by the parser, read by the execution context; safe across I/O thread and the execution context)
 		HotmockData<unsigned char> DIData; /*< data from digital inputs */
 		HotmockData<double> PIData; /*< data from pulse inputs */
 		HotmockData<double> AIData; /*< data from analog inputs */
 		HotmockData<Vector3d> GSData; /*< data from accelerometers */
 		HotmockData<double> TSData; /*< data from temperature sensors */
-
-		//request acceptable or not
-		std::vector<bool> PIRequestAcceptable;
-		std::vector<bool> AIRequestAcceptable;
-		std::vector<bool> GSRequestAcceptable;
-		std::vector<bool> TSRequestAcceptable;
 	};
 
 	/*!
@@ -188,29 +510,37 @@ namespace hotmock{
 	 * @param size buffer size
 	 * @param firstconnectorID ID number assigned to first connector installed on the device
 	 */
-	template <class DataType>
-	HotmockData<DataType>::HotmockData(typename std::vector<DataType>::size_type size, unsigned short firstConnectorID){
-		initialize(firstConnectorID);
+	template <class DataType, std::size_t Capacity>
+	HotmockData<DataType, Capacity>::HotmockData(typename std::vector<DataType>::size_type size, unsigned short firstConnectorID){
+		data_size = 0;
+		initialize(size, firstConnectorID);
 	}
 
 	/*!
 	 * @brief Destructor
 	 */
-	template <class DataType>
-	HotmockData<DataType>::~HotmockData(){
+	template <class DataType, std::size_t Capacity>
+	HotmockData<DataType, Capacity>::~HotmockData(){
 	}
 
 	/*!
-	 * @brief Initialization
+	 * @brief Initialization (must not be called while producer or consumer is using the buffer)
 	 * @param size buffer size
 	 * @param firstconnectorID ID number assigned to first connector installed on the device
 	 * @return 0 if no error
 	 */
-	template <class DataType>
-	int HotmockData<DataType>::initialize(typename std::vector<DataType>::size_type size, unsigned short firstConnectorID){
+	template <class DataType, std::size_t Capacity>
+	int HotmockData<DataType, Capacity>::initialize(typename std::vector<DataType>::size_type size, unsigned short firstConnectorID){
 		index_offset = (int)firstConnectorID;
-		data.clear();
-		data.resize(size);
+		if(size != data_size){
+			data.reset((size > 0) ? new Ring[size] : NULL);
+			data_size = size;
+		}
+		for(typename std::vector<DataType>::size_type i=0;i<data_size;i++){
+			data[i].queue.clear();
+			data[i].overflow = 0;
+			data[i].busy = false;
+		}
 		return 0;
 	}
 
@@ -219,21 +549,17 @@ namespace hotmock{
 	 * @param connectorID Connector ID to be checked
 	 * @return true if new data stored, false if new data not arrived or invalid connector ID
 	 */
-	template <class DataType>
-	bool HotmockData<DataType>::isNew(unsigned short connectorID){
+	template <class DataType, std::size_t Capacity>
+	bool HotmockData<DataType, Capacity>::isNew(unsigned short connectorID){
 		int index = connectorID-index_offset;
 
 		//out of range
-		if(index<0 || index >= data.size()){
-			std::cerr << "Error in HotmockData::isNew(): out of range (" << connectorID << ")" << std::endl;
+		if(index<0 || index >= (int)data_size){
+			HMLOG_ERROR("Error in HotmockData::isNew(): out of range ({})", connectorID);
 			return false;
 		}
 
-		if(!data[index].empty()){
-			return true;
-		}else{
-			return false;
-		}
+		return !data[index].queue.empty();
 	}
 
 	/*!
@@ -241,13 +567,28 @@ namespace hotmock{
 	 * @param connectorID Connector ID to be read
 	 * @return stored data
 	 */
-	template <class DataType>
-	DataType HotmockData<DataType>::getNextData(unsigned short connectorID){
+	template <class DataType, std::size_t Capacity>
+	DataType HotmockData<DataType, Capacity>::getNextData(unsigned short connectorID){
+		unsigned long long time_ns;
+		return getNextData(connectorID, time_ns);
+	}
+
+	/*!
+	 * @brief Get data which is not read yet and the time it was received (should be used after checking if new data arrived using isNew())
+	 * @param connectorID Connector ID to be read
+	 * @param time_ns Monotonic time the data was received [ns] (0 if no data)
+	 * @return stored data
+	 */
+	template <class DataType, std::size_t Capacity>
+	DataType HotmockData<DataType, Capacity>::getNextData(unsigned short connectorID, unsigned long long &time_ns){
 		int index = connectorID-index_offset;
+		Entry entry = Entry();
 
-		DataType value = data[index].front();
-		data[index].pop_front();
-		return value;
+		lock(data[index]);
+		data[index].queue.pop(entry);
+		unlock(data[index]);
+		time_ns = entry.time_ns;
+		return entry.value;
 	}
 
 	/*!
@@ -255,33 +596,127 @@ namespace hotmock{
 	 * @param connectorID Connector ID to be read
 	 * @return stored data
 	 */
-	template <class DataType>
-	DataType HotmockData<DataType>::getLatestData(unsigned short connectorID){
+	template <class DataType, std::size_t Capacity>
+	DataType HotmockData<DataType, Capacity>::getLatestData(unsigned short connectorID){
+		unsigned long long time_ns;
+		return getLatestData(connectorID, time_ns);
+	}
+
+	/*!
+	 * @brief Get the latest data and the time it was received. Old data is erased (should be used after checking if new data arrived using isNew())
+	 * @param connectorID Connector ID to be read
+	 * @param time_ns Monotonic time the data was received [ns] (0 if no data)
+	 * @return stored data
+	 */
+	template <class DataType, std::size_t Capacity>
+	DataType HotmockData<DataType, Capacity>::getLatestData(unsigned short connectorID, unsigned long long &time_ns){
 		int index = connectorID-index_offset;
-		DataType value = data[index].back();
-		data[index].clear();
-		return value;
+		Entry entry = Entry();
+
+		lock(data[index]);
+		data[index].queue.popLatest(entry);
+		unlock(data[index]);
+		time_ns = entry.time_ns;
+		return entry.value;
 	}
 
 	/*!
-	 * @brief Set data to buffer
+	 * @brief Get all data which is not read yet, in order of arrival
+	 * @param connectorID Connector ID to be read
+	 * @param out Destination array
+	 * @param max Size of the destination array
+	 * @param time_ns Destination array of the monotonic receive time [ns] of each data (not stored if NULL)
+	 * @return # of data stored in out (0 if invalid connector ID)
+	 */
+	template <class DataType, std::size_t Capacity>
+	std::size_t HotmockData<DataType, Capacity>::drain(unsigned short connectorID, DataType *out, std::size_t max, unsigned long long *time_ns){
+		int index = connectorID-index_offset;
+		Entry entry;
+		std::size_t n = 0;
+
+		if(index<0 || index >= (int)data_size){
+			HMLOG_ERROR("Error in HotmockData::drain(): out of range ({})", connectorID);
+			return 0;
+		}
+		lock(data[index]);
+		while(n < max && data[index].queue.pop(entry)){
+			out[n] = entry.value;
+			if(time_ns != NULL){
+				time_ns[n] = entry.time_ns;
+			}
+			n++;
+		}
+		unlock(data[index]);
+		return n;
+	}
+
+	/*!
+	 * @brief Erase all data which is not read yet (for connectors whose data is not used)
+	 * @param connectorID Connector ID
+	 * @return # of data erased (0 if invalid connector ID)
+	 */
+	template <class DataType, std::size_t Capacity>
+	std::size_t HotmockData<DataType, Capacity>::discard(unsigned short connectorID){
+		int index = connectorID-index_offset;
+
+		if(index<0 || index >= (int)data_size){
+			HMLOG_ERROR("Error in HotmockData::discard(): out of range ({})", connectorID);
+			return 0;
+		}
+		lock(data[index]);
+		std::size_t n = data[index].queue.discard();
+		unlock(data[index]);
+		return n;
+	}
+
+	/*!
+	 * @brief Get # of old data dropped because the buffer was full
+	 * @param connectorID Connector ID
+	 * @return # of dropped data (0 if invalid connector ID)
+	 */
+	template <class DataType, std::size_t Capacity>
+	unsigned long HotmockData<DataType, Capacity>::getOverflowCount(unsigned short connectorID){
+		int index = connectorID-index_offset;
+
+		if(index<0 || index >= (int)data_size){
+			return 0;
+		}
+		return data[index].overflow.load(std::memory_order_relaxed);
+	}
+
+	/*!
+	 * @brief Set data to buffer. If the buffer is full, the oldest data is dropped to make room
 	 * @param connectorID Connector ID cooresponding to the buffer
 	 * @param value Data to be set
-	 * @return 0 if no error, -1 out of range
+	 * @param time_ns Monotonic time the data was received [ns]
+	 * @return 0 if no error, -1 out of range, -2 buffer full (data stored, the oldest data dropped)
 	 */
-	template <class DataType>
-	int HotmockData<DataType>::setData(unsigned short connectorID, DataType value){
+	template <class DataType, std::size_t Capacity>
+	int HotmockData<DataType, Capacity>::setData(unsigned short connectorID, DataType value, unsigned long long time_ns){
 		int index = connectorID-index_offset;
+		Entry entry;
 
-		if(index<0 || index >= data.size()){
-			std::cerr << "Error in HotmockData::setData(): out of range (" << connectorID << ")" << std::endl;
+		if(index<0 || index >= (int)data_size){
+			HMLOG_ERROR("Error in HotmockData::setData(): out of range ({})", connectorID);
 			return -1;
 		}
 
-		while(data[index].size()>=max_data_store){
-			data[index].pop_front();
+		entry.value = value;
+		entry.time_ns = time_ns;
+		if(data[index].queue.push(entry)){
+			return 0;
+		}
+
+		//full: drop the oldest data (the consumer may have taken data out in the meantime)
+		Entry oldest;
+		lock(data[index]);
+		bool dropped = data[index].queue.pop(oldest);
+		unlock(data[index]);
+		data[index].queue.push(entry); //only this thread pushes, so there is room now
+		if(dropped){
+			data[index].overflow.fetch_add(1, std::memory_order_relaxed);
+			return -2;
 		}
-		data[index].push_back(value);
 		return 0;
 	}
 };
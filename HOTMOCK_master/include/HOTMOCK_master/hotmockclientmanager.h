@@ -0,0 +1,90 @@
+// -*- C++ -*-
+/*!
+ * @file  hotmockclientmanager.h
+ * @brief manager of the hotmock clients of several boards (one event loop for all connections)
+ * @date $Date$
+ *
+ */
+#ifndef HOTMOCKCLIENTMANAGER_H
+#define HOTMOCKCLIENTMANAGER_H
+
+#include "hotmockclient.h"
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace hotmock{
+
+	/*!
+	 * @class HotmockClientManager
+	 * @brief Owns one HotmockClient per board (each with its own connector map and data buffers)
+	 * and drives all of their connections from one loop: the caller's thread, or one shared I/O thread
+	 */
+	class HotmockClientManager{
+		std::vector< std::unique_ptr<HotmockClient> > clients;
+		HotmockPoller poller; //one epoll set watching the sockets of all clients (index = board index)
+		bool ready[HotmockPoller::max_transports]; //result of poller.wait()
+
+		//settings applied to the clients added by addBoard()
+		unsigned int recv_buffer_size;
+		bool io_thread_mode;
+		unsigned int request_window;
+		unsigned int request_timeout_ms;
+		unsigned int request_max_retry;
+
+		//shared I/O thread (optional)
+		std::thread io_thread;
+		std::atomic<bool> io_running;
+
+		//event signalled when the shared I/O thread parsed data (see waitEvent())
+		std::mutex event_mutex;
+		std::condition_variable event_cond;
+		std::atomic<bool> event_pending;
+
+		HotmockClientManager(const HotmockClientManager &);
+		HotmockClientManager &operator=(const HotmockClientManager &);
+
+		void ioThreadMain();
+	public:
+		static const unsigned int max_boards = 16; /*!< Max # of boards */
+
+		HotmockClientManager();
+		~HotmockClientManager();
+
+		void setRecvBufferSize(unsigned int size);
+		void setIOThreadMode(bool enable);
+		void setRequestWindow(unsigned int window);
+		void setRequestTimeout(unsigned int timeout_ms, unsigned int max_retry);
+
+		int addBoard(HotmockBoardType hmtype, const char *ip, unsigned short port);
+		int start();
+		void finalize();
+
+		/*!
+		 * @brief Get # of boards
+		 * @return # of boards added by addBoard()
+		 */
+		unsigned int getBoardNum() const {return (unsigned int)clients.size();}
+
+		/*!
+		 * @brief Get client of a board
+		 * @param board board index returned by addBoard()
+		 * @return client (commands and data of the board)
+		 */
+		HotmockClient &getClient(unsigned int board) {return *clients[board];}
+
+		bool isConnected() const;
+		void beginBatch();
+		int flush();
+		int recvDataFromHotmock();
+
+		bool waitEvent(int timeout_ms);
+		void notifyEvent();
+	};
+
+};
+#endif
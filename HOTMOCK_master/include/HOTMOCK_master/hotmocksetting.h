@@ -1,25 +1,52 @@
-#ifndef WIN32
-#define WIN32
-#endif
-
 #ifndef HOTMOCKSETTING_H
 #define HOTMOCKSETTING_H
 
 #include <string>
 #include <vector>
-
-#import "msxml6.dll" raw_interfaces_only
+#include <cstddef>
 
 namespace hotmock{
 
+	/*!
+	 * @enum HotmockPlanCache
+	 * @brief |[g\(port plan)̃LbV̎g
+	 */
+	enum HotmockPlanCache{
+		PlanCacheOff, /*!< LbVgpXML͂ */
+		PlanCacheMemory, /*!< vZX̃LbVgp */
+		PlanCacheFile, /*!< vZX̃LbV.hmstt@Cׂ̗.plant@Cgp */
+		PlanCacheRebuild /*!< LbVgpɉ͂ALbV.plant@C蒼 */
+	};
+
+	/*!
+	 * @class HotmockSetting
+	 * @brief HOTMOCKSetting̐ݒt@C(.hmst)gp{[ȟ^ƃRlN^擾
+	 *
+	 * .hmstt@Cɓǂݍ݁A܂܂ĂeXML
+	 * device_name,idvf݂̂o(ꎞt@C,MSXML͎gpȂ)B
+	 * ͌(|[g\).hmstt@C̓ẽnbVl(FNV-1a)
+	 * L[ƂăLbVAeςȂΉ͂ȗB
+	 * LbV̂̓{[ȟ^Axmlt@CƎgptO(useIDFlagList)݂̂ŁA
+	 * |[g̖ORlN^Ƃ̑Ή͂ɌĂяo(onActivated)쐬B
+	 */
 	class HotmockSetting{
 
 	public:
 		std::string hmstFilename; //hmstt@C̖O
 		std::vector<std::string> configFilenameList; //hmstt@C̐擪ɋLqĂxmlt@C̖Oꗗ
 		std::vector<std::vector<unsigned short>> useIDFlagList; //gpĂID1,łȂ0
-		MSXML2::IXMLDOMDocumentPtr Doc;
 		std::string boardType;
+		unsigned long long contentHash; //hmstt@C̓ẽnbVl(FNV-1a 64bit)
+		bool fromCache; //setPort()ŃLbV|[g\擾ꍇtrue
+
+	private:
+		std::string hmstData; //hmstt@C̓e
+		std::vector<std::size_t> configBeginList; //hmstDatåeXML̊Jnʒu(configFilenameList̏)
+		std::vector<std::size_t> configEndList; //hmstDatåeXML̏Iʒu
+		HotmockPlanCache planCache;
+
+		void encodePlan(std::string &plan) const;
+		bool decodePlan(const std::string &plan);
 
 	 public:
 		HotmockSetting();
@@ -27,6 +54,7 @@ namespace hotmock{
 		int initialize(std::string hmst);
 		void finalize();
 		int setPort();
+		void setPlanCache(HotmockPlanCache mode);
 	};
 
 };
@@ -0,0 +1,109 @@
+// -*- C++ -*-
+/*!
+ * @file  hotmocktimer.h
+ * @brief monotonic clock and timing wheel used for request timeouts
+ * @date $Date$
+ *
+ */
+#ifndef HOTMOCKTIMER_H
+#define HOTMOCKTIMER_H
+
+#include <chrono>
+
+namespace hotmock{
+
+	/*!
+	 * @brief Get monotonic time (not affected by changes of the system clock)
+	 * @return time [ns] from an arbitrary origin
+	 */
+	inline unsigned long long monotonicNanoseconds(){
+		return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/*!
+	 * @brief Get offset from monotonic time to wall clock time (UNIX time).
+	 * Monotonic time t is converted to wall clock time by t + offset
+	 * @return offset [ns]
+	 */
+	inline long long clockOffsetNanoseconds(){
+		long long wall = (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+		return wall - (long long)monotonicNanoseconds();
+	}
+
+	/*!
+	 * @brief Convert a deadline to the timeout of a waiting function (rounded up so that the wait does not end early)
+	 * @param deadline_ns deadline [ns] (monotonicNanoseconds())
+	 * @param now_ns current time [ns] (monotonicNanoseconds())
+	 * @return timeout [ms] (0 if the deadline has passed)
+	 */
+	inline int timeoutMilliseconds(unsigned long long deadline_ns, unsigned long long now_ns){
+		if(deadline_ns <= now_ns){
+			return 0;
+		}
+		unsigned long long diff = deadline_ns - now_ns;
+		unsigned long long ms = diff / 1000000ULL + ((diff % 1000000ULL) ? 1 : 0);
+		return (ms > 0x7fffffffULL) ? 0x7fffffff : (int)ms;
+	}
+
+	/*!
+	 * @class HotmockTimerNode
+	 * @brief Timer embedded in the object to be timed (no allocation when scheduled)
+	 */
+	class HotmockTimerNode{
+	public:
+		HotmockTimerNode *prev; /*!< Previous node in the slot (NULL if not scheduled) */
+		HotmockTimerNode *next; /*!< Next node in the slot (NULL if not scheduled) */
+		unsigned long long expire_tick; /*!< Tick at which the timer expires */
+		void *data; /*!< Object which owns the timer */
+	};
+
+	/*!
+	 * @class HotmockTimerWheel
+	 * @brief Hashed timing wheel. Scheduling and cancelling cost O(1), and advance() visits only the slots of
+	 * the ticks elapsed since the last call (at most slot_num slots), independent of the number of timers
+	 */
+	class HotmockTimerWheel{
+	public:
+		static const unsigned int slot_num = 256; /*!< # of slots (one tick each) */
+
+		/*!
+		 * @brief Function called for each expired timer. The timer is already unscheduled and may be scheduled again
+		 */
+		typedef void (*ExpireFunc)(HotmockTimerNode *node, void *context);
+
+	private:
+		HotmockTimerNode slots[slot_num]; //sentinels of circular lists
+		unsigned long long tick_ns; //length of one tick
+		unsigned long long current_tick; //last tick processed by advance()
+		unsigned int count; //# of scheduled timers
+
+		HotmockTimerWheel(const HotmockTimerWheel &);
+		HotmockTimerWheel &operator=(const HotmockTimerWheel &);
+
+	public:
+		HotmockTimerWheel(unsigned long long tick = 1000000ULL);
+
+		void reset(unsigned long long now_ns);
+		void schedule(HotmockTimerNode *node, unsigned long long deadline_ns);
+		void cancel(HotmockTimerNode *node);
+		void advance(unsigned long long now_ns, ExpireFunc func, void *context);
+		unsigned long long nextDeadline() const;
+
+		/*!
+		 * @brief Check if timer is scheduled
+		 * @param node Timer
+		 * @return true if scheduled
+		 */
+		static bool isScheduled(const HotmockTimerNode *node) {return node->next != NULL;}
+
+		/*!
+		 * @brief Get # of scheduled timers
+		 * @return # of timers
+		 */
+		unsigned int size() const {return count;}
+	};
+
+};
+#endif
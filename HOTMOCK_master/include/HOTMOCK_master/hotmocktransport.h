@@ -0,0 +1,136 @@
+// -*- C++ -*-
+/*!
+ * @file  hotmocktransport.h
+ * @brief TCP transport used by hotmock client (Winsock or POSIX/epoll backend)
+ * @date $Date$
+ *
+ * The backend is selected at build time:
+ * HOTMOCK_TRANSPORT_EPOLL defined -> POSIX non-blocking socket + epoll (Linux)
+ * otherwise                      -> Winsock
+ *
+ */
+#ifndef HOTMOCKTRANSPORT_H
+#define HOTMOCKTRANSPORT_H
+
+#ifndef HOTMOCK_TRANSPORT_EPOLL
+//needed for socket
+#include <winsock2.h> //must be included before #include <windows.h>
+#include <ws2tcpip.h> //must be included before #include <windows.h>
+#include <windows.h>
+#endif
+
+#include <cstddef>
+#include <atomic>
+
+namespace hotmock{
+
+	class HotmockPoller;
+
+	/*!
+	 * @class HotmockTransport
+	 * @brief Non-blocking TCP connection to Hotmock server
+	 */
+	class HotmockTransport{
+#ifdef HOTMOCK_TRANSPORT_EPOLL
+		int sock; //socket descriptor
+#else
+		SOCKET sock;
+		WSADATA wsaData;
+		bool wsa_set;
+#endif
+		bool connected; //false while connect() is in progress
+		HotmockPoller *poller; //poller which watches sock (NULL if not attached)
+		unsigned int poller_index; //index reported by the poller
+
+		friend class HotmockPoller;
+	public:
+		HotmockTransport();
+		~HotmockTransport();
+
+		int open(const char *ip, unsigned short port);
+		int finishConnect(int timeout_ms);
+		void close();
+		bool isOpen() const;
+		/*!
+		 * @brief Check if connection is established
+		 * @return true if connected
+		 */
+		bool isConnected() const {return connected;}
+
+		void attach(HotmockPoller *p, unsigned int index);
+		/*!
+		 * @brief Get the poller which watches the socket
+		 * @return poller given to attach() (NULL if not attached)
+		 */
+		HotmockPoller *getPoller() const {return poller;}
+		int wait(int timeout_ms);
+		int send(const char *buf, int len);
+		int recv(char *buf, int len);
+	};
+
+	/*!
+	 * @class HotmockPoller
+	 * @brief Waits for several transports at once (one epoll set on POSIX, one select() on Winsock).
+	 * An attached transport adds its socket when it is opened and removes it when it is closed,
+	 * so only open sockets are watched: readable if connected, writable (connect finished) if connecting.
+	 * wakeup() (eventfd on POSIX, a loopback UDP socket on Winsock) ends wait() from any thread,
+	 * so the waiting thread can sleep until an event occurs
+	 */
+	class HotmockPoller{
+	public:
+		static const unsigned int max_transports = 32; /*!< Max # of transports attached to a poller */
+
+	private:
+#ifdef HOTMOCK_TRANSPORT_EPOLL
+		int epfd; //epoll instance watching the sockets of the attached transports
+		int wake_fd; //eventfd written by wakeup()
+#else
+		SOCKET wake_sock; //UDP socket connected to itself, written by wakeup()
+		WSADATA wsaData;
+		bool wsa_set;
+#endif
+		HotmockTransport *transports[max_transports]; //attached transport of each index (NULL if none)
+		std::atomic<bool> wake_pending; //wakeup() signalled and not consumed by wait() yet
+
+		HotmockPoller(const HotmockPoller &);
+		HotmockPoller &operator=(const HotmockPoller &);
+
+		void watch(HotmockTransport *transport);
+		void unwatch(HotmockTransport *transport);
+		void consumeWakeup();
+
+		friend class HotmockTransport;
+	public:
+		HotmockPoller();
+		~HotmockPoller();
+
+		int open();
+		void close();
+		int wait(bool *ready, unsigned int num, int timeout_ms);
+		void wakeup();
+	};
+
+	/*!
+	 * @brief Let a poller watch the socket (from now on, and every time the socket is opened again)
+	 * @param p poller (NULL: detach from the current poller)
+	 * @param index index of this transport reported by HotmockPoller::wait() (less than HotmockPoller::max_transports)
+	 */
+	inline void HotmockTransport::attach(HotmockPoller *p, unsigned int index){
+		if(poller != NULL){
+			if(isOpen()){
+				poller->unwatch(this);
+			}
+			poller->transports[poller_index] = NULL;
+		}
+		poller = (index < HotmockPoller::max_transports) ? p : NULL;
+		poller_index = index;
+		if(poller != NULL){
+			poller->transports[index] = this;
+			if(isOpen()){
+				poller->watch(this);
+			}
+		}
+	}
+
+};
+#endif
@@ -0,0 +1,139 @@
+// -*- C++ -*-
+/*!
+ * @file  spscqueue.h
+ * @brief lock-free single-producer/single-consumer queue
+ * @date $Date$
+ *
+ */
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+namespace hotmock{
+
+	/*!
+	 * @class SPSCQueue
+	 * @brief Fixed-capacity lock-free queue for one producer thread and one consumer thread
+	 *
+	 * push() must be called only from the producer thread, pop() only from the consumer thread.
+	 * No memory is allocated after construction.
+	 */
+	template <class DataType, std::size_t Capacity>
+	class SPSCQueue{
+		static_assert(Capacity >= 2 && (Capacity & (Capacity-1)) == 0, "SPSCQueue capacity must be a power of 2");
+
+		DataType buf[Capacity];
+		std::atomic<std::size_t> head; //next slot to be written (producer)
+		char pad[64]; //keep head and tail on different cache lines
+		std::atomic<std::size_t> tail; //next slot to be read (consumer)
+
+		SPSCQueue(const SPSCQueue &);
+		SPSCQueue &operator=(const SPSCQueue &);
+
+	public:
+		SPSCQueue() : head(0), tail(0) {}
+
+		/*!
+		 * @brief Add data (producer only)
+		 * @param value Data to be added
+		 * @return true if no error, false if queue is full
+		 */
+		bool push(const DataType &value){
+			std::size_t h = head.load(std::memory_order_relaxed);
+			if(h - tail.load(std::memory_order_acquire) >= Capacity){
+				return false;
+			}
+			buf[h & (Capacity-1)] = value;
+			head.store(h+1, std::memory_order_release);
+			return true;
+		}
+
+		/*!
+		 * @brief Take out the oldest data (consumer only)
+		 * @param value Data taken out
+		 * @return true if no error, false if queue is empty
+		 */
+		bool pop(DataType &value){
+			std::size_t t = tail.load(std::memory_order_relaxed);
+			if(t == head.load(std::memory_order_acquire)){
+				return false;
+			}
+			value = buf[t & (Capacity-1)];
+			tail.store(t+1, std::memory_order_release);
+			return true;
+		}
+
+		/*!
+		 * @brief Take out the newest data and discard the older ones (consumer only)
+		 * @param value Newest data
+		 * @return true if no error, false if queue is empty
+		 */
+		bool popLatest(DataType &value){
+			std::size_t t = tail.load(std::memory_order_relaxed);
+			std::size_t h = head.load(std::memory_order_acquire);
+			if(t == h){
+				return false;
+			}
+			value = buf[(h-1) & (Capacity-1)];
+			tail.store(h, std::memory_order_release);
+			return true;
+		}
+
+		/*!
+		 * @brief Take out data in order of arrival (consumer only)
+		 * @param out Destination array
+		 * @param max Size of the destination array
+		 * @return # of data taken out
+		 */
+		std::size_t drain(DataType *out, std::size_t max){
+			std::size_t t = tail.load(std::memory_order_relaxed);
+			std::size_t n = head.load(std::memory_order_acquire) - t;
+			if(n > max){
+				n = max;
+			}
+			for(std::size_t i=0;i<n;i++){
+				out[i] = buf[(t+i) & (Capacity-1)];
+			}
+			tail.store(t+n, std::memory_order_release);
+			return n;
+		}
+
+		/*!
+		 * @brief Discard all stored data (consumer only)
+		 * @return # of data discarded
+		 */
+		std::size_t discard(){
+			std::size_t t = tail.load(std::memory_order_relaxed);
+			std::size_t h = head.load(std::memory_order_acquire);
+			tail.store(h, std::memory_order_release);
+			return h - t;
+		}
+
+		/*!
+		 * @brief Get # of stored data (approximate when called from the producer)
+		 * @return # of data
+		 */
+		std::size_t size() const{
+			return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+		}
+
+		/*!
+		 * @brief Check if queue is empty (approximate when called from the producer)
+		 * @return true if empty
+		 */
+		bool empty() const{
+			return tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire);
+		}
+
+		/*!
+		 * @brief Discard all data (only when neither thread is using the queue)
+		 */
+		void clear(){
+			tail.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+	};
+
+};
+#endif
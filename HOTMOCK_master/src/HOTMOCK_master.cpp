@@ -12,6 +12,10 @@
 
 #include "HOTMOCK_master.h"
 
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
 // Module specification
 // <rtc-template block="module_spec">
 static const char* hotmock_master_spec[] =
@@ -32,34 +36,205 @@ static const char* hotmock_master_spec[] =
     "conf.default.IPAddress", "127.0.0.1",
     "conf.default.PortNumber", "8888",
     "conf.default.GetDataType", "0,0,0,0",
+    "conf.default.RecvBufferSize", "65536",
+    "conf.default.IOThread", "0",
+    "conf.default.RequestWindow", "1",
+    "conf.default.RequestTimeout", "500",
+    "conf.default.RequestMaxRetry", "3",
+    "conf.default.LogLevel", "INFO",
+    "conf.default.DataTrigger", "0",
+    "conf.default.TriggerMinInterval", "1000",
+    "conf.default.TriggerMaxInterval", "100",
+    "conf.default.AggregatePorts", "0",
+    "conf.default.BatchPublish", "0",
+    "conf.default.PublishDeadband", "-1,-1,-1,-1",
+    "conf.default.PublishRelativeDeadband", "0,0,0,0",
+    "conf.default.PublishMinInterval", "0,0,0,0",
+    "conf.default.PublishMaxInterval", "0,0,0,0",
+    "conf.default.PlanCache", "1",
+    "conf.default.WatchSetting", "0",
+    "conf.default.WatchInterval", "500",
     // Widget
     "conf.__widget__.SettingFilename", "text",
     "conf.__widget__.IPAddress", "text",
     "conf.__widget__.PortNumber", "text",
     "conf.__widget__.GetDataType", "ordered_list",
+    "conf.__widget__.RecvBufferSize", "text",
+    "conf.__widget__.IOThread", "radio",
+    "conf.__widget__.RequestWindow", "text",
+    "conf.__widget__.RequestTimeout", "text",
+    "conf.__widget__.RequestMaxRetry", "text",
+    "conf.__widget__.LogLevel", "radio",
+    "conf.__widget__.DataTrigger", "radio",
+    "conf.__widget__.TriggerMinInterval", "text",
+    "conf.__widget__.TriggerMaxInterval", "text",
+    "conf.__widget__.AggregatePorts", "radio",
+    "conf.__widget__.BatchPublish", "radio",
+    "conf.__widget__.PublishDeadband", "text",
+    "conf.__widget__.PublishRelativeDeadband", "text",
+    "conf.__widget__.PublishMinInterval", "text",
+    "conf.__widget__.PublishMaxInterval", "text",
+    "conf.__widget__.PlanCache", "radio",
+    "conf.__widget__.WatchSetting", "radio",
+    "conf.__widget__.WatchInterval", "text",
     // Constraints
+    "conf.__constraints__.IOThread", "(0,1)",
+    "conf.__constraints__.RequestWindow", "1<=x<=8",
+    "conf.__constraints__.RequestTimeout", "0<=x",
+    "conf.__constraints__.RequestMaxRetry", "0<=x<=10",
+    "conf.__constraints__.LogLevel", "(OFF,ERROR,WARN,INFO,DEBUG)",
+    "conf.__constraints__.DataTrigger", "(0,1)",
+    "conf.__constraints__.TriggerMinInterval", "0<=x",
+    "conf.__constraints__.TriggerMaxInterval", "1<=x",
+    "conf.__constraints__.AggregatePorts", "(0,1)",
+    "conf.__constraints__.BatchPublish", "(0,1)",
+    "conf.__constraints__.PlanCache", "(0,1,2,3)",
+    "conf.__constraints__.WatchSetting", "(0,1)",
+    "conf.__constraints__.WatchInterval", "100<=x",
     ""
   };
 // </rtc-template>
 
+/*!
+ * @class HotmockChannelKindInfo
+ * @brief チャンネルの種類ごとの設定
+ */
+struct HotmockChannelKindInfo
+{
+  const char *configFilename; /*!< .hmstファイル内の設定の名前 */
+  unsigned short idNum; /*!< HOTMOCKSettingで設定できるIDの最大数 */
+  unsigned short portOffset[2]; /*!< ポート番号 = (設定内の順番) + portOffset[ボードの型(0:digital,1:analog)] */
+};
+
+/*!
+ * チャンネルの種類(HotmockChannelKindの順)ごとの設定。
+ * ソケット通信用のIDは常に(設定内の順番)+1。
+ * DO,AIのみデバイス本体の表示とHOTMOCKSettingの表示が異なるため、
+ * ポート番号(デバイス本体の表示)のオフセットがボードの型によって異なる。
+ */
+static const HotmockChannelKindInfo channel_kind_info[channel_kind_num] =
+  {
+    {"DO_Config.xml", 16, {1, 2}}, //!アナログボードの場合、デバイス表示名はDO7から開始する(ソケット通信用のIDはDO06から)
+    {"AO_Config.xml", 2, {1, 1}},
+    {"PI_Config.xml", 2, {1, 1}},
+    {"DI_Config.xml", 32, {1, 1}},
+    {"AI_Config.xml", 6, {1, 0}}, //!アナログボードの場合、デバイス表示名はAI1から開始する(ソケット通信用のIDはAI02から)
+  };
+
+/*!
+ * DynamicInPort/DynamicOutPortにn個のポートを追加する。
+ * 同じ種類のポートのデータとポートは連続した領域にまとめて確保される。
+ */
+template <class PortType>
+static void addPorts(PortType &port, unsigned int n)
+{
+  port.reserve(n);
+  for(unsigned int i=0;i<n;i++){
+	port.addPort();
+  }
+}
+
+/*!
+ * DIAll,AIAll,PIAllの値の要素数をnumにする。追加した要素は0にする。
+ */
+template <class SeqType>
+static void resizeAggregate(SeqType &seq, unsigned int num)
+{
+  unsigned int last = seq.data.length();
+  seq.data.length(num);
+  for(unsigned int i=last;i<num;i++){
+	seq.data[i] = 0;
+  }
+}
+
+/*!
+ * チャンネルの構成が変わったとき、DIAll,AIAll,PIAllの値を新しい位置へ移す。
+ * 前回も使用していたチャンネル(種類とポート番号が同じ)は最後の値を引き継ぎ、
+ * 新しいチャンネルは0にする。lastListは前回のchannelList。
+ */
+template <class SeqType>
+static void moveAggregate(SeqType &seq, const std::vector<HotmockChannel> &lastList,
+                          const HotmockChannel *channels, unsigned int num, HotmockChannelKind kind)
+{
+  decltype(seq.data) last(seq.data);
+
+  seq.data.length(num);
+  for(unsigned int i=0;i<num;i++){
+	seq.data[i] = 0;
+	unsigned int k = 0; //前回の値の要素番号(lastList内の同じ種類のチャンネルの順番)
+	for(unsigned int j=0;j<lastList.size();j++){
+		if(lastList[j].kind!=kind){
+			continue;
+		}
+		if(lastList[j].portNo==channels[i].portNo){
+			if(k < last.length()){
+				seq.data[i] = last[k];
+			}
+			break;
+		}
+		k++;
+	}
+  }
+}
+
+/*!
+ * @brief constructor
+ * @param prefix ポート名の接頭辞(1台目は"")
+ */
+HotmockBoard::HotmockBoard(const std::string &prefix)
+  : prefix(prefix),
+    board(-1),
+    planHash(0),
+    m_DOIn((prefix + "DO").c_str()),
+    m_AOIn((prefix + "AO").c_str()),
+    m_Reset_PIIn((prefix + "Reset_PI").c_str()),
+    m_DIOut((prefix + "DI").c_str()),
+    m_AIOut((prefix + "AI").c_str()),
+    m_PIOut((prefix + "PI").c_str()),
+    m_TSOut((prefix + "TS").c_str(), m_TS),
+    m_GSOut((prefix + "GS").c_str(), m_GS),
+    m_StaleOut((prefix + "Stale").c_str(), m_Stale),
+    m_DIAllOut((prefix + "DIAll").c_str(), m_DIAll),
+    m_AIAllOut((prefix + "AIAll").c_str(), m_AIAll),
+    m_PIAllOut((prefix + "PIAll").c_str(), m_PIAll),
+    aggregate(false),
+    m_AIBatchOut((prefix + "AIBatch").c_str()),
+    m_PIBatchOut((prefix + "PIBatch").c_str()),
+    m_GSBatchOut((prefix + "GSBatch").c_str(), m_GSBatch),
+    batch(false),
+    m_PublishCountOut((prefix + "PublishCount").c_str(), m_PublishCount),
+    publishCountChanged(false),
+    publishCountTime_ns(0)
+{
+  for(int i=0;i<4;i++){
+	publishedCount[i] = 0;
+	suppressedCount[i] = 0;
+  }
+  for(int i=0;i<=channel_kind_num;i++){
+	channelBegin[i] = 0;
+  }
+}
+
+/*!
+ * @brief destructor
+ */
+HotmockBoard::~HotmockBoard()
+{
+}
+
 /*!
  * @brief constructor
  * @param manager Maneger Object
  */
 HOTMOCK_master::HOTMOCK_master(RTC::Manager* manager)
     // <rtc-template block="initializer">
-  : RTC::DataFlowComponentBase(manager),
-    m_DOIn("DO"),
-    m_AOIn("AO"),
-    m_Reset_PIIn("Reset_PI"),
-    m_DIOut("DI"),
-    m_AIOut("AI"),
-    m_PIOut("PI"),
-    m_TSOut("TS", m_TS),
-    m_GSOut("GS", m_GS)
+  : RTC::DataFlowComponentBase(manager)
 
     // </rtc-template>
 {
+  m_triggerRunning = false;
+  m_watchRunning = false;
+  m_reloadPending = false;
 }
 
 /*!
@@ -79,35 +254,8 @@ RTC::ReturnCode_t HOTMOCK_master::onInitialize()
   // <rtc-template block="registration">
   // Set Port buffers
 
-  // HOTMOCKSettingで設定できる最大数のポートをRTCへ登録する
-  for(int i=0;i<16;i++){
-	m_DOIn.addPort();
-	lastFlagList_DO.push_back(0);
-  }
-
-  for(int i=0;i<2;i++){
-	m_AOIn.addPort();
-	lastFlagList_AO.push_back(0);
-  }
-
-  for(int i=0;i<2;i++){
-	m_Reset_PIIn.addPort();
-	m_PIOut.addPort();
-	lastFlagList_PI.push_back(0);
-  }
-
-  for(int i=0;i<32;i++){
-	m_DIOut.addPort();
-	lastFlagList_DI.push_back(0);
-  }
-
-  for(int i=0;i<6;i++){
-	m_AIOut.addPort();
-	lastFlagList_AI.push_back(0);
-  }
-
-  addOutPort("TS", m_TSOut);
-  addOutPort("GS", m_GSOut);
+  // 1台目のボードのポートを生成する(2台目以降はonActivatedで生成する)
+  createBoard();
   
   // Set service provider to Ports
   
@@ -123,6 +271,24 @@ RTC::ReturnCode_t HOTMOCK_master::onInitialize()
   bindParameter("IPAddress", m_IPAddress, "127.0.0.1");
   bindParameter("PortNumber", m_PortNumber, "8888");
   bindParameter("GetDataType", m_GetDataType, "0,0,0,0");
+  bindParameter("RecvBufferSize", m_RecvBufferSize, "65536");
+  bindParameter("IOThread", m_IOThread, "0");
+  bindParameter("RequestWindow", m_RequestWindow, "1");
+  bindParameter("RequestTimeout", m_RequestTimeout, "500");
+  bindParameter("RequestMaxRetry", m_RequestMaxRetry, "3");
+  bindParameter("LogLevel", m_LogLevel, "INFO");
+  bindParameter("DataTrigger", m_DataTrigger, "0");
+  bindParameter("TriggerMinInterval", m_TriggerMinInterval, "1000");
+  bindParameter("TriggerMaxInterval", m_TriggerMaxInterval, "100");
+  bindParameter("AggregatePorts", m_AggregatePorts, "0");
+  bindParameter("BatchPublish", m_BatchPublish, "0");
+  bindParameter("PublishDeadband", m_PublishDeadband, "-1,-1,-1,-1");
+  bindParameter("PublishRelativeDeadband", m_PublishRelativeDeadband, "0,0,0,0");
+  bindParameter("PublishMinInterval", m_PublishMinInterval, "0,0,0,0");
+  bindParameter("PublishMaxInterval", m_PublishMaxInterval, "0,0,0,0");
+  bindParameter("PlanCache", m_PlanCache, "1");
+  bindParameter("WatchSetting", m_WatchSetting, "0");
+  bindParameter("WatchInterval", m_WatchInterval, "500");
   // </rtc-template>
   
   return RTC::RTC_OK;
@@ -134,75 +300,523 @@ RTC::ReturnCode_t HOTMOCK_master::onInitialize()
 
 RTC::ReturnCode_t HOTMOCK_master::onFinalize()
 {
-  // 現在使用しているポートを削除する
-  for(int i=0;i<connectIDList_DO.size();i++){
-	  removeInPort(m_DOIn.m_port[portNameList_DO[i]]);
+  // すべてのボードのポートをRTCから削除する
+  while(!m_boards.empty()){
+	  deleteBoard();
   }
-  for(int i=0;i<connectIDList_AO.size();i++){
-	  removeInPort(m_AOIn.m_port[connectIDList_AO[i]]);
+
+  stopTrigger();
+  stopWatch();
+
+  // 未出力のログを書き出してログ出力スレッドを終了する
+  hotmock::AsyncLogger::instance().stop();
+
+  return RTC::RTC_OK;
+}
+
+/*!
+ * DataTriggerが1の場合、実行コンテキストを起動(tick)するスレッドを開始する。
+ */
+RTC::ReturnCode_t HOTMOCK_master::onStartup(RTC::UniqueId ec_id)
+{
+  if(m_DataTrigger==1){
+	startTrigger(ec_id);
   }
-  for(int i=0;i<connectIDList_PI.size();i++){
-	  removeInPort(m_Reset_PIIn.m_port[connectIDList_PI[i]]);
-	  removeOutPort(m_PIOut.m_port[connectIDList_PI[i]]);
+  return RTC::RTC_OK;
+}
+
+/*!
+ * 実行コンテキストを起動(tick)するスレッドを終了する。
+ */
+RTC::ReturnCode_t HOTMOCK_master::onShutdown(RTC::UniqueId ec_id)
+{
+  stopTrigger();
+  return RTC::RTC_OK;
+}
+
+/*!
+ * 実行コンテキストがExtTrigExecutionContextの場合、データの受信または
+ * InPortへの入力があったときに実行コンテキストを起動(tick)するスレッ
+ * ドを開始する。
+ */
+void HOTMOCK_master::startTrigger(RTC::UniqueId ec_id)
+{
+  stopTrigger();
+
+  m_trigger = OpenRTM::ExtTrigExecutionContextService::_narrow(getExecutionContext(ec_id));
+  if(CORBA::is_nil(m_trigger)){
+	HMLOG_WARN("---DataTrigger needs ExtTrigExecutionContext, run periodically---");
+	return;
   }
-  for(int i=0;i<connectIDList_DI.size();i++){
-	  removeOutPort(m_DIOut.m_port[connectIDList_DI[i]]);
+
+  m_triggerRunning = true;
+  m_triggerThread = std::thread(&HOTMOCK_master::triggerThreadMain, this,
+                                m_TriggerMinInterval < 0 ? 0 : m_TriggerMinInterval,
+                                m_TriggerMaxInterval < 1 ? 1 : m_TriggerMaxInterval);
+}
+
+/*!
+ * 実行コンテキストを起動(tick)するスレッドを終了する。
+ */
+void HOTMOCK_master::stopTrigger()
+{
+  if(m_triggerThread.joinable()){
+	m_triggerRunning = false;
+	hmm.notifyEvent();
+	m_triggerThread.join();
   }
-  for(int i=0;i<connectIDList_AI.size();i++){
-	  removeOutPort(m_AIOut.m_port[portNameList_AI[i]]);
+  m_trigger = OpenRTM::ExtTrigExecutionContextService::_nil();
+}
+
+/*!
+ * データの受信またはInPortへの入力を待ち、実行コンテキストを起動(tick)する。
+ * 起動する間隔はmin_interval_us[us]以上、max_interval_ms[ms]以下となる。
+ */
+void HOTMOCK_master::triggerThreadMain(int min_interval_us, int max_interval_ms)
+{
+  unsigned long long last_ns = hotmock::monotonicNanoseconds();
+
+  while(m_triggerRunning){
+	// データが届くまで待つ(届かない場合もmax_interval_msごとに起動する)
+	hmm.waitEvent(max_interval_ms);
+	if(!m_triggerRunning){
+		break;
+	}
+
+	// 前回の起動からmin_interval_us経過していなければ待つ(待つ間に届いたデータは次の周期でまとめて処理される)
+	unsigned long long next_ns = last_ns + (unsigned long long)min_interval_us * 1000ULL;
+	unsigned long long now_ns = hotmock::monotonicNanoseconds();
+	if(now_ns < next_ns){
+		std::this_thread::sleep_for(std::chrono::nanoseconds(next_ns - now_ns));
+	}
+	last_ns = hotmock::monotonicNanoseconds();
+
+	try{
+		m_trigger->tick();
+	}
+	catch(CORBA::SystemException&){
+		HMLOG_WARN("---Failed to tick ExecutionContext---");
+	}
   }
+}
 
-  // RTCから登録したポートを削除する
-  while(m_DOIn.getSize()>0){
-	  m_DOIn.deletePort(m_DOIn.getSize()-1);
+/*!
+ * .hmstファイルを監視するスレッドを開始する。
+ */
+void HOTMOCK_master::startWatch()
+{
+  stopWatch();
+
+  std::vector<unsigned long long> hashes;
+  {
+	std::lock_guard<std::mutex> lock(m_watchMutex);
+	m_watchFilenames.clear();
+	m_reloadSettings.clear();
+	for(unsigned int b=0;b<m_boards.size();b++){
+		m_watchFilenames.push_back(m_boards[b]->hmst.hmstFilename);
+		m_reloadSettings.push_back(std::unique_ptr<hotmock::HotmockSetting>());
+		hashes.push_back(m_boards[b]->planHash);
+	}
   }
-  while(m_AOIn.getSize()>0){
-	  m_AOIn.deletePort(m_AOIn.getSize()-1);
+  m_reloadPending = false;
+
+  m_watchRunning = true;
+  m_watchThread = std::thread(&HOTMOCK_master::watchThreadMain, this,
+                              m_WatchInterval < 100 ? 100 : m_WatchInterval, hashes);
+}
+
+/*!
+ * .hmstファイルを監視するスレッドを終了する。未反映の設定は破棄する。
+ */
+void HOTMOCK_master::stopWatch()
+{
+  if(m_watchThread.joinable()){
+	{
+		std::lock_guard<std::mutex> lock(m_watchMutex);
+		m_watchRunning = false;
+	}
+	m_watchCond.notify_one();
+	m_watchThread.join();
   }
-  while(m_Reset_PIIn.getSize()>0){
-	  m_Reset_PIIn.deletePort(m_Reset_PIIn.getSize()-1);
+  std::lock_guard<std::mutex> lock(m_watchMutex);
+  m_reloadSettings.clear();
+  m_reloadPending = false;
+}
+
+/*!
+ * interval_msごとに.hmstファイルを読み込み、内容のハッシュ値が変わった
+ * 場合は解析してm_reloadSettingsに渡す(onExecuteで反映する)。
+ * hashesは各ボードの反映済みの.hmstファイルのハッシュ値。
+ */
+void HOTMOCK_master::watchThreadMain(int interval_ms, std::vector<unsigned long long> hashes)
+{
+  while(true){
+	std::vector<std::string> filenames;
+	{
+		std::unique_lock<std::mutex> lock(m_watchMutex);
+		m_watchCond.wait_for(lock, std::chrono::milliseconds(interval_ms), [this]{return !m_watchRunning;});
+		if(!m_watchRunning){
+			break;
+		}
+		filenames = m_watchFilenames;
+	}
+
+	for(unsigned int b=0;b<filenames.size() && b<hashes.size();b++){
+		std::unique_ptr<hotmock::HotmockSetting> setting(new hotmock::HotmockSetting());
+		setting->setPlanCache(hotmock::PlanCacheMemory);
+		if(setting->initialize(filenames[b])!=0 || setting->contentHash==hashes[b]){
+			continue;
+		}
+		// 解析できない内容は同じ内容のまま再度解析しない
+		hashes[b] = setting->contentHash;
+		if(setting->setPort()!=0){
+			HMLOG_WARN("---SettingFile is fault, not reloaded: {}---", filenames[b]);
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lock(m_watchMutex);
+		m_reloadSettings[b] = std::move(setting);
+		m_reloadPending = true;
+	}
+	// DataTriggerが1の場合、onExecuteを起動して反映させる
+	if(m_reloadPending){
+		hmm.notifyEvent();
+	}
   }
-  while(m_DIOut.getSize()>0){
-	  m_DIOut.deletePort(m_DIOut.getSize()-1);
+}
+
+/*!
+ * SettingFilenameの変更を監視スレッドに渡し、監視スレッドが解析した
+ * 設定があればポート構成の差分(前回のchannelListとの比較)のみを反映する。
+ */
+void HOTMOCK_master::applyReload()
+{
+  if(m_SettingFilename != m_activeSettingFilename){
+	m_activeSettingFilename = m_SettingFilename;
+	coil::vstring filenameList = coil::split(m_SettingFilename, ",");
+	if(filenameList.size() != m_boards.size()){
+		HMLOG_WARN("---Number of boards changed, deactivate and activate to apply: {}---", m_SettingFilename);
+	}
+	else{
+		std::lock_guard<std::mutex> lock(m_watchMutex);
+		m_watchFilenames = filenameList;
+	}
   }
-  while(m_AIOut.getSize()>0){
-	  m_AIOut.deletePort(m_AIOut.getSize()-1);
+
+  if(!m_reloadPending){
+	return;
   }
-  while(m_PIOut.getSize()>0){
-	  m_PIOut.deletePort(m_PIOut.getSize()-1);
+  std::lock_guard<std::mutex> lock(m_watchMutex);
+  m_reloadPending = false;
+  for(unsigned int b=0;b<m_reloadSettings.size() && b<m_boards.size();b++){
+	if(!m_reloadSettings[b]){
+		continue;
+	}
+	HotmockBoard &board = *m_boards[b];
+	std::unique_ptr<hotmock::HotmockSetting> setting = std::move(m_reloadSettings[b]);
+	if(setting->boardType != board.hmst.boardType){
+		HMLOG_WARN("---Board type changed, deactivate and activate to apply: {}---", setting->hmstFilename);
+		continue;
+	}
+
+	board.hmst = *setting;
+	updatePorts(board);
+	updateAggregatePorts(board, board.aggregate);
+	updateBatchPorts(board, board.batch);
+	board.planHash = board.hmst.contentHash;
+	HMLOG_INFO("{}setting reloaded: {}", board.prefix, board.hmst.hmstFilename);
   }
+}
 
-  lastFlagList_DO.clear();
-  lastFlagList_AO.clear();
-  lastFlagList_DI.clear();
-  lastFlagList_AI.clear();
-  lastFlagList_PI.clear();
+/*!
+ * 出力値を取得するInPort(DO,AO,Reset_PI)をRTCへ登録する。
+ * データが届いたときにDataTriggerのスレッドを起こすリスナを登録する。
+ * (リスナはポートの削除時に削除される)
+ */
+void HOTMOCK_master::addCommandInPort(const char* name, RTC::InPortBase& port)
+{
+  addInPort(name, port);
+  port.addConnectorDataListener(RTC::ON_RECEIVED, new HotmockInputListener(hmm));
+}
 
-  connectIDList_DO.clear();
-  connectIDList_AO.clear();
-  connectIDList_DI.clear();
-  connectIDList_AI.clear();
-  connectIDList_PI.clear();
+/*!
+ * ボードを追加し、HOTMOCKSettingで設定できる最大数のポートを生成する。
+ * 使用するコネクタに関係なく存在するTS,GS,StaleポートはRTCへ登録する。
+ */
+HotmockBoard *HOTMOCK_master::createBoard()
+{
+  std::ostringstream prefix;
+  if(!m_boards.empty()){ //2台目以降のボードのポート名には"B<ボード番号>_"を付ける
+	prefix << "B" << m_boards.size()+1 << "_";
+  }
+  m_boards.push_back(std::unique_ptr<HotmockBoard>(new HotmockBoard(prefix.str())));
+  HotmockBoard &board = *m_boards.back();
+
+  // HOTMOCKSettingで設定できる最大数のポートを生成する(ポート番号の最大値まで)
+  for(int kind=0;kind<channel_kind_num;kind++){
+	const HotmockChannelKindInfo &info = channel_kind_info[kind];
+	unsigned int portNum = info.idNum + std::max(info.portOffset[0], info.portOffset[1]);
+	switch(kind){
+	case CH_DO: addPorts(board.m_DOIn, portNum); break;
+	case CH_AO: addPorts(board.m_AOIn, portNum); break;
+	case CH_PI: addPorts(board.m_Reset_PIIn, portNum); addPorts(board.m_PIOut, portNum); addPorts(board.m_PIBatchOut, portNum); break;
+	case CH_DI: addPorts(board.m_DIOut, portNum); break;
+	case CH_AI: addPorts(board.m_AIOut, portNum); addPorts(board.m_AIBatchOut, portNum); break;
+	}
+  }
 
-  portNameList_DO.clear();
-  portNameList_AI.clear();
+  addOutPort((board.prefix + "TS").c_str(), board.m_TSOut);
+  addOutPort((board.prefix + "GS").c_str(), board.m_GSOut);
+  addOutPort((board.prefix + "Stale").c_str(), board.m_StaleOut);
+  addOutPort((board.prefix + "PublishCount").c_str(), board.m_PublishCountOut);
 
-  return RTC::RTC_OK;
+  return &board;
 }
 
-/*
-RTC::ReturnCode_t HOTMOCK_master::onStartup(RTC::UniqueId ec_id)
+/*!
+ * 最後に追加したボードのポートをRTCから削除し、ボードを削除する。
+ */
+void HOTMOCK_master::deleteBoard()
 {
-  return RTC::RTC_OK;
+  HotmockBoard &board = *m_boards.back();
+
+  removePorts(board);
+  updateAggregatePorts(board, false);
+  updateBatchPorts(board, false);
+  removeOutPort(board.m_TSOut);
+  removeOutPort(board.m_GSOut);
+  removeOutPort(board.m_StaleOut);
+  removeOutPort(board.m_PublishCountOut);
+
+  // 生成したポートはHotmockBoardのデストラクタで削除される
+  m_boards.pop_back();
 }
-*/
 
-/*
-RTC::ReturnCode_t HOTMOCK_master::onShutdown(RTC::UniqueId ec_id)
+/*!
+ * ボードの設定ファイルに合わせて、使用しているコネクタのポートを
+ * RTCへ登録し、使用しなくなったコネクタのポートを削除する。
+ */
+void HOTMOCK_master::updatePorts(HotmockBoard &board)
 {
-  return RTC::RTC_OK;
+  // 使用しているコネクタ位置（デバイス本体の表示）に対応する名前のポートを生成
+  // 　　ex) デバイス表示名:DI01 ---> ポート名:DI1 (2台目以降のボードはB<ボード番号>_DI1)
+  // 使用しているコネクタのソケット通信用のIDとポート番号をchannelListに保存
+  // 　　ex) channelList[i].connectID=j ---> ソケット通信ではj番のコネクタ
+  //
+  // ! DO,AIのみデバイス本体の表示とHOTMOCKSettingの表示が違うため、ポート番号はchannel_kind_infoのオフセットで求める
+  int type = (board.hmst.boardType=="analog") ? 1 : 0;
+  std::vector<HotmockChannel> lastList; //前回使用していたチャンネル
+  lastList.swap(board.channelList);
+
+  for(int kind=0;kind<channel_kind_num;kind++){
+	const HotmockChannelKindInfo &info = channel_kind_info[kind];
+	board.channelBegin[kind] = board.channelList.size();
+
+	for(unsigned int i=0;i<board.hmst.configFilenameList.size();i++){
+		if(board.hmst.configFilenameList[i]!=info.configFilename){
+			continue;
+		}
+		for(unsigned int j=0;j<board.hmst.useIDFlagList[i].size() && j<info.idNum;j++){
+			if(board.hmst.useIDFlagList[i][j]!=0){
+				board.channelList.push_back(HotmockChannel((HotmockChannelKind)kind, j+1, j+info.portOffset[type]));
+			}
+		}
+	}
+  }
+  board.channelBegin[channel_kind_num] = board.channelList.size();
+
+  // 前に使用していたポートを今回は使用しない
+  for(unsigned int i=0;i<lastList.size();i++){
+	bool used = false;
+	for(unsigned int j=0;j<board.channelList.size() && !used;j++){
+		used = (board.channelList[j].kind==lastList[i].kind && board.channelList[j].portNo==lastList[i].portNo);
+	}
+	if(!used){
+		registerChannel(board, lastList[i], false);
+	}
+  }
+  // 前に使用していなかったポートを今回使用する(前回も使用していたポートは出力した値を引き継ぐ)
+  for(unsigned int i=0;i<board.channelList.size();i++){
+	bool used = false;
+	for(unsigned int j=0;j<lastList.size() && !used;j++){
+		if(lastList[j].kind==board.channelList[i].kind && lastList[j].portNo==board.channelList[i].portNo){
+			board.channelList[i].publish = lastList[j].publish;
+			used = true;
+		}
+	}
+	if(!used){
+		registerChannel(board, board.channelList[i], true);
+	}
+  }
+  moveAggregate(board.m_DIAll, lastList, board.channels(CH_DI), board.channelNum(CH_DI), CH_DI);
+  moveAggregate(board.m_AIAll, lastList, board.channels(CH_AI), board.channelNum(CH_AI), CH_AI);
+  moveAggregate(board.m_PIAll, lastList, board.channels(CH_PI), board.channelNum(CH_PI), CH_PI);
+}
+
+/*!
+ * チャンネルの種類に対応するポートをRTCへ登録(enableがtrue)または削除する。
+ */
+void HOTMOCK_master::registerChannel(HotmockBoard &board, const HotmockChannel &channel, bool enable)
+{
+  switch(channel.kind){
+  case CH_DO:
+	registerPort(board.m_DOIn, channel.portNo, enable);
+	break;
+  case CH_AO:
+	registerPort(board.m_AOIn, channel.portNo, enable);
+	break;
+  case CH_PI:
+	registerPort(board.m_Reset_PIIn, channel.portNo, enable);
+	registerPort(board.m_PIOut, channel.portNo, enable);
+	break;
+  case CH_DI:
+	registerPort(board.m_DIOut, channel.portNo, enable);
+	break;
+  case CH_AI:
+	registerPort(board.m_AIOut, channel.portNo, enable);
+	break;
+  default:
+	break;
+  }
+}
+
+/*!
+ * DynamicInPortのi番のポートをRTCへ登録する。削除する場合はポートを作り直す。
+ */
+template <class DataType>
+void HOTMOCK_master::registerPort(DynamicInPort<DataType> &port, unsigned int i, bool enable)
+{
+  if(enable){
+	addCommandInPort(port.getName(i), port.m_port[i]);
+  }
+  else{
+	removeInPort(port.m_port[i]);
+	port.resetPort(i);
+  }
+}
+
+/*!
+ * DynamicOutPortのi番のポートをRTCへ登録する。削除する場合はポートを作り直す。
+ */
+template <class DataType>
+void HOTMOCK_master::registerPort(DynamicOutPort<DataType> &port, unsigned int i, bool enable)
+{
+  if(enable){
+	addOutPort(port.getName(i), port.m_port[i]);
+  }
+  else{
+	removeOutPort(port.m_port[i]);
+	port.resetPort(i);
+  }
+}
+
+/*!
+ * ボードの使用しているポートをRTCから削除する。
+ * 削除したポートは再びRTCへ登録できる状態に戻す。
+ */
+void HOTMOCK_master::removePorts(HotmockBoard &board)
+{
+  for(unsigned int i=0;i<board.channelList.size();i++){
+	  registerChannel(board, board.channelList[i], false);
+  }
+  board.channelList.clear();
+  for(int i=0;i<=channel_kind_num;i++){
+	  board.channelBegin[i] = 0;
+  }
+}
+
+/*!
+ * DIAll,AIAll,PIAllポートをRTCへ登録・削除し、配列の要素数を使用して
+ * いるコネクタの数に合わせる。
+ */
+void HOTMOCK_master::updateAggregatePorts(HotmockBoard &board, bool enable)
+{
+  if(enable && !board.aggregate){
+	addOutPort((board.prefix + "DIAll").c_str(), board.m_DIAllOut);
+	addOutPort((board.prefix + "AIAll").c_str(), board.m_AIAllOut);
+	addOutPort((board.prefix + "PIAll").c_str(), board.m_PIAllOut);
+  }
+  else if(!enable && board.aggregate){
+	removeOutPort(board.m_DIAllOut);
+	removeOutPort(board.m_AIAllOut);
+	removeOutPort(board.m_PIAllOut);
+  }
+  board.aggregate = enable;
+
+  // 値はupdatePortsで新しいチャンネル構成へ移してあるので要素数だけ合わせる
+  resizeAggregate(board.m_DIAll, board.channelNum(CH_DI));
+  resizeAggregate(board.m_AIAll, board.channelNum(CH_AI));
+  resizeAggregate(board.m_PIAll, board.channelNum(CH_PI));
+}
+
+/*!
+ * AIBatch*,PIBatch*,GSBatchポートをRTCから削除し、有効な場合は使用して
+ * いるAI,PIに対応するポートを登録し直す。
+ */
+void HOTMOCK_master::updateBatchPorts(HotmockBoard &board, bool enable)
+{
+  // 前回登録したポートを削除する
+  for(unsigned int i=0;i<board.batchPortList_AI.size();i++){
+	removeOutPort(board.m_AIBatchOut.m_port[board.batchPortList_AI[i]]);
+	board.m_AIBatchOut.resetPort(board.batchPortList_AI[i]);
+  }
+  for(unsigned int i=0;i<board.batchPortList_PI.size();i++){
+	removeOutPort(board.m_PIBatchOut.m_port[board.batchPortList_PI[i]]);
+	board.m_PIBatchOut.resetPort(board.batchPortList_PI[i]);
+  }
+  if(board.batch){
+	removeOutPort(board.m_GSBatchOut);
+  }
+  board.batchPortList_AI.clear();
+  board.batchPortList_PI.clear();
+
+  // AI,PIのポートと同じ番号のポートを登録する
+  if(enable){
+	const HotmockChannel *chAI = board.channels(CH_AI);
+	const HotmockChannel *chPI = board.channels(CH_PI);
+	for(unsigned int i=0;i<board.channelNum(CH_AI);i++){
+		addOutPort(board.m_AIBatchOut.getName(chAI[i].portNo), board.m_AIBatchOut.m_port[chAI[i].portNo]);
+		board.batchPortList_AI.push_back(chAI[i].portNo);
+	}
+	for(unsigned int i=0;i<board.channelNum(CH_PI);i++){
+		addOutPort(board.m_PIBatchOut.getName(chPI[i].portNo), board.m_PIBatchOut.m_port[chPI[i].portNo]);
+		board.batchPortList_PI.push_back(chPI[i].portNo);
+	}
+	addOutPort((board.prefix + "GSBatch").c_str(), board.m_GSBatchOut);
+  }
+  board.batch = enable;
+}
+
+/*!
+ * 最後に出力した値(DIAll,AIAll,PIAllの値を含む)と出力数・抑制数を初期化する。
+ */
+void HOTMOCK_master::resetPublishState(HotmockBoard &board)
+{
+  for(unsigned int i=0;i<board.channelList.size();i++){
+	board.channelList[i].publish = PublishState();
+  }
+  board.publishState_TS = PublishState();
+  board.publishState_GS = PublishState();
+  for(int i=0;i<4;i++){
+	board.publishedCount[i] = 0;
+	board.suppressedCount[i] = 0;
+  }
+  board.m_PublishCount.data.length(8);
+  for(int i=0;i<8;i++){
+	board.m_PublishCount.data[i] = 0;
+  }
+  for(unsigned int i=0;i<board.m_DIAll.data.length();i++){
+	board.m_DIAll.data[i] = 0;
+  }
+  for(unsigned int i=0;i<board.m_AIAll.data.length();i++){
+	board.m_AIAll.data[i] = 0.0;
+  }
+  for(unsigned int i=0;i<board.m_PIAll.data.length();i++){
+	board.m_PIAll.data[i] = 0.0;
+  }
+  board.publishCountChanged = false;
+  board.publishCountTime_ns = 0;
 }
-*/
 
 /*!
  * HOTMOCKデバイスの設定ファイルを読み込み、データポートの生成・削
@@ -212,201 +826,105 @@ RTC::ReturnCode_t HOTMOCK_master::onShutdown(RTC::UniqueId ec_id)
 RTC::ReturnCode_t HOTMOCK_master::onActivated(RTC::UniqueId ec_id)
 {
   int res;
-  // .hmstファイルを読み込む
-  res=hmst.initialize(m_SettingFilename);
-  if(res!=0){
-	  std::cerr << "---SettingFile is fault or make XML file error---" << std::endl;
+  // ログの出力レベルを設定する
+  hotmock::AsyncLogger::setLevel(hotmock::logLevelFromString(m_LogLevel));
+
+  // ボードごとの設定を取得する(設定ファイルの数がボードの数となる)
+  coil::vstring filenameList = coil::split(m_SettingFilename, ",");
+  coil::vstring ipList = coil::split(m_IPAddress, ",");
+  if(filenameList.empty() || filenameList.size() > hotmock::HotmockClientManager::max_boards){
+	  HMLOG_ERROR("---SettingFilename is fault---");
 	  return RTC::RTC_ERROR;
   }
-
-  // 使用しているボードの型を保存、デバイスにフラグを立てる
-  res=hmst.setPort();
-  if(res!=0){
-	  std::cerr << "---XML file is fault---" << std::endl;
+  if(ipList.empty() || m_PortNumber.empty()){
+	  HMLOG_ERROR("---IPAddress or PortNumber is fault---");
 	  return RTC::RTC_ERROR;
   }
 
-  // 使用しているポートの初期化
-  connectIDList_DO.clear();
-  connectIDList_AO.clear();
-  connectIDList_DI.clear();
-  connectIDList_AI.clear();
-  connectIDList_PI.clear();
-	
-  portNameList_DO.clear();
-  portNameList_AI.clear();
-
-  // 使用しているコネクタ位置（デバイス本体の表示）に対応する名前のポートを生成
-  // 　　ex) デバイス表示名:DI01 ---> ポート名:DI1
-  // 使用しているコネクタ位置をconnectIDList_**に保存
-  // 　　ex) connectIDList_DO[i]=j ---> i番目のポートのポート名はDOj
-  //
-  // ! DO,AIのみデバイス本体の表示とHOTMOCKSettingの表示が違うため、デバイス本体に表示する名前をportNameList_**に保存
-
-  for(int i=0;i<hmst.configFilenameList.size();i++){
-	if(hmst.configFilenameList[i]=="DO_Config.xml"){ //DO Portの設定を行う
-		for(int j=0;j<hmst.useIDFlagList[i].size();j++){
-			if(lastFlagList_DO[j]==0&&hmst.useIDFlagList[i][j]!=0){ //前に使用していなかったポートを今回使用する
-				connectIDList_DO.push_back(j+1);
-				if(hmst.boardType=="digital"){
-					portNameList_DO.push_back(j+1);
-					addInPort(m_DOIn.getName(j+1), m_DOIn.m_port[j+1]);
-				}
-				else if(hmst.boardType=="analog"){ //!アナログボードの場合、デバイス表示名はDO7から開始する(ソケット通信用のIDはDO06から)
-					portNameList_DO.push_back(j+2);
-					addInPort(m_DOIn.getName(j+2), m_DOIn.m_port[j+2]);
-				}
-			}
-			else if(lastFlagList_DO[j]!=0&&hmst.useIDFlagList[i][j]!=0){ //前に使用していたポートを今回も使用する
-				connectIDList_DO.push_back(j+1);
-				if(hmst.boardType=="digital"){
-					portNameList_DO.push_back(j+1);
-				}
-				else if(hmst.boardType=="analog"){ //!アナログボードの場合、デバイス表示名はDO7から開始する(ソケット通信用のIDはDO06から)
-					portNameList_DO.push_back(j+2);
-				}
-			}
-			else if(lastFlagList_DO[j]!=0&&hmst.useIDFlagList[i][j]==0){ //前に使用していたポートを今回は使用しない
-				if(hmst.boardType=="digital"){
-					removeInPort(m_DOIn.m_port[j+1]);
-					m_DOIn.resetPort(j+1);
-				}
-				else if(hmst.boardType=="analog"){ //!アナログボードの場合、デバイス表示名はDO7から開始する(ソケット通信用のIDはDO06から)
-					removeInPort(m_DOIn.m_port[j+2]);
-					m_DOIn.resetPort(j+2);
-				}
-			}
-			else ; //前に使用していなかったポートを今回も使用しない--->何もしない
+  // ボードの数に合わせてポートを追加・削除する
+  while(m_boards.size() < filenameList.size()){
+	  createBoard();
+  }
+  while(m_boards.size() > filenameList.size()){
+	  deleteBoard();
+  }
 
-			// 今回使用しているポートを記録する
-			lastFlagList_DO[j]=hmst.useIDFlagList[i][j];
-		}
-//		std::cout<<"add DO Port"<<std::endl;
+  // 受信バッファのサイズを設定する
+  hmm.setRecvBufferSize(m_RecvBufferSize);
+  // 1ならば専用のI/Oスレッドですべてのボードの送受信・解析を行い、onExecuteはキューの読み出しのみ行う
+  // DataTriggerが1の場合、I/Oスレッドが受信したときにonExecuteを実行するためI/Oスレッドを使用する
+  hmm.setIOThreadMode(m_IOThread==1 || m_DataTrigger==1);
+  // 1つのコネクタに対して同時に送信できるREQUESTの数を設定する
+  hmm.setRequestWindow(m_RequestWindow);
+  // 応答の無いREQUESTのタイムアウトと再送回数を設定する
+  hmm.setRequestTimeout(m_RequestTimeout < 0 ? 0 : m_RequestTimeout, m_RequestMaxRetry < 0 ? 0 : m_RequestMaxRetry);
+
+  for(unsigned int b=0;b<m_boards.size();b++){
+	HotmockBoard &board = *m_boards[b];
+
+	// .hmstファイルを読み込む(内容が変わっていなければキャッシュしたポート構成を使用する)
+	board.hmst.setPlanCache(m_PlanCache>=0 && m_PlanCache<=3 ? (hotmock::HotmockPlanCache)m_PlanCache : hotmock::PlanCacheOff);
+	res=board.hmst.initialize(filenameList[b]);
+	if(res!=0){
+		HMLOG_ERROR("---SettingFile is fault: {}---", filenameList[b]);
+		return RTC::RTC_ERROR;
 	}
-	else if(hmst.configFilenameList[i]=="AO_Config.xml"){ //AO Portの設定を行う
-		for(int j=0;j<hmst.useIDFlagList[i].size();j++){
-			if(lastFlagList_AO[j]==0&&hmst.useIDFlagList[i][j]!=0){ //前に使用していなかったポートを今回使用する
-				connectIDList_AO.push_back(j+1);
-				addInPort(m_AOIn.getName(j+1), m_DOIn.m_port[j+1]);
-			}
-			else if(lastFlagList_AO[j]!=0&&hmst.useIDFlagList[i][j]!=0){ //前に使用していたポートを今回も使用する
-				connectIDList_AO.push_back(j+1);
-			}
-			else if(lastFlagList_AO[j]!=0&&hmst.useIDFlagList[i][j]==0){ //前に使用していたポートを今回は使用しない
-				removeInPort(m_AOIn.m_port[j+1]);
-				m_AOIn.resetPort(j+1);
-			}
-			else ; //前に使用していなかったポートを今回も使用しない--->何もしない
 
-			// 今回使用しているポートを記録する
-			lastFlagList_AO[j]=hmst.useIDFlagList[i][j];
-		}
-//		std::cout<<"add AO Port"<<std::endl;
+	// 使用しているボードの型を保存、デバイスにフラグを立てる
+	res=board.hmst.setPort();
+	if(res!=0){
+		HMLOG_ERROR("---XML file is fault: {}---", filenameList[b]);
+		return RTC::RTC_ERROR;
 	}
-	else if(hmst.configFilenameList[i]=="PI_Config.xml"){ //Reset_PI Port,PI Portの設定を行う
-		for(int j=0;j<hmst.useIDFlagList[i].size();j++){
-			if(lastFlagList_PI[j]==0&&hmst.useIDFlagList[i][j]!=0){ //前に使用していなかったポートを今回使用する
-				connectIDList_PI.push_back(j+1);
-				addInPort(m_Reset_PIIn.getName(j+1), m_Reset_PIIn.m_port[j+1]);
-				addOutPort(m_PIOut.getName(j+1), m_PIOut.m_port[j+1]);
-			}
-			else if(lastFlagList_PI[j]!=0&&hmst.useIDFlagList[i][j]!=0){ //前に使用していたポートを今回も使用する
-				connectIDList_PI.push_back(j+1);
-			}
-			else if(lastFlagList_PI[j]!=0&&hmst.useIDFlagList[i][j]==0){ //前に使用していたポートを今回は使用しない
-				removeInPort(m_Reset_PIIn.m_port[j+1]);
-				m_Reset_PIIn.resetPort(j+1);
-				removeOutPort(m_PIOut.m_port[j+1]);
-				m_PIOut.resetPort(j+1);
-			}
-			else ; //前に使用していなかったポートを今回も使用しない--->何もしない
 
-			// 今回使用しているポートを記録する
-			lastFlagList_PI[j]=hmst.useIDFlagList[i][j];
-		}
-//		std::cout<<"add PI Port"<<std::endl;
+	// 使用しているコネクタに対応するポートを生成・削除する
+	// 前回と同じ内容の.hmstファイルならば登録済みのポートをそのまま使用する
+	if(!board.hmst.fromCache || board.hmst.contentHash != board.planHash){
+		updatePorts(board);
+		board.planHash = board.hmst.contentHash;
 	}
-	else if(hmst.configFilenameList[i]=="DI_Config.xml"){ //DI Portの設定を行う
-		for(int j=0;j<hmst.useIDFlagList[i].size();j++){
-			if(lastFlagList_DI[j]==0&&hmst.useIDFlagList[i][j]!=0){ //前に使用していなかったポートを今回使用する
-				connectIDList_DI.push_back(j+1);
-				addOutPort(m_DIOut.getName(j+1), m_DIOut.m_port[j+1]);
-			}
-			else if(lastFlagList_DI[j]!=0&&hmst.useIDFlagList[i][j]!=0){ //前に使用していたポートを今回も使用する
-				connectIDList_DI.push_back(j+1);
-			}
-			else if(lastFlagList_DI[j]!=0&&hmst.useIDFlagList[i][j]==0){ //前に使用していたポートを今回は使用しない
-				removeOutPort(m_DIOut.m_port[j+1]);
-				m_DIOut.resetPort(j+1);
-			}
-			else ; //前に使用していなかったポートを今回も使用しない--->何もしない
-
-			// 今回使用しているポートを記録する
-			lastFlagList_DI[j]=hmst.useIDFlagList[i][j];
-		}
-//		std::cout<<"add DI Port"<<std::endl;
-	}
-	else if(hmst.configFilenameList[i]=="AI_Config.xml"){ //AI Portの設定を行う
-		for(int j=0;j<hmst.useIDFlagList[i].size();j++){
-			if(lastFlagList_AI[j]==0&&hmst.useIDFlagList[i][j]!=0){ //前に使用していなかったポートを今回使用する
-				connectIDList_AI.push_back(j+1);
-				if(hmst.boardType=="digital"){
-					portNameList_AI.push_back(j+1);
-					addOutPort(m_AIOut.getName(j+1), m_AIOut.m_port[j+1]);
-				}
-				else if(hmst.boardType=="analog"){ //!アナログボードの場合、デバイス表示名はAI1から開始する(ソケット通信用のIDはAI02から)
-					portNameList_AI.push_back(j);
-					addOutPort(m_AIOut.getName(j), m_AIOut.m_port[j]);
-				}
-			}
-			else if(lastFlagList_AI[j]!=0&&hmst.useIDFlagList[i][j]!=0){ //前に使用していたポートを今回も使用する
-				connectIDList_AI.push_back(j+1);
-				if(hmst.boardType=="digital"){
-					portNameList_AI.push_back(j+1);
-				}
-				else if(hmst.boardType=="analog"){ //!アナログボードの場合、デバイス表示名はAI1から開始する(ソケット通信用のIDはAI02から)
-					portNameList_AI.push_back(j);
-				}
-			}
-			else if(lastFlagList_AI[j]!=0&&hmst.useIDFlagList[i][j]==0){ //前に使用していたポートを今回は使用しない
-				if(hmst.boardType=="digital"){
-					removeOutPort(m_AIOut.m_port[j+1]);
-					m_AIOut.resetPort(j+1);
-				}
-				else if(hmst.boardType=="analog"){ //!アナログボードの場合、デバイス表示名はAI1から開始する(ソケット通信用のIDはAI02から)
-					removeOutPort(m_AIOut.m_port[j]);
-					m_AIOut.resetPort(j);
-				}
-			}
-			else ; //前に使用していなかったポートを今回も使用しない--->何もしない
-
-			// 今回使用しているポートを記録する
-			lastFlagList_AI[j]=hmst.useIDFlagList[i][j];
-		}
-//		std::cout<<"add AI Port"<<std::endl;
+	updateAggregatePorts(board, m_AggregatePorts==1);
+	updateBatchPorts(board, m_BatchPublish==1);
+	resetPublishState(board);
+
+	// IPアドレス,Port番号の指定が足りない場合は最後の値を使用する
+	const std::string &ip = ipList[b < ipList.size() ? b : ipList.size()-1];
+	int port = m_PortNumber[b < m_PortNumber.size() ? b : m_PortNumber.size()-1];
+
+	board.board = -1;
+	if(board.hmst.boardType=="digital"){
+		HMLOG_INFO("hotmock board {} type = digital", b+1);
+		board.board=hmm.addBoard(hotmock::HotmockBoardType::Digital,ip.c_str(),port);
 	}
-  }
-
-  std::cout << "add Port finished" << std::endl;
-
-  if(hmst.boardType=="digital"){
-	std::cout << "hotmock board type = digital" << std::endl;
-	res=hmc.initialize(hotmock::HotmockBoardType::Digital,m_IPAddress.c_str(),m_PortNumber);
-	if(res != 0){
-		std::cerr << "---can not connected---" << std::endl;
-		return RTC::RTC_ERROR;
+	else if(board.hmst.boardType=="analog"){
+		HMLOG_INFO("hotmock board {} type = analog", b+1);
+		board.board=hmm.addBoard(hotmock::HotmockBoardType::Analog,ip.c_str(),port);
 	}
-  }
-  else if(hmst.boardType=="analog"){
-	std::cout << "hotmock board type = analog" << std::endl;
-	hmc.initialize(hotmock::HotmockBoardType::Analog,m_IPAddress.c_str(),m_PortNumber);
-	if(res != 0){
-		std::cerr << "---can not disconnected---" << std::endl;
+	if(board.board < 0){
+		HMLOG_ERROR("---can not connected: {}:{}---", ip, port);
 		return RTC::RTC_ERROR;
 	}
   }
 
-  std::cout << "connecting..." << std::endl << std::endl;
+  HMLOG_INFO("add Port finished");
+
+  // 共有I/Oスレッドを開始する(IOThreadが1の場合)
+  hmm.start();
+
+  HMLOG_INFO("connecting...");
+
+  // 接続が確立するまではデータが古いことを通知する
+  for(unsigned int b=0;b<m_boards.size();b++){
+	m_boards[b]->m_Stale.data = true;
+	setTimestamp(m_boards[b]->m_Stale);
+	m_boards[b]->m_StaleOut.write();
+  }
+
+  // ACTIVEの間に.hmstファイル,SettingFilenameが変更された場合に反映する
+  m_activeSettingFilename = m_SettingFilename;
+  if(m_WatchSetting==1){
+	startWatch();
+  }
 
   return RTC::RTC_OK;
 }
@@ -417,10 +935,13 @@ RTC::ReturnCode_t HOTMOCK_master::onActivated(RTC::UniqueId ec_id)
 
 RTC::ReturnCode_t HOTMOCK_master::onDeactivated(RTC::UniqueId ec_id)
 {
-  hmst.finalize();
-  //ソケット通信を終了する
-  hmc.finalize();
-  std::cout << "---disconnected---" << std::endl << std::endl;
+  stopWatch();
+  for(unsigned int b=0;b<m_boards.size();b++){
+	m_boards[b]->hmst.finalize();
+  }
+  //すべてのボードのソケット通信を終了する
+  hmm.finalize();
+  HMLOG_INFO("---disconnected---");
   return RTC::RTC_OK;
 }
 
@@ -428,70 +949,442 @@ RTC::ReturnCode_t HOTMOCK_master::onDeactivated(RTC::UniqueId ec_id)
  * ソケット通信によりHOTMOCKデバイスとデータのやり取りを行う。
  */
 
-RTC::ReturnCode_t HOTMOCK_master::onExecute(RTC::UniqueId ec_id)
+/*!
+ * HOTMOCKSettingからデータを受信した時刻(単調増加時刻)をタイムスタンプに設定する。
+ * recv_nsはhotmock::monotonicNanoseconds()、offset_nsは
+ * hotmock::clockOffsetNanoseconds()で得られる値[ns]。
+ */
+static void setReceiveTime(RTC::Time &tm, unsigned long long recv_ns, long long offset_ns)
+{
+  long long t = (long long)recv_ns + offset_ns;
+  tm.sec = (CORBA::ULong)(t / 1000000000LL);
+  tm.nsec = (CORBA::ULong)(t % 1000000000LL);
+}
+
+/*!
+ * バッチ出力用の配列に1つの値を書き込む。書き込んだ要素数を返す。
+ */
+static unsigned int setBatchValue(RTC::TimedDoubleSeq &batch, unsigned int pos, double value)
+{
+  batch.data[pos] = value;
+  return 1;
+}
+
+static unsigned int setBatchValue(RTC::TimedDoubleSeq &batch, unsigned int pos, const hotmock::Vector3d &value)
+{
+  batch.data[pos] = value.x;
+  batch.data[pos+1] = value.y;
+  batch.data[pos+2] = value.z;
+  return 3;
+}
+
+/*!
+ * コネクタのバッファに溜まったすべての値を取り出し、batchに[受信時刻,値]
+ * の組として受信した順に並べる。受信時刻は最新の値の受信時刻からの差[s]。
+ * 最新の値とその受信時刻をlatest,latest_nsに返す。
+ * width は1つの値の要素数(GSは3)。取り出した値の数を返す。
+ */
+template <class DataType>
+static std::size_t drainBatch(hotmock::HotmockData<DataType> &data, unsigned short connectorID, unsigned int width,
+                              RTC::TimedDoubleSeq &batch, DataType &latest, unsigned long long &latest_ns)
 {
+  DataType values[hotmock::HotmockData<DataType>::capacity];
+  unsigned long long times[hotmock::HotmockData<DataType>::capacity];
+
+  std::size_t n = data.drain(connectorID, values, hotmock::HotmockData<DataType>::capacity, times);
+  if(n == 0){
+	return 0;
+  }
+  latest = values[n-1];
+  latest_ns = times[n-1];
+
+  batch.data.length((CORBA::ULong)(n * (width+1)));
+  unsigned int pos = 0;
+  for(std::size_t i=0;i<n;i++){
+	batch.data[pos++] = -(double)(latest_ns - times[i]) * 1.0e-9;
+	pos += setBatchValue(batch, pos, values[i]);
+  }
+  return n;
+}
+
+/*!
+ * ConfigurationのPublishDeadband等からAI,PI,TS,GSの値を出力する条件を作成する。
+ * 配列の要素数が4より小さい場合、指定されていない種類は抑制を行わない。
+ */
+void HOTMOCK_master::updatePublishFilters()
+{
+  for(unsigned int i=0;i<4;i++){ //AI:0,PI:1,TS:2,GS:3
+	PublishFilter &filter = m_publishFilter[i];
+	filter.deadband = i < m_PublishDeadband.size() ? m_PublishDeadband[i] : -1.0;
+	filter.relative = i < m_PublishRelativeDeadband.size() ? m_PublishRelativeDeadband[i] : 0.0;
+	int min_ms = i < m_PublishMinInterval.size() ? m_PublishMinInterval[i] : 0;
+	int max_ms = i < m_PublishMaxInterval.size() ? m_PublishMaxInterval[i] : 0;
+	filter.min_interval_ns = min_ms > 0 ? (unsigned long long)min_ms * 1000000ULL : 0;
+	filter.max_interval_ns = max_ms > 0 ? (unsigned long long)max_ms * 1000000ULL : 0;
+  }
+}
+
+/*!
+ * 受信した値をポートに出力するかをm_publishFilter[type]により判定する。
+ * 出力する場合はstateを更新してtrueを返す。出力数・抑制数を数える。
+ * typeはAI:0,PI:1,TS:2,GS:3、widthは値の要素数(GSは3)。
+ */
+bool HOTMOCK_master::checkPublish(HotmockBoard &board, int type, PublishState &state, const double *value, unsigned int width, unsigned long long recv_ns)
+{
+  const PublishFilter &filter = m_publishFilter[type];
+
+  board.publishCountChanged = true;
+  if(state.valid){
+	unsigned long long elapsed = recv_ns > state.time_ns ? recv_ns - state.time_ns : 0;
+
+	//前回の出力から最小の間隔が経過していない
+	if(elapsed < filter.min_interval_ns){
+		board.suppressedCount[type]++;
+		return false;
+	}
+	//不感帯内の値(ハートビートの間隔が経過した場合は出力する)
+	if(filter.deadband >= 0.0 && (filter.max_interval_ns == 0 || elapsed < filter.max_interval_ns)){
+		double diff = 0.0;
+		double norm = 0.0;
+		for(unsigned int i=0;i<width;i++){
+			diff += (value[i] - state.value[i]) * (value[i] - state.value[i]);
+			norm += state.value[i] * state.value[i];
+		}
+		double threshold = std::max(filter.deadband, filter.relative * std::sqrt(norm));
+		if(std::sqrt(diff) <= threshold){
+			board.suppressedCount[type]++;
+			return false;
+		}
+	}
+  }
+
+  state.valid = true;
+  state.time_ns = recv_ns;
+  for(unsigned int i=0;i<width;i++){
+	state.value[i] = value[i];
+  }
+  board.publishedCount[type]++;
+  return true;
+}
+
+/*!
+ * 出力数・抑制数が変化した場合、PublishCountに最大1秒に1回出力する。
+ */
+void HOTMOCK_master::writePublishCount(HotmockBoard &board, long long clock_offset)
+{
+  if(!board.publishCountChanged){
+	return;
+  }
+  unsigned long long now_ns = hotmock::monotonicNanoseconds();
+  if(board.publishCountTime_ns != 0 && now_ns - board.publishCountTime_ns < 1000000000ULL){
+	return;
+  }
+
+  board.m_PublishCount.data.length(8);
+  for(int i=0;i<4;i++){
+	board.m_PublishCount.data[i*2] = (CORBA::ULong)board.publishedCount[i];
+	board.m_PublishCount.data[i*2+1] = (CORBA::ULong)board.suppressedCount[i];
+  }
+  setReceiveTime(board.m_PublishCount.tm, now_ns, clock_offset);
+  board.m_PublishCountOut.write();
+  board.publishCountChanged = false;
+  board.publishCountTime_ns = now_ns;
+}
+
+/*!
+ * InPort(Port:DO,AO,Reset_PI)に入力された値をボードに送信する。
+ */
+void HOTMOCK_master::writeOutputs(HotmockBoard &board)
+{
+  hotmock::HotmockClient &hmc = hmm.getClient(board.board);
+  const HotmockChannel *chDO = board.channels(CH_DO);
+  const HotmockChannel *chPI = board.channels(CH_PI);
+//!  const HotmockChannel *chAO = board.channels(CH_AO);
   short DO;
   boolean RPI;
 //!  double AO;
-  hotmock::Vector3d GS;
-  std::vector<int> param;
 
-  //InPort(Port:DO,AO,Reset_PI)に入力された値をHOTMOCKデバイスに送信する
-  for(int i=0;i<connectIDList_DO.size();i++){
-	if(m_DOIn.m_port[portNameList_DO[i]].isNew()){
-		m_DOIn.m_port[portNameList_DO[i]].read();
-		DO = m_DOIn.m_data[portNameList_DO[i]].data;
-		std::cout << "DO Port" << portNameList_DO[i] << " : " << DO << std::endl << std::endl;
+  for(unsigned int i=0;i<board.channelNum(CH_DO);i++){
+	if(board.m_DOIn.m_port[chDO[i].portNo].isNew()){
+		board.m_DOIn.m_port[chDO[i].portNo].read();
+		DO = board.m_DOIn.m_data[chDO[i].portNo].data;
+		HMLOG_DEBUG("{}DO Port{} : {}", board.prefix, chDO[i].portNo, DO);
 		if(DO==1){
 			on_or_off = hotmock::DO_ON;
 		}
 		else if(DO==2){
 			on_or_off = hotmock::DO_OFF;
 		}
-		hmc.sendCommandToHotmock(hotmock::HotmockClientCommand::OUTPUT,hotmock::HotmockConnectorType::DO,connectIDList_DO[i],on_or_off);
+		hmc.sendCommandToHotmock(hotmock::HotmockClientCommand::OUTPUT,hotmock::HotmockConnectorType::DO,chDO[i].connectID,on_or_off);
 	}
   }
 
   // ! AOに対応するデバイスはHOTMOCK側で未実装
-/*  for(int i=0;i<connectIDList_AO.size();i++){
-	if(m_AOIn.m_port[connectIDList_AO[i]].isNew()){
-		m_AOIn.m_port[connectIDList_AO[i]].read();
-		AO = m_AOIn.m_data[connectIDList_AO[i]].data;
-//		std::cout << "AO Port" << connectIDList_AO[i] << " : " << AO << std::endl << std::endl;
-		hmc.sendCommandToHotmock(hotmock::HotmockClientCommand::OUTPUT,hotmock::HotmockConnectorType::AO,connectIDList_AO[i],AO);
+/*  for(unsigned int i=0;i<board.channelNum(CH_AO);i++){
+	if(board.m_AOIn.m_port[chAO[i].portNo].isNew()){
+		board.m_AOIn.m_port[chAO[i].portNo].read();
+		AO = board.m_AOIn.m_data[chAO[i].portNo].data;
+//		std::cout << "AO Port" << chAO[i].connectID << " : " << AO << std::endl << std::endl;
+		hmc.sendCommandToHotmock(hotmock::HotmockClientCommand::OUTPUT,hotmock::HotmockConnectorType::AO,chAO[i].connectID,AO);
 	}
   }*/
 
   // PIの積算値をリセットする
-  for(int i=0;i<connectIDList_PI.size();i++){
-	if(m_Reset_PIIn.m_port[connectIDList_PI[i]].isNew()){
-		m_Reset_PIIn.m_port[connectIDList_PI[i]].read();
-		RPI = m_Reset_PIIn.m_data[connectIDList_PI[i]].data;
-		std::cout << "Reset_PI Port" << connectIDList_PI[i] << " : " << RPI << std::endl << std::endl;
+  for(unsigned int i=0;i<board.channelNum(CH_PI);i++){
+	if(board.m_Reset_PIIn.m_port[chPI[i].portNo].isNew()){
+		board.m_Reset_PIIn.m_port[chPI[i].portNo].read();
+		RPI = board.m_Reset_PIIn.m_data[chPI[i].portNo].data;
+		HMLOG_DEBUG("{}Reset_PI Port{} : {}", board.prefix, chPI[i].connectID, RPI);
 		if(RPI){
 			on_or_off = hotmock::DO_ON;
 		}
 		else {
 			on_or_off = hotmock::DO_OFF;
 		}
-		hmc.sendCommandToHotmock(hotmock::HotmockClientCommand::INIT,hotmock::HotmockConnectorType::PI,connectIDList_PI[i],on_or_off);
+		hmc.sendCommandToHotmock(hotmock::HotmockClientCommand::INIT,hotmock::HotmockConnectorType::PI,chPI[i].connectID,on_or_off);
 	}
   }
+}
+
+/*!
+ * readyのビットが立っているコネクタ(チャンネルに割り当てられていないコネクタ)の
+ * 受信データを捨てる。バッファが満杯になると古いデータから捨てられるため、
+ * 受信したコネクタのバッファは毎周期すべて取り出す。
+ */
+template <class DataType>
+static void discardUnread(hotmock::HotmockData<DataType> &data, unsigned long long ready)
+{
+  for(unsigned int id=0;ready!=0;id++,ready>>=1){
+	if(ready & 1ULL){
+		data.discard((unsigned short)id);
+	}
+  }
+}
+
+/*!
+ * ボードの接続状態をStaleポートに、受信したDIの値をDIポートに出力する。
+ */
+void HOTMOCK_master::readDigitalInputs(HotmockBoard &board, long long clock_offset)
+{
+  hotmock::HotmockClient &hmc = hmm.getClient(board.board);
+  const HotmockChannel *chDI = board.channels(CH_DI);
+  unsigned long long recv_ns; //データの受信時刻
+  bool updated = false; //DIAllに出力する値が更新された
+
+  //接続状態が変化したらStaleポートに出力する(切断中はtrue)
+  if(board.m_Stale.data != !hmc.isConnected()){
+	board.m_Stale.data = !hmc.isConnected();
+	setTimestamp(board.m_Stale);
+	board.m_StaleOut.write();
+  }
+
+  //DIの値を出力する(データを受信したコネクタのみ読み出す)
+  unsigned long long ready = hmc.takeReadyConnectors(hotmock::HotmockConnectorType::DI);
+  for(unsigned int i=0;i<board.channelNum(CH_DI) && ready!=0;i++){
+	if(!(ready & (1ULL << chDI[i].connectID))){
+		continue;
+	}
+	ready &= ~(1ULL << chDI[i].connectID);
+	if(hmc.DIData.isNew(chDI[i].connectID)){
+		board.m_DIOut.m_data[chDI[i].portNo].data = hmc.DIData.getLatestData(chDI[i].connectID, recv_ns);
+		setReceiveTime(board.m_DIOut.m_data[chDI[i].portNo].tm, recv_ns, clock_offset);
+		HMLOG_DEBUG("{}DI Port {} : {}", board.prefix, chDI[i].connectID, board.m_DIOut.m_data[chDI[i].portNo].data);
+		board.m_DIOut.m_port[chDI[i].portNo].write();
+		if(board.aggregate){
+			board.m_DIAll.data[i] = board.m_DIOut.m_data[chDI[i].portNo].data;
+			board.m_DIAll.tm = board.m_DIOut.m_data[chDI[i].portNo].tm;
+			updated = true;
+		}
+	}
+  }
+  discardUnread(hmc.DIData, ready);
+
+  //この周期に受信したDIをまとめて1回出力する
+  if(updated){
+	board.m_DIAllOut.write();
+  }
+}
+
+/*!
+ * ボードのAI,PI,TS,GSの値を要求し、受信した値をポートに出力する。
+ * paramは要求するデータの種類(AI:param[0],PI:param[1],TS:param[2],GS:param[3])。
+ */
+void HOTMOCK_master::requestInputs(HotmockBoard &board, const std::vector<int> &param, long long clock_offset)
+{
+  hotmock::HotmockClient &hmc = hmm.getClient(board.board);
+  HotmockChannel *chAI = board.channels(CH_AI);
+  HotmockChannel *chPI = board.channels(CH_PI);
+  hotmock::Vector3d GS;
+  unsigned long long recv_ns; //データの受信時刻
+  unsigned long long ready;
+  bool updated; //AIAll,PIAllに出力する値が更新された
+
+  //受信したデータはtakeReadyConnectorsで取得したコネクタのみ読み出す
+  if(board.channelNum(CH_AI)!=0){
+	updated = false;
+	ready = hmc.takeReadyConnectors(hotmock::HotmockConnectorType::AI);
+	for(unsigned int i=0;i<board.channelNum(CH_AI);i++){
+		hmc.sendCommandToHotmock(hotmock::HotmockClientCommand::REQUEST,hotmock::HotmockConnectorType::AI,chAI[i].connectID,param[0]);
+		if(!(ready & (1ULL << chAI[i].connectID))){
+			continue;
+		}
+		ready &= ~(1ULL << chAI[i].connectID);
+		if(board.batch){ //受信したすべての値をAIBatchに出力し、最新の値をAIに出力する
+			TimedDoubleSeq &batch = board.m_AIBatchOut.m_data[chAI[i].portNo];
+			if(drainBatch(hmc.AIData, chAI[i].connectID, 1, batch, board.m_AIOut.m_data[chAI[i].portNo].data, recv_ns) == 0){
+				continue;
+			}
+			setReceiveTime(batch.tm, recv_ns, clock_offset);
+			board.m_AIBatchOut.m_port[chAI[i].portNo].write();
+		}
+		else if(hmc.AIData.isNew(chAI[i].connectID)){
+			board.m_AIOut.m_data[chAI[i].portNo].data = hmc.AIData.getLatestData(chAI[i].connectID, recv_ns);
+		}
+		else{
+			continue;
+		}
+		//不感帯・出力間隔の条件を満たさない値は出力しない
+		if(!checkPublish(board, 0, chAI[i].publish, &board.m_AIOut.m_data[chAI[i].portNo].data, 1, recv_ns)){
+			continue;
+		}
+		setReceiveTime(board.m_AIOut.m_data[chAI[i].portNo].tm, recv_ns, clock_offset);
+		HMLOG_DEBUG("{}AI Port{} : {}", board.prefix, chAI[i].portNo, board.m_AIOut.m_data[chAI[i].portNo].data);
+		board.m_AIOut.m_port[chAI[i].portNo].write(); 
+		if(board.aggregate){
+			board.m_AIAll.data[i] = board.m_AIOut.m_data[chAI[i].portNo].data;
+			board.m_AIAll.tm = board.m_AIOut.m_data[chAI[i].portNo].tm;
+			updated = true;
+		}
+	}
+	discardUnread(hmc.AIData, ready);
+	//この周期に受信したAIをまとめて1回出力する
+	if(updated){
+		board.m_AIAllOut.write();
+	}
+  }
+  else{
+	discardUnread(hmc.AIData, hmc.takeReadyConnectors(hotmock::HotmockConnectorType::AI));
+  }
+
+  if(board.channelNum(CH_PI)!=0){
+	updated = false;
+	ready = hmc.takeReadyConnectors(hotmock::HotmockConnectorType::PI);
+	for(unsigned int i=0;i<board.channelNum(CH_PI);i++){
+		hmc.sendCommandToHotmock(hotmock::HotmockClientCommand::REQUEST,hotmock::HotmockConnectorType::PI,chPI[i].connectID,param[1]);
+		if(!(ready & (1ULL << chPI[i].connectID))){
+			continue;
+		}
+		ready &= ~(1ULL << chPI[i].connectID);
+		if(board.batch){ //受信したすべての値をPIBatchに出力し、最新の値をPIに出力する
+			TimedDoubleSeq &batch = board.m_PIBatchOut.m_data[chPI[i].portNo];
+			if(drainBatch(hmc.PIData, chPI[i].connectID, 1, batch, board.m_PIOut.m_data[chPI[i].portNo].data, recv_ns) == 0){
+				continue;
+			}
+			setReceiveTime(batch.tm, recv_ns, clock_offset);
+			board.m_PIBatchOut.m_port[chPI[i].portNo].write();
+		}
+		else if(hmc.PIData.isNew(chPI[i].connectID)){
+			board.m_PIOut.m_data[chPI[i].portNo].data = hmc.PIData.getLatestData(chPI[i].connectID, recv_ns);
+		}
+		else{
+			continue;
+		}
+		//不感帯・出力間隔の条件を満たさない値は出力しない
+		if(!checkPublish(board, 1, chPI[i].publish, &board.m_PIOut.m_data[chPI[i].portNo].data, 1, recv_ns)){
+			continue;
+		}
+		setReceiveTime(board.m_PIOut.m_data[chPI[i].portNo].tm, recv_ns, clock_offset);
+		HMLOG_DEBUG("{}PI Port{} : {}", board.prefix, chPI[i].connectID, board.m_PIOut.m_data[chPI[i].portNo].data);
+		board.m_PIOut.m_port[chPI[i].portNo].write(); 
+		if(board.aggregate){
+			board.m_PIAll.data[i] = board.m_PIOut.m_data[chPI[i].portNo].data;
+			board.m_PIAll.tm = board.m_PIOut.m_data[chPI[i].portNo].tm;
+			updated = true;
+		}
+	}
+	discardUnread(hmc.PIData, ready);
+	//この周期に受信したPIをまとめて1回出力する
+	if(updated){
+		board.m_PIAllOut.write();
+	}
+  }
+  else{
+	discardUnread(hmc.PIData, hmc.takeReadyConnectors(hotmock::HotmockConnectorType::PI));
+  }
+
+  hmc.sendCommandToHotmock(hotmock::HotmockClientCommand::REQUEST,hotmock::HotmockConnectorType::TS,1,param[2]);
+  if(hmc.takeReadyConnectors(hotmock::HotmockConnectorType::TS) != 0 && hmc.TSData.isNew(1)){
+	double TS = hmc.TSData.getLatestData(1, recv_ns);
+	if(checkPublish(board, 2, board.publishState_TS, &TS, 1, recv_ns)){ //不感帯・出力間隔の条件を満たさない値は出力しない
+		board.m_TS.data = TS;
+		setReceiveTime(board.m_TS.tm, recv_ns, clock_offset);
+		HMLOG_DEBUG("{}TS data: {}", board.prefix, board.m_TS.data);
+		board.m_TSOut.write();
+	}
+  }
+
+  hmc.sendCommandToHotmock(hotmock::HotmockClientCommand::REQUEST,hotmock::HotmockConnectorType::GS,1,param[3]);
+  bool gs_received = false;
+  if(hmc.takeReadyConnectors(hotmock::HotmockConnectorType::GS) != 0){
+	if(board.batch){ //受信したすべての値をGSBatchに出力し、最新の値をGSに出力する
+		if(drainBatch(hmc.GSData, 1, 3, board.m_GSBatch, GS, recv_ns) != 0){
+			setReceiveTime(board.m_GSBatch.tm, recv_ns, clock_offset);
+			board.m_GSBatchOut.write();
+			gs_received = true;
+		}
+	}
+	else if(hmc.GSData.isNew(1)){
+		GS=hmc.GSData.getLatestData(1, recv_ns);
+		gs_received = true;
+	}
+  }
+  if(gs_received){ //不感帯・出力間隔の条件を満たさない値は出力しない
+	double GSValue[3] = {GS.x, GS.y, GS.z};
+	gs_received = checkPublish(board, 3, board.publishState_GS, GSValue, 3, recv_ns);
+  }
+  if(gs_received){
+	setReceiveTime(board.m_GS.tm, recv_ns, clock_offset);
+	board.m_GS.data.length(3);
+	board.m_GS.data[0]=GS.x;
+	board.m_GS.data[1]=GS.y;
+	board.m_GS.data[2]=GS.z;
+	HMLOG_DEBUG("{}GS data: x={} y={} z={}", board.prefix, board.m_GS.data[0], board.m_GS.data[1], board.m_GS.data[2]);
+	board.m_GSOut.write();
+  }
+
+  writePublishCount(board, clock_offset);
+}
+
+RTC::ReturnCode_t HOTMOCK_master::onExecute(RTC::UniqueId ec_id)
+{
+  std::vector<int> param;
+
+  //設定ファイルが変更された場合、ポート構成の差分のみを反映する(ソケット通信は継続する)
+  if(m_WatchSetting==1){
+	applyReload();
+  }
+
+  //この周期で送信するコマンドはflush()でボードごとにまとめて送信する
+  hmm.beginBatch();
+
+  //InPort(Port:DO,AO,Reset_PI)に入力された値をHOTMOCKデバイスに送信する
+  for(unsigned int b=0;b<m_boards.size();b++){
+	writeOutputs(*m_boards[b]);
+  }
 
   //HOTMOCKデバイスから受信したデータをOutPort(Port:DI,AI,TS,GS)に出力する
-  int res = hmc.recvDataFromHotmock();
+  //切断された場合もACTIVEのまま自動で再接続する
+  int res = hmm.recvDataFromHotmock();
   if(res < 0){ //server disconnected
-	std::cout << "---Server disconnected---" << std::endl << std::endl;
-	return RTC::RTC_ERROR;
+	HMLOG_WARN("---Server disconnected, reconnecting---");
   }
 
-  //DIの値を出力する
-  for(int i=0;i<connectIDList_DI.size();i++){
-	if(hmc.DIData.isNew(connectIDList_DI[i])){
-		m_DIOut.m_data[connectIDList_DI[i]].data = hmc.DIData.getLatestData(connectIDList_DI[i]);
-		std::cout << "DI Port " << connectIDList_DI[i] << " : " << m_DIOut.m_data[connectIDList_DI[i]].data << std::endl<<std::endl; 
-		m_DIOut.m_port[connectIDList_DI[i]].write();
-	}
+  //受信時刻を実時刻に変換するための差分(1周期に1回求める)
+  long long clock_offset = hotmock::clockOffsetNanoseconds();
+
+  //Stale,DIの値を出力する
+  for(unsigned int b=0;b<m_boards.size();b++){
+	readDigitalInputs(*m_boards[b], clock_offset);
   }
 
   //AI,PI,TS,GSに要求するデータの種類を設定する
@@ -505,7 +1398,7 @@ RTC::ReturnCode_t HOTMOCK_master::onExecute(RTC::UniqueId ec_id)
 			param.push_back(hotmock::REQUEST_PROCESSED);
 		}
 		else{
-			std::cerr << "---GetDataType only 1 or 0---" << std::endl;
+			HMLOG_ERROR("---GetDataType only 1 or 0---");
 			return RTC::RTC_ERROR;
 		}
 	}
@@ -521,7 +1414,7 @@ RTC::ReturnCode_t HOTMOCK_master::onExecute(RTC::UniqueId ec_id)
 			param.push_back(hotmock::REQUEST_PROCESSED);
 		}
 		else{
-			std::cout<<"---GetDataType only 1 or 0---"<<std::endl;
+			HMLOG_ERROR("---GetDataType only 1 or 0---");
 			return RTC::RTC_ERROR;
 		}
 	}
@@ -530,45 +1423,17 @@ RTC::ReturnCode_t HOTMOCK_master::onExecute(RTC::UniqueId ec_id)
 	}
   }
 
-  //AI,PI,TS,GSの値をHOTMOCKに要求し、値を出力する
-  if(connectIDList_AI.size()!=0){
-	for(int i=0;i<connectIDList_AI.size();i++){
-		hmc.sendCommandToHotmock(hotmock::HotmockClientCommand::REQUEST,hotmock::HotmockConnectorType::AI,connectIDList_AI[i],param[0]);
-		if(hmc.AIData.isNew(connectIDList_AI[i])){
-			m_AIOut.m_data[portNameList_AI[i]].data = hmc.AIData.getLatestData(connectIDList_AI[i]);
-			std::cout << "AI Port" << portNameList_AI[i] << " : " << m_AIOut.m_data[portNameList_AI[i]].data << std::endl << std::endl;
-			m_AIOut.m_port[portNameList_AI[i]].write(); 
-		}
-	}
-  }
+  //AI,PI,TS,GSの値を出力する条件(不感帯・出力間隔)を設定する
+  updatePublishFilters();
 
-  if(connectIDList_PI.size()!=0){
-	for(int i=0;i<connectIDList_PI.size();i++){
-		hmc.sendCommandToHotmock(hotmock::HotmockClientCommand::REQUEST,hotmock::HotmockConnectorType::PI,connectIDList_PI[i],param[1]);
-		if(hmc.PIData.isNew(connectIDList_PI[i])){
-			m_PIOut.m_data[connectIDList_PI[i]].data = hmc.PIData.getLatestData(connectIDList_PI[i]);
-			std::cout << "PI Port" << connectIDList_PI[i] << " : " << m_PIOut.m_data[connectIDList_PI[i]].data << std::endl << std::endl;
-			m_PIOut.m_port[connectIDList_PI[i]].write(); 
-		}
-	}
-  }
-
-  hmc.sendCommandToHotmock(hotmock::HotmockClientCommand::REQUEST,hotmock::HotmockConnectorType::TS,1,param[2]);
-  if(hmc.TSData.isNew(1)){
-	m_TS.data = hmc.TSData.getLatestData(1);
-	std::cout << "TS data: " << m_TS.data << std::endl << std::endl; 
-	m_TSOut.write();
+  //AI,PI,TS,GSの値をHOTMOCKに要求し、値を出力する
+  for(unsigned int b=0;b<m_boards.size();b++){
+	requestInputs(*m_boards[b], param, clock_offset);
   }
 
-  hmc.sendCommandToHotmock(hotmock::HotmockClientCommand::REQUEST,hotmock::HotmockConnectorType::GS,1,param[3]);
-  if(hmc.GSData.isNew(1)){
-	GS=hmc.GSData.getLatestData(1);
-	m_GS.data.length(3);
-	m_GS.data[0]=GS.x;
-	m_GS.data[1]=GS.y;
-	m_GS.data[2]=GS.z;
-	std::cout << "GS data: x=" << m_GS.data[0] << " y=" << m_GS.data[1] << " z=" << m_GS.data[2] << std::endl << std::endl;
-	m_GSOut.write();
+  //この周期のコマンドをボードごとに1回のsendで送信する(送信エラー時は再接続される)
+  if(hmm.flush() < 0){
+	HMLOG_WARN("---Send error, reconnecting---");
   }
 
   return RTC::RTC_OK;
@@ -594,8 +1459,10 @@ RTC::ReturnCode_t HOTMOCK_master::onError(RTC::UniqueId ec_id)
 
 RTC::ReturnCode_t HOTMOCK_master::onReset(RTC::UniqueId ec_id)
 {
-  hmst.finalize();
-  hmc.finalize();
+  for(unsigned int b=0;b<m_boards.size();b++){
+	m_boards[b]->hmst.finalize();
+  }
+  hmm.finalize();
   return RTC::RTC_OK;
 }
 
@@ -11,10 +11,11 @@
  */
 
 #include <iostream>
-#include <iomanip> //needed for setfill and setw
-#include <sstream> //needed for ostringstream
 #include <string>
 #include <cstring> //needed for memcpy
+#include <climits> //needed for USHRT_MAX
+#include <chrono>
+#include <algorithm>
 
 #include "hotmockclient.h"
 
@@ -75,16 +76,74 @@ namespace hotmock{
 				PIConnectorNum=0;
 				GSConnectorNum=0;
 				TSConnectorNum=0;
-				std::cerr << "Error in HotmockConnectorInformation::HotmockConnectorInformation(): invalid board type" << std::endl;
+				HMLOG_ERROR("Error in HotmockConnectorInformation::HotmockConnectorInformation(): invalid board type");
 		}
 	}
 
+	/*!
+	 * @brief Clear outstanding requests and statistics
+	 * @param connector_type Connector type
+	 * @param id Connector ID
+	 */
+	void HotmockInFlight::reset(HotmockConnectorType connector_type, unsigned short id){
+		sent = 0;
+		answered = 0;
+		unmatched = 0;
+		timer.prev = NULL;
+		timer.next = NULL;
+		timer.expire_tick = 0;
+		timer.data = this;
+		type = connector_type;
+		connectorID = id;
+		timeouts = 0;
+		dropped = 0;
+	}
+
 	/*!
 	 * @brief Constuctor
 	 */
 	HotmockClient::HotmockClient(){
-		sock = INVALID_SOCKET;
-		wsa_set = false;
+		recv_buffer_size = default_recv_buffer_size;
+		recv_time_ns = 0;
+		std::memset(&recv_status, 0, sizeof(recv_status));
+		send_len = 0;
+		batching = false;
+		batch_commands = 0;
+		std::memset(&send_count, 0, sizeof(send_count));
+		std::memset(&send_status, 0, sizeof(send_status));
+		request_window = 1;
+		request_timeout_ns = 500000000ULL;
+		request_max_retry = 3;
+		timer_now = 0;
+		for(int t=0;t<connector_type_num;t++){
+			in_flight_num[t] = 0;
+			type_subscription[t].callback = NULL;
+			type_subscription[t].context = NULL;
+			for(unsigned int id=0;id<=max_connector_id;id++){
+				connector_subscription[t][id].callback = NULL;
+				connector_subscription[t][id].context = NULL;
+			}
+			ready_mask[t] = 0;
+		}
+		frame_len = 0;
+		frame_overflow = false;
+		io_thread_mode = false;
+		io_external = false;
+		io_running = false;
+		server_port = 0;
+		connection_state = Disconnected;
+		connection_lost = false;
+		reconnect_count = 0;
+		ever_connected = false;
+		reconnect_delay_ns = reconnect_min_delay_ns;
+		reconnect_time_ns = 0;
+		jitter_seed = (unsigned int)monotonicNanoseconds() | 1;
+		io_bytes = 0;
+		io_frames = 0;
+		io_recv_calls = 0;
+		io_send_commands = 0;
+		io_send_bytes = 0;
+		io_send_calls = 0;
 	}
 
 	/*!
@@ -95,7 +154,9 @@ namespace hotmock{
 	}
 
 	/*!
-	 * @brief Initialization - set data buffer and connect to Hotmock server
+	 * @brief Initialization - set data buffer and start connecting to Hotmock server.
+	 * Returns without waiting for the connection; connect and reconnect are completed by
+	 * recvDataFromHotmock() (or I/O thread) with exponential backoff
 	 * @param hmtype Hotmock type
 	 * @param ip IP of the server
 	 * @param port port number of the server
@@ -114,84 +175,160 @@ namespace hotmock{
 		AIData.initialize(connector_info.AIConnectorNum, connector_info.AIFirstConnectorID);
 		GSData.initialize(connector_info.GSConnectorNum, connector_info.GSFirstConnectorID);
 		TSData.initialize(connector_info.TSConnectorNum, connector_info.TSFirstConnectorID);
+		for(int t=0;t<connector_type_num;t++){
+			ready_mask[t] = 0;
+		}
 
-		//Set flag to check if connector accepts request or not
-		PIRequestAcceptable.resize(connector_info.AIConnectorNum,true);
-		AIRequestAcceptable.resize(connector_info.AIConnectorNum,true);
-		GSRequestAcceptable.resize(connector_info.GSConnectorNum,true);
-		TSRequestAcceptable.resize(connector_info.TSConnectorNum,true);
-
-		// Initialize Winsock
-		int res = WSAStartup(MAKEWORD(2,2), &wsaData);
-		if(res != 0) {
-			WSACleanup();
-			std::cerr << "WSAStartup failed with error:" << res << std::endl;
-			return res;
+		//Allocate receive buffer once (reused while connected)
+		if(recv_buffer.size() != recv_buffer_size){
+			recv_buffer.assign(recv_buffer_size, 0);
 		}
-		wsa_set = true;
 
-		res = connectToHotmock(ip, port);
-		if(res != 0){
-			finalize();
+		//Precompile bytes of every valid command
+		buildCommandPlan();
+
+		//Set outstanding requests of the connectors which accept request
+		timer_wheel.reset(monotonicNanoseconds());
+		for(int t=0;t<connector_type_num;t++){
+			const HotmockCommandPlan &plan = command_plan[REQUEST][t];
+			in_flight_num[t] = (unsigned int)plan.templates.size();
+			in_flight[t].reset((in_flight_num[t] > 0) ? new HotmockInFlight[in_flight_num[t]] : NULL);
+			for(unsigned int i=0;i<in_flight_num[t];i++){
+				in_flight[t][i].reset((HotmockConnectorType)t, plan.firstConnectorID + i);
+			}
 		}
 
-		return res;
+		//start non-blocking connect
+		server_ip = ip;
+		server_port = port;
+		ever_connected = false;
+		reconnect_count = 0;
+		reconnect_delay_ns = reconnect_min_delay_ns;
+		if(!io_external){ //I/O thread sleeps on io_poller until data arrives or a command is queued
+			if(io_thread_mode && io_poller.open() == 0){
+				transport.attach(&io_poller, 0);
+			}else{
+				transport.attach(NULL, 0);
+			}
+		}
+		startConnect();
+
+		//start I/O thread (unless HotmockClientManager drives the I/O)
+		if(io_thread_mode && !io_external){
+			io_running = true;
+			io_thread = std::thread(&HotmockClient::ioThreadMain, this);
+		}
+
+		return 0;
 	}
 
 	/*!
-	 * @brief Close socket and clear message
+	 * @brief Set size of the receive buffer, i.e. max # of bytes read by one recvDataFromHotmock() call
+	 * (at least min_recv_buffer_size). Takes effect at next initialize()
+	 * @param size buffer size in bytes
 	 */
-	void HotmockClient::finalize(){
-		if(sock != INVALID_SOCKET){
-			closesocket(sock);
-			sock = INVALID_SOCKET;
-		}
-		if(wsa_set){
-			WSACleanup();
-			wsa_set = false;
-		}
+	void HotmockClient::setRecvBufferSize(unsigned int size){
+		recv_buffer_size = (size < min_recv_buffer_size) ? min_recv_buffer_size : size;
+	}
 
-		message.clear();
-		PIRequestAcceptable.clear();
-		AIRequestAcceptable.clear();
-		GSRequestAcceptable.clear();
-		TSRequestAcceptable.clear();
+	/*!
+	 * @brief Select whether a dedicated I/O thread owns the socket. Takes effect at next initialize()
+	 * @param enable true: I/O thread sends commands, receives and parses messages, and hands samples
+	 * to recvDataFromHotmock() through a lock-free queue. false: everything runs in the caller's thread
+	 */
+	void HotmockClient::setIOThreadMode(bool enable){
+		if(!io_thread.joinable()){
+			io_thread_mode = enable;
+		}
 	}
 
 	/*!
-	 * @brief Connect to server
-	 * @param ip IP of the server
-	 * @param port port number of the server
-	 * @return 0 if no error, -1 if error
+	 * @brief Set max # of outstanding requests per connector. Takes effect at next initialize()
+	 * @param window 1 (wait for the response before next request) to HotmockInFlight::max_window
 	 */
-	int HotmockClient::connectToHotmock(const char *ip, unsigned short port){
-		struct sockaddr_in addr; //server address information
+	void HotmockClient::setRequestWindow(unsigned int window){
+		if(window < 1){
+			window = 1;
+		}else if(window > HotmockInFlight::max_window){
+			window = HotmockInFlight::max_window;
+		}
+		if(!io_thread.joinable()){
+			request_window = window;
+		}
+	}
 
-		//create socket
-		sock = socket(AF_INET, SOCK_STREAM, 0);
-		if(sock == INVALID_SOCKET){
-			std::cerr << "error in socket" << std::endl;
-			return -1;
+	/*!
+	 * @brief Set timeout of REQUEST. Takes effect at next initialize()
+	 * A request not answered by the timeout is sent again with doubled timeout (exponential backoff),
+	 * and given up after max_retry retransmissions so that the connector does not stop updating
+	 * @param timeout_ms timeout [ms] of the first transmission (0: no timeout)
+	 * @param max_retry max # of retransmissions
+	 */
+	void HotmockClient::setRequestTimeout(unsigned int timeout_ms, unsigned int max_retry){
+		if(!io_thread.joinable()){
+			request_timeout_ns = (unsigned long long)timeout_ms * 1000000ULL;
+			request_max_retry = max_retry;
 		}
+	}
 
-		addr.sin_family = AF_INET;    // host byte order
-		addr.sin_port = htons(port);  // short, network byte order  / port -> each program
-		addr.sin_addr.s_addr = inet_addr(ip);	// IP of the server
-		memset(&(addr.sin_zero), '\0', 8);  // zero the rest of the struct
+	/*!
+	 * @brief Get # of requests which were not answered by the deadline
+	 * @param type Connector type
+	 * @param connectorID Connector ID
+	 * @return # of timeouts (0 if the connector does not accept request)
+	 */
+	unsigned long HotmockClient::getTimeoutCount(HotmockConnectorType type, unsigned short connectorID) const{
+		HotmockInFlight *requests = getInFlight(type, connectorID);
+		return (requests != NULL) ? requests->timeouts.load(std::memory_order_relaxed) : 0;
+	}
 
-		std::cerr << "Connecting to the server:" << ip << " port:" << port << "..."  << std::endl;
+	/*!
+	 * @brief Get # of requests given up after the max # of retransmissions
+	 * @param type Connector type
+	 * @param connectorID Connector ID
+	 * @return # of requests given up (0 if the connector does not accept request)
+	 */
+	unsigned long HotmockClient::getDroppedRequestCount(HotmockConnectorType type, unsigned short connectorID) const{
+		HotmockInFlight *requests = getInFlight(type, connectorID);
+		return (requests != NULL) ? requests->dropped.load(std::memory_order_relaxed) : 0;
+	}
 
-		if(connect(sock, (sockaddr *)&addr, sizeof(sockaddr)) == -1){
-			std::cerr << "error in connect" << std::endl;
-			return -1;
+	/*!
+	 * @brief Close socket and clear message
+	 */
+	void HotmockClient::finalize(){
+		//stop I/O thread
+		if(io_thread.joinable()){
+			io_running = false;
+			ioWakeup();
+			io_thread.join();
 		}
-		std::cerr << "connected" << std::endl << std::endl;
+		command_queue.clear();
+		io_bytes = 0;
+		io_frames = 0;
+		io_recv_calls = 0;
+		io_send_commands = 0;
+		io_send_bytes = 0;
+		io_send_calls = 0;
 
-		//set nonblocking mode
-		u_long iMode = 1;
-		ioctlsocket(sock, FIONBIO, &iMode);
+		transport.close();
+		connection_state = Disconnected;
+		connection_lost = false;
 
-		return 0;
+		send_len = 0;
+		batching = false;
+		batch_commands = 0;
+		std::memset(&send_count, 0, sizeof(send_count));
+		std::memset(&send_status, 0, sizeof(send_status));
+
+		std::memset(&recv_status, 0, sizeof(recv_status));
+		frame_len = 0;
+		frame_overflow = false;
+		timer_wheel.reset(monotonicNanoseconds());
+		for(int t=0;t<connector_type_num;t++){
+			in_flight[t].reset();
+			in_flight_num[t] = 0;
+		}
 	}
 
 	/*!
@@ -199,22 +336,22 @@ namespace hotmock{
 	 * @param type HotmockConnectorType data to be converted
 	 * @return corresponding string
 	 */
-	std::string HotmockClient::HMConnectorTyepe2String(HotmockConnectorType type){
+	const char *HotmockClient::HMConnectorTyepe2String(HotmockConnectorType type) const{
 		switch(type){
 			case DI: //Digital Input
-				return std::string("DI");
+				return "DI";
 			case DO: //Digital Output
-				return std::string("DO");
+				return "DO";
 			case AI: //Analog Input
-				return std::string("AI");
+				return "AI";
 			case PI: //Pulse Input
-				return std::string("PI");
+				return "PI";
 			case GS: //Accelerometer (onboard)
-				return std::string("GS");
+				return "GS";
 			case TS: //Temperature Sensor (onboard)
-				return std::string("TS");
+				return "TS";
 			default:
-				return std::string("");
+				return "";
 		}
 	}
 
@@ -223,247 +360,1132 @@ namespace hotmock{
 	 * @param type HotmockClientCommand data to be converted
 	 * @return corresponding string
 	 */
-	std::string HotmockClient::HMClientCommand2String(HotmockClientCommand command){
+	const char *HotmockClient::HMClientCommand2String(HotmockClientCommand command) const{
 		switch(command){
 			case REQUEST: //Request current data
-				return std::string("REQUEST");
+				return "REQUEST";
 			case OUTPUT: //Output to device
-				return std::string("OUTPUT");
+				return "OUTPUT";
 			case INIT: //Initialize
-				return std::string("INIT");
+				return "INIT";
 			default:
-				return std::string("");
+				return "";
 		}
 	}
 
+	static const unsigned int max_integer_value = 999999999; //largest integer argument (9 digits)
+	static const unsigned int max_exponent_value = 999; //largest exponent of a real argument (beyond the range of double)
+
 	/*!
-	 * @brief Parse message received from Hotmock. The data value is stored corresponding HotmockData buffer
+	 * @brief Parse a connector ID or an unsigned integer argument
+	 * @param p Current position (moved to the first character not parsed)
+	 * @param end End of the frame
+	 * @param limit Largest valid value
+	 * @param value Parsed value
+	 * @return true if at least one digit was parsed and the value does not exceed limit
 	 */
-	void HotmockClient::parseMessage(){
-		std::string cmd;
-		std::string::size_type cmd_end_loc;
-		std::string::size_type loc1;
-		std::string::size_type loc2;
-		std::vector<std::string> args;
-		int connectorID;
+	static bool parseUnsigned(const char *&p, const char *end, unsigned int limit, unsigned int &value){
+		const char *start = p;
 
-		for(;;){
-			cmd_end_loc = message.find_first_of('&');
-			if(cmd_end_loc == std::string::npos){ //not contain command
-				break;
+		value = 0;
+		while(p < end && *p >= '0' && *p <= '9'){
+			unsigned int digit = (unsigned int)(*p - '0');
+			if(value > (limit - digit) / 10){ //value*10 + digit > limit
+				return false;
 			}
+			value = value*10 + digit;
+			p++;
+		}
+		return p != start;
+	}
 
-			//get all arguments devided by commas
-			cmd = message.substr(0, cmd_end_loc);
-			args.clear();
-			loc1 = 0;
-			int k=0;
-			do{
-				loc2 = cmd.substr(loc1).find_first_of(',');
-				args.push_back(cmd.substr(loc1,loc2));
-				loc1 += loc2+1;
-//				std::cout << "args[" << k << "]:" << args.back() << std::endl; //for debug
-				k++;
-			}while(loc2!=std::string::npos);
-
-
-			//set data depending on the connector type and ID
-			if(args[0].size()>=3){
-				//get connector ID
-				connectorID = std::stoi(args[0].substr(2));
-
-				//GS<connector ID>,<real>,<real>,<real>
-				if(args[0].substr(0,2)=="GS"){ //+3 argments
-					if(args.size()!=4){
-						std::cerr << "Invalid message received: " << message.substr(0,cmd_end_loc+1) << std::endl;
-					}else{
-						Vector3d value;
-						value.x = stof(args[1]);
-						value.y = stof(args[2]);
-						value.z = stof(args[3]);
-						GSData.setData(connectorID, value);
-						GSRequestAcceptable[connectorID-connector_info.GSFirstConnectorID] = true;
-					}
-				}else{ //+1 argment
-					if(args.size()!=2){
-						std::cerr << "Invalid message received: " << message.substr(0,cmd_end_loc+1) << std::endl;
-					}else{
-						//DI<connector ID>,<unsigned integer>
-						if(message.substr(0,2)=="DI"){
-							unsigned char value = (unsigned char)stoi(args[1]);
-							DIData.setData(connectorID, value);
-						}else{
-							//{PI,AI,TS}<connector ID>,<real>
-							double value = stof(args[1]);
-							if(message.substr(0,2)=="PI"){
-								PIData.setData(connectorID, value);
-								PIRequestAcceptable[connectorID-connector_info.PIFirstConnectorID] = true;
-							}else if(message.substr(0,2)=="AI"){
-								AIData.setData(connectorID, value);
-								AIRequestAcceptable[connectorID-connector_info.AIFirstConnectorID] = true;
-							}else if(message.substr(0,2)=="TS"){
-								TSData.setData(connectorID, value);
-								TSRequestAcceptable[connectorID-connector_info.TSFirstConnectorID] = true;
-							}else{
-								std::cerr << "Invalid message received: " << message.substr(0,cmd_end_loc+1) << std::endl;
-							}
-						}
-					}
-				}
+	/*!
+	 * @brief Parse a real number argument ([+-]digits[.digits][(e|E)[+-]digits])
+	 * @param p Current position (moved to the first character not parsed)
+	 * @param end End of the frame
+	 * @param value Parsed value
+	 * @return true if at least one digit was parsed and the exponent does not exceed max_exponent_value
+	 */
+	static bool parseReal(const char *&p, const char *end, double &value){
+		static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+			1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+		bool negative = false;
+		bool digits = false;
+		unsigned long long mantissa = 0;
+		int exponent = 0;
+
+		if(p < end && (*p == '+' || *p == '-')){
+			negative = (*p == '-');
+			p++;
+		}
+		for(; p < end && *p >= '0' && *p <= '9'; p++){
+			digits = true;
+			if(mantissa < 100000000000000000ULL){
+				mantissa = mantissa*10 + (*p - '0');
 			}else{
-				std::cerr << "Invalid message received: " << message.substr(0,cmd_end_loc+1) << std::endl;
-			} //end if(args[0].size()<3)
+				exponent++; //drop digits beyond double precision
+			}
+		}
+		if(p < end && *p == '.'){
+			for(p++; p < end && *p >= '0' && *p <= '9'; p++){
+				digits = true;
+				if(mantissa < 100000000000000000ULL){
+					mantissa = mantissa*10 + (*p - '0');
+					exponent--;
+				}
+			}
+		}
+		if(!digits){
+			return false;
+		}
+		if(p < end && (*p == 'e' || *p == 'E')){
+			const char *q = p+1;
+			bool exp_negative = false;
+			unsigned int exp_value;
+			if(q < end && (*q == '+' || *q == '-')){
+				exp_negative = (*q == '-');
+				q++;
+			}
+			if(parseUnsigned(q, end, max_exponent_value, exp_value)){
+				exponent += exp_negative ? -(int)exp_value : (int)exp_value;
+				p = q;
+			}else if(q < end && *q >= '0' && *q <= '9'){ //exponent out of range
+				return false;
+			}
+		}
+
+		value = (double)mantissa;
+		while(exponent > 22){
+			value *= pow10[22];
+			exponent -= 22;
+		}
+		while(exponent < -22){
+			value /= pow10[22];
+			exponent += 22;
+		}
+		value = (exponent >= 0) ? value*pow10[exponent] : value/pow10[-exponent];
+		if(negative){
+			value = -value;
+		}
+		return true;
+	}
 
-			//erase processed message
-			message.erase(0,cmd_end_loc+1);
-		} //end for(;;)
+	/*!
+	 * @brief Parse one frame "<connector type><connector ID>,<value>[,<value>,<value>]" (without the delimiter '&').
+	 * The data value is stored corresponding HotmockData buffer
+	 * @param begin Beginning of the frame
+	 * @param end End of the frame (position of the delimiter)
+	 * @return 0 if no error, -1 if invalid frame
+	 */
+	int HotmockClient::parseFrame(const char *begin, const char *end){
+		const char *p = begin+2;
+		unsigned int connectorID;
 
-		return;
+		//get connector ID
+		if(end-begin < 3 || !parseUnsigned(p, end, USHRT_MAX, connectorID) || p >= end || *p != ','){
+			HMLOG_ERROR("Invalid message received: {}&", LogBytes(begin, end-begin));
+			return -1;
+		}
+		p++;
+
+		//set data depending on the connector type and ID
+		HotmockSample sample;
+		sample.connectorID = (unsigned short)connectorID;
+		sample.time_ns = recv_time_ns;
+		if(begin[0]=='G' && begin[1]=='S'){
+			//GS<connector ID>,<real>,<real>,<real>
+			sample.type = GS;
+			if(parseReal(p, end, sample.value[0]) && p < end && *p++ == ','
+				&& parseReal(p, end, sample.value[1]) && p < end && *p++ == ','
+				&& parseReal(p, end, sample.value[2]) && p == end){
+				storeSample(sample);
+				return 0;
+			}
+		}else if(begin[0]=='D' && begin[1]=='I'){
+			//DI<connector ID>,<unsigned integer>
+			unsigned int value;
+			sample.type = DI;
+			if(parseUnsigned(p, end, max_integer_value, value) && p == end){
+				sample.value[0] = value;
+				storeSample(sample);
+				return 0;
+			}
+		}else{
+			//{PI,AI,TS}<connector ID>,<real>
+			bool valid = true;
+			if(begin[0]=='P' && begin[1]=='I'){
+				sample.type = PI;
+			}else if(begin[0]=='A' && begin[1]=='I'){
+				sample.type = AI;
+			}else if(begin[0]=='T' && begin[1]=='S'){
+				sample.type = TS;
+			}else{
+				valid = false;
+			}
+			if(valid && parseReal(p, end, sample.value[0]) && p == end){
+				storeSample(sample);
+				return 0;
+			}
+		}
+
+		HMLOG_ERROR("Invalid message received: {}&", LogBytes(begin, end-begin));
+		return -1;
 	}
 
 	/*!
-	 * @brief Send command to Hotmock
-	 * @param cmd Command
-	 * @param type Connector type
-	 * @param connectorID Connector ID
-	 * @param param Parameter for the command
-	 * @return number of bytes sent if on success, -1 if send error, <-2 if invalid arguments
+	 * @brief Store decoded sample. The connector accepts a new request after its response arrived.
+	 * @param sample decoded sample
+	 * @return 0 if no error, -1 if out of range, -2 if buffer full (the oldest data was dropped)
 	 */
-	int HotmockClient::sendCommandToHotmock(HotmockClientCommand cmd, HotmockConnectorType type, unsigned short connectorID, int param){
-		int res;
-		std::ostringstream oss;
-		std::string command = HMClientCommand2String(cmd);
-		std::string connector = HMConnectorTyepe2String(type);
-		unsigned short id;
+	int HotmockClient::storeSample(const HotmockSample &sample){
+		unsigned short first;
 		unsigned int num;
-		std::vector<bool>::iterator it_ra_vect;
 
-		//check command
-		//check if connector ID is correct
+		if(!getConnectorRange(sample.type, first, num) || sample.connectorID < first || sample.connectorID >= first + num){
+			HMLOG_ERROR("Error in HotmockClient::storeSample(): out of range ({}{})", HMConnectorTyepe2String(sample.type), sample.connectorID);
+			return -1;
+		}
+
+		//match the response to the oldest outstanding request
+		HotmockInFlight *requests = getInFlight(sample.type, sample.connectorID);
+		if(requests != NULL){
+			if(requests->outstanding() > 0){
+				requests->answered++;
+				armRequestTimer(*requests);
+			}else{
+				requests->unmatched++;
+			}
+		}
+
+		int res = setSample(sample);
+		if(res != -1){
+			notifySample(sample);
+		}
+		return res;
+	}
+
+	/*!
+	 * @brief Set sample to corresponding HotmockData buffer
+	 * @param sample decoded sample
+	 * @return 0 if no error, -1 if out of range, -2 if buffer full (the oldest data was dropped)
+	 */
+	int HotmockClient::setSample(const HotmockSample &sample){
+		switch(sample.type){
+			case DI:
+				return DIData.setData(sample.connectorID, (unsigned char)sample.value[0], sample.time_ns);
+			case PI:
+				return PIData.setData(sample.connectorID, sample.value[0], sample.time_ns);
+			case AI:
+				return AIData.setData(sample.connectorID, sample.value[0], sample.time_ns);
+			case TS:
+				return TSData.setData(sample.connectorID, sample.value[0], sample.time_ns);
+			case GS:
+				{
+					Vector3d value;
+					value.x = sample.value[0];
+					value.y = sample.value[1];
+					value.z = sample.value[2];
+					return GSData.setData(sample.connectorID, value, sample.time_ns);
+				}
+			default:
+				return -1;
+		}
+	}
+
+	/*!
+	 * @brief Mark the connector of a stored sample ready and call its subscriptions
+	 * @param sample decoded sample
+	 */
+	void HotmockClient::notifySample(const HotmockSample &sample){
+		if(sample.connectorID > max_connector_id){
+			return;
+		}
+		ready_mask[sample.type].fetch_or(1ULL << sample.connectorID, std::memory_order_release);
+
+		const HotmockSubscription &connector = connector_subscription[sample.type][sample.connectorID];
+		if(connector.callback != NULL){
+			connector.callback(sample, connector.context);
+		}
+		const HotmockSubscription &type = type_subscription[sample.type];
+		if(type.callback != NULL){
+			type.callback(sample, type.context);
+		}
+	}
+
+	/*!
+	 * @brief Parse message received from Hotmock without copying complete frames.
+	 * A frame split across recv() calls is kept in frame[] until its delimiter '&' arrives.
+	 * @param buf Received bytes
+	 * @param len Number of received bytes
+	 * @return number of valid frames parsed
+	 */
+	int HotmockClient::parseMessage(const char *buf, int len){
+		const char *p = buf;
+		const char *end = buf + len;
+		const char *delim;
+		int frames = 0;
+
+		//complete the frame left by the previous recv()
+		if(frame_len > 0 || frame_overflow){
+			delim = (const char *)std::memchr(p, '&', end-p);
+			int n = (int)(((delim != NULL) ? delim : end) - p);
+			if(!frame_overflow && frame_len + n <= max_frame_size){
+				std::memcpy(frame+frame_len, p, n);
+				frame_len += n;
+			}else{
+				frame_overflow = true;
+			}
+			if(delim == NULL){ //delimiter not arrived yet
+				return 0;
+			}
+
+			if(frame_overflow){
+				HMLOG_ERROR("Invalid message received: frame longer than {} bytes", (int)max_frame_size);
+			}else if(parseFrame(frame, frame+frame_len) == 0){
+				frames++;
+			}
+			frame_len = 0;
+			frame_overflow = false;
+			p = delim+1;
+		}
+
+		//parse complete frames in place
+		while(p < end && (delim = (const char *)std::memchr(p, '&', end-p)) != NULL){
+			if(parseFrame(p, delim) == 0){
+				frames++;
+			}
+			p = delim+1;
+		}
+
+		//keep incomplete frame
+		if(p < end){
+			int n = (int)(end-p);
+			if(n <= max_frame_size){
+				std::memcpy(frame, p, n);
+				frame_len = n;
+			}else{
+				frame_overflow = true;
+			}
+		}
+
+		return frames;
+	}
+
+	/*!
+	 * @brief Get range of connector IDs
+	 * @param type Connector type
+	 * @param firstConnectorID ID number assigned to first connector
+	 * @param connectorNum # of connectors
+	 * @return true if no error, false if invalid connector type
+	 */
+	bool HotmockClient::getConnectorRange(HotmockConnectorType type, unsigned short &firstConnectorID, unsigned int &connectorNum) const{
 		switch(type){
 			case DI:
-				id = connector_info.DIFirstConnectorID;
-				num = connector_info.DIConnectorNum;
-				break;
+				firstConnectorID = connector_info.DIFirstConnectorID;
+				connectorNum = connector_info.DIConnectorNum;
+				return true;
 			case DO:
-				id = connector_info.DOFirstConnectorID;
-				num = connector_info.DOConnectorNum;
-				break;
+				firstConnectorID = connector_info.DOFirstConnectorID;
+				connectorNum = connector_info.DOConnectorNum;
+				return true;
 			case AI:
-				id = connector_info.AIFirstConnectorID;
-				num = connector_info.AIConnectorNum;
-				break;
+				firstConnectorID = connector_info.AIFirstConnectorID;
+				connectorNum = connector_info.AIConnectorNum;
+				return true;
 			/*
 			case AO:
-				id = connector_info.AOFirstConnectorID;
-				num = connector_info.AOConnectorNum;
-				break;
+				firstConnectorID = connector_info.AOFirstConnectorID;
+				connectorNum = connector_info.AOConnectorNum;
+				return true;
 			*/
 			case PI:
-				id = connector_info.PIFirstConnectorID;
-				num = connector_info.PIConnectorNum;
-				break;
+				firstConnectorID = connector_info.PIFirstConnectorID;
+				connectorNum = connector_info.PIConnectorNum;
+				return true;
 			case GS:
-				id = connector_info.GSFirstConnectorID;
-				num = connector_info.GSConnectorNum;
-				break;
+				firstConnectorID = connector_info.GSFirstConnectorID;
+				connectorNum = connector_info.GSConnectorNum;
+				return true;
 			case TS:
-				id = connector_info.TSFirstConnectorID;
-				num = connector_info.TSConnectorNum;
-				break;
+				firstConnectorID = connector_info.TSFirstConnectorID;
+				connectorNum = connector_info.TSConnectorNum;
+				return true;
 			default:
-				std::cerr << "Error in HotmockClient::sendCommandToHotmock(): invalid connector type" << std::endl;
-				return -2;
+				return false;
+		}
+	}
+
+	/*!
+	 * @brief Get outstanding requests of a connector
+	 * @param type Connector type
+	 * @param connectorID Connector ID
+	 * @return pointer to the outstanding requests, NULL if the connector does not accept request or out of range
+	 */
+	HotmockInFlight *HotmockClient::getInFlight(HotmockConnectorType type, unsigned short connectorID) const{
+		if((unsigned int)type >= (unsigned int)connector_type_num){
+			return NULL;
+		}
+		unsigned int index = (unsigned int)(connectorID - command_plan[REQUEST][type].firstConnectorID);
+		if(index >= in_flight_num[type]){
+			return NULL;
 		}
-		if(connectorID < id || connectorID >= id + num){
-			std::cerr << "Error in HotmockClient::sendCommandToHotmock(): connectorID out of range: connector=" << connector << connectorID << std::endl;
+		return &in_flight[type][index];
+	}
+
+	/*!
+	 * @brief Schedule the timer of a connector at the deadline of its oldest outstanding request
+	 * (cancelled if nothing is outstanding)
+	 * @param requests Outstanding requests of the connector
+	 */
+	void HotmockClient::armRequestTimer(HotmockInFlight &requests){
+		if(request_timeout_ns == 0){
+			return;
+		}
+		if(requests.outstanding() > 0){
+			timer_wheel.schedule(&requests.timer, requests.deadline[requests.answered % HotmockInFlight::max_window]);
+		}else{
+			timer_wheel.cancel(&requests.timer);
+		}
+	}
+
+	/*!
+	 * @brief Expire requests whose deadline has passed. Costs O(# of elapsed ticks + # of expired timers)
+	 */
+	void HotmockClient::checkTimeouts(){
+		if(request_timeout_ns == 0 || timer_wheel.size() == 0 || connection_state != Connected){
+			return;
+		}
+		timer_now = monotonicNanoseconds();
+		timer_wheel.advance(timer_now, &HotmockClient::requestTimeoutCallback, this);
+	}
+
+	/*!
+	 * @brief Called by the timing wheel when the timer of a connector expires
+	 * @param node Timer of HotmockInFlight
+	 * @param context HotmockClient
+	 */
+	void HotmockClient::requestTimeoutCallback(HotmockTimerNode *node, void *context){
+		static_cast<HotmockClient *>(context)->handleRequestTimeout(*static_cast<HotmockInFlight *>(node->data));
+	}
+
+	/*!
+	 * @brief Give up the expired requests of a connector and retransmit them with doubled timeout.
+	 * The retransmitted request gets a new sequence number, so a late response is matched to the next request
+	 * @param requests Outstanding requests of the connector
+	 */
+	void HotmockClient::handleRequestTimeout(HotmockInFlight &requests){
+		const HotmockCommandPlan &plan = command_plan[REQUEST][requests.type];
+		const HotmockCommandTemplate &tmpl = plan.templates[requests.connectorID - plan.firstConnectorID];
+
+		while(requests.outstanding() > 0 && connection_state == Connected){ //resent by rearmRequests() after reconnect
+			unsigned int slot = requests.answered % HotmockInFlight::max_window;
+			if(requests.deadline[slot] > timer_now){
+				break;
+			}
+			int param = requests.param[slot];
+			unsigned int retry = requests.retry[slot];
+
+			requests.timeouts.fetch_add(1, std::memory_order_relaxed);
+			requests.answered++;
+
+			if(retry >= request_max_retry || appendCommand(tmpl, param) < 0){
+				requests.dropped.fetch_add(1, std::memory_order_relaxed);
+				HMLOG_WARN("Error in HotmockClient::handleRequestTimeout(): request given up: connector={}{}", HMConnectorTyepe2String(requests.type), requests.connectorID);
+				continue;
+			}
+
+			//retransmit with exponential backoff
+			retry++;
+			slot = requests.sent % HotmockInFlight::max_window;
+			requests.param[slot] = param;
+			requests.deadline[slot] = timer_now + (request_timeout_ns << ((retry < 6) ? retry : 6));
+			requests.retry[slot] = (unsigned char)retry;
+			requests.sent++;
+		}
+		armRequestTimer(requests);
+	}
+
+	/*!
+	 * @brief Register a function called as soon as a data value of the connector is decoded.
+	 * The function is called by the thread which parses the data (I/O thread in I/O thread mode,
+	 * the caller of recvDataFromHotmock() otherwise), so it must return quickly and must not call this client.
+	 * Subscribe before initialize() (or before the I/O thread starts); subscriptions are kept by initialize()
+	 * @param type Connector type
+	 * @param connectorID Connector ID (0: every connector of the type)
+	 * @param callback Function to be called (NULL to unsubscribe)
+	 * @param context Pointer passed to callback
+	 * @return 0 if no error, -1 if invalid arguments
+	 */
+	int HotmockClient::subscribe(HotmockConnectorType type, unsigned short connectorID, HotmockDataCallback callback, void *context){
+		if(type < DI || type > TS || connectorID > max_connector_id){
+			HMLOG_ERROR("Error in HotmockClient::subscribe(): Invalid arguments");
+			return -1;
+		}
+
+		HotmockSubscription &subscription = (connectorID == 0) ? type_subscription[type] : connector_subscription[type][connectorID];
+		subscription.callback = callback;
+		subscription.context = context;
+		return 0;
+	}
+
+	/*!
+	 * @brief Remove the function registered by subscribe()
+	 * @param type Connector type
+	 * @param connectorID Connector ID (0: the function for every connector of the type)
+	 * @return 0 if no error, -1 if invalid arguments
+	 */
+	int HotmockClient::unsubscribe(HotmockConnectorType type, unsigned short connectorID){
+		return subscribe(type, connectorID, NULL, NULL);
+	}
+
+	/*!
+	 * @brief Get connectors which received data since the last call and clear them.
+	 * Only the connectors whose bit is set need to be read with isNew()/getLatestData()
+	 * @param type Connector type
+	 * @return bit n is set if connector ID n received data
+	 */
+	unsigned long long HotmockClient::takeReadyConnectors(HotmockConnectorType type){
+		if(type < DI || type > TS){
+			return 0;
+		}
+		if(ready_mask[type].load(std::memory_order_relaxed) == 0){ //nothing arrived: no write to the shared cache line
+			return 0;
+		}
+		return ready_mask[type].exchange(0, std::memory_order_acquire);
+	}
+
+	/*!
+	 * @brief Send command to Hotmock. Between beginBatch() and flush(), the command is stored and sent by flush().
+	 * In I/O thread mode, the command is queued and I/O thread is woken up to send all queued commands at once
+	 * (woken up by flush() between beginBatch() and flush()).
+	 * @param cmd Command
+	 * @param type Connector type
+	 * @param connectorID Connector ID
+	 * @param param Parameter for the command
+	 * @return number of bytes sent or stored (0 if queued) if on success, -1 if send error, <-2 if invalid arguments
+	 */
+	int HotmockClient::sendCommandToHotmock(HotmockClientCommand cmd, HotmockConnectorType type, unsigned short connectorID, int param){
+		int res = checkCommand(cmd, type, connectorID, param);
+		if(res != 0){
+			return res;
+		}
+
+		if(io_thread_mode){
+			HotmockCommand command;
+			command.cmd = cmd;
+			command.type = type;
+			command.connectorID = connectorID;
+			command.param = param;
+			if(!command_queue.push(command)){
+				HMLOG_ERROR("Error in HotmockClient::sendCommandToHotmock(): command queue full");
+				return -1;
+			}
+			if(batching){
+				batch_commands++;
+			}else{
+				ioWakeup();
+			}
+			return 0;
+		}
+
+		res = writeCommand(cmd, type, connectorID, param);
+		if(res > 0 && !batching){
+			if(flushSendBuffer() < 0){
+				return -1;
+			}
+		}
+		return res;
+	}
+
+	/*!
+	 * @brief Start a batch: commands are stored in the send buffer until flush() is called
+	 */
+	void HotmockClient::beginBatch(){
+		batching = true;
+		if(io_thread_mode){ //I/O thread sends the queued commands with one send() when woken up by flush()
+			return;
+		}
+		std::memset(&send_count, 0, sizeof(send_count));
+	}
+
+	/*!
+	 * @brief Send all commands stored since beginBatch() with one send() and update statistics.
+	 * In I/O thread mode the I/O thread is woken up to send the queued commands, and only the # of commands is recorded
+	 * @return number of bytes sent (0 in I/O thread mode), -1 if send error
+	 */
+	int HotmockClient::flush(){
+		int res = 0;
+
+		if(io_thread_mode){
+			batching = false;
+			send_status.commands = batch_commands;
+			send_status.bytes = 0;
+			send_status.send_calls = 0;
+			if(batch_commands > 0){
+				batch_commands = 0;
+				ioWakeup();
+			}
+			return 0;
+		}
+
+		batching = false;
+		if(send_len > 0){
+			res = flushSendBuffer();
+		}
+		send_status = send_count;
+		return res;
+	}
+
+	/*!
+	 * @brief Get statistics of the sends done by the I/O thread since the last call.
+	 * They include every batch and retransmission sent in the meantime, so they lag behind flush()
+	 * @return # of commands, bytes and send() calls (all 0 if not in I/O thread mode)
+	 */
+	HotmockSendStatus HotmockClient::getIOSendStatus(){
+		HotmockSendStatus status;
+
+		status.commands = io_send_commands.exchange(0);
+		status.bytes = io_send_bytes.exchange(0);
+		status.send_calls = io_send_calls.exchange(0);
+		return status;
+	}
+
+	/*!
+	 * @brief Send data in the send buffer. Data not accepted by the socket is kept for the next call
+	 * (commands stored while not connected are sent after the connection is established)
+	 * @return number of bytes sent, -1 if send error (connection closed)
+	 */
+	int HotmockClient::flushSendBuffer(){
+		int sent = 0;
+		int res;
+
+		if(connection_state != Connected){
+			return 0;
+		}
+
+		while(sent < send_len){
+			res = transport.send(send_buffer+sent, send_len-sent);
+			send_count.send_calls++;
+			if(res < 0){
+				HMLOG_ERROR("Error in HotmockClient::flushSendBuffer(): send error");
+				handleDisconnect();
+				return -1;
+			}
+			if(res == 0){ //socket buffer full
+				break;
+			}
+			sent += res;
+			send_count.bytes += res;
+		}
+
+		if(sent > 0){
+			std::memmove(send_buffer, send_buffer+sent, send_len-sent);
+			send_len -= sent;
+		}
+		return sent;
+	}
+
+	/*!
+	 * @brief Precompile the bytes of every valid (command, connector type, connector ID) combination.
+	 * Invalid combinations get no templates and are rejected by checkCommand()
+	 */
+	void HotmockClient::buildCommandPlan(){
+		for(int c=0;c<command_num;c++){
+			for(int t=0;t<connector_type_num;t++){
+				HotmockClientCommand cmd = (HotmockClientCommand)c;
+				HotmockConnectorType type = (HotmockConnectorType)t;
+				HotmockCommandPlan &plan = command_plan[c][t];
+
+				getConnectorRange(type, plan.firstConnectorID, plan.connectorNum);
+				plan.templates.clear();
+				plan.pending.clear();
+
+				//valid combination: REQUEST for AI,PI,GS,TS, OUTPUT for DO, INIT for PI
+				if(!((cmd==REQUEST && (type==AI || type==PI || type==GS || type==TS)) || (cmd==OUTPUT && type==DO) || (cmd==INIT && type==PI))){
+					continue;
+				}
+
+				plan.templates.resize(plan.connectorNum);
+				if(cmd != REQUEST){
+					plan.pending.assign(plan.connectorNum, (int)HotmockCommandPlan::no_pending);
+				}
+				for(unsigned int i=0;i<plan.connectorNum;i++){
+					HotmockCommandTemplate &tmpl = plan.templates[i];
+					unsigned int id = plan.firstConnectorID + i;
+					const char *cmd_str = HMClientCommand2String(cmd);
+					const char *type_str = HMConnectorTyepe2String(type);
+					int len = 0;
+
+					//"<command>,<connector type><2 digit connector ID>,"
+					std::memcpy(tmpl.bytes+len, cmd_str, std::strlen(cmd_str));
+					len += (int)std::strlen(cmd_str);
+					tmpl.bytes[len++] = ',';
+					std::memcpy(tmpl.bytes+len, type_str, std::strlen(type_str));
+					len += (int)std::strlen(type_str);
+					tmpl.bytes[len++] = (char)('0' + (id/10)%10);
+					tmpl.bytes[len++] = (char)('0' + id%10);
+					tmpl.bytes[len++] = ',';
+					tmpl.len = (unsigned char)len;
+				}
+			}
+		}
+	}
+
+	/*!
+	 * @brief Check command arguments against the command plan
+	 * @param cmd Command
+	 * @param type Connector type
+	 * @param connectorID Connector ID
+	 * @param param Parameter for the command
+	 * @return 0 if valid, <-2 if invalid arguments
+	 */
+	int HotmockClient::checkCommand(HotmockClientCommand cmd, HotmockConnectorType type, unsigned short connectorID, int param){
+		//check command
+		//check if connector ID is correct
+		if((unsigned int)type >= (unsigned int)connector_type_num){
+			HMLOG_ERROR("Error in HotmockClient::sendCommandToHotmock(): invalid connector type");
+			return -2;
+		}
+		if((unsigned int)cmd >= (unsigned int)command_num){
+			HMLOG_ERROR("Error in HotmockClient::sendCommandToHotmock(): invalid command");
+			return -4;
+		}
+
+		const HotmockCommandPlan &plan = command_plan[cmd][type];
+		if(connectorID < plan.firstConnectorID || connectorID >= plan.firstConnectorID + plan.connectorNum){
+			HMLOG_ERROR("Error in HotmockClient::sendCommandToHotmock(): connectorID out of range: connector={}{}", HMConnectorTyepe2String(type), connectorID);
 			return -3;
 		}
 
 		//check if combination of command and type is correct
-		if(cmd==REQUEST){
-			switch(type){
-				case PI:
-					if(!PIRequestAcceptable[connectorID-connector_info.PIFirstConnectorID]){return 0;} //request not accepted
-					it_ra_vect = PIRequestAcceptable.begin();
-					advance(it_ra_vect, connectorID-connector_info.PIFirstConnectorID);
-					break;
-				case AI:
-					if(!AIRequestAcceptable[connectorID-connector_info.AIFirstConnectorID]){return 0;} //request not accepted
-					it_ra_vect = AIRequestAcceptable.begin();
-					advance(it_ra_vect, connectorID-connector_info.AIFirstConnectorID);
-					break;
-				case GS:
-					if(!GSRequestAcceptable[connectorID-connector_info.GSFirstConnectorID]){return 0;} //request not accepted
-					it_ra_vect = GSRequestAcceptable.begin();
-					advance(it_ra_vect, connectorID-connector_info.GSFirstConnectorID);
-					break;
-				case TS:
-					if(!TSRequestAcceptable[connectorID-connector_info.TSFirstConnectorID]){return 0;} //request not accepted
-					it_ra_vect = TSRequestAcceptable.begin();
-					advance(it_ra_vect, connectorID-connector_info.TSFirstConnectorID);
-					break;
-				default:
-					std::cerr << "Error in HotmockClient::sendCommandToHotmock(): invalid combination of command and connector type: command="  << command << ", connector type=" << connector << std::endl;
-					return -4;
+		if(plan.templates.empty()){
+			HMLOG_ERROR("Error in HotmockClient::sendCommandToHotmock(): invalid combination of command and connector type: command={}, connector type={}", HMClientCommand2String(cmd), HMConnectorTyepe2String(type));
+			return -4;
+		}
+		if(cmd==REQUEST && param!=0 && param!=1){
+			HMLOG_ERROR("Error in HotmockClient::sendCommandToHotmock(): invalid parameter: command={}, connector type={}, parameter={}", HMClientCommand2String(cmd), HMConnectorTyepe2String(type), param);
+			return -5;
+		}
+
+		return 0;
+	}
+
+	/*!
+	 * @brief Store checked command in the send buffer. REQUEST is repeated until the connector has
+	 * request_window outstanding requests (nothing is sent if the window is already full)
+	 * @param cmd Command
+	 * @param type Connector type
+	 * @param connectorID Connector ID
+	 * @param param Parameter for the command (no parameter if negative)
+	 * @return number of bytes stored if on success (0 if request not accepted), -1 if send error
+	 */
+	int HotmockClient::writeCommand(HotmockClientCommand cmd, HotmockConnectorType type, unsigned short connectorID, int param){
+		const HotmockCommandPlan &plan = command_plan[cmd][type];
+		const HotmockCommandTemplate &tmpl = plan.templates[connectorID - plan.firstConnectorID];
+
+		if(connection_state != Connected){
+			//OUTPUT/INIT: only the latest one is sent after the connection is established
+			//REQUEST: data requested now would be lost
+			if(cmd != REQUEST){
+				command_plan[cmd][type].pending[connectorID - plan.firstConnectorID] = param;
 			}
-			if(param!=0 && param!=1){
-				std::cerr << "Error in HotmockClient::sendCommandToHotmock(): invalid parameter: command="  << command << ", connector type=" << connector << ", parameter=" << param << std::endl;		
-				return -5;
+			return 0;
+		}
+		if(cmd != REQUEST){
+			return appendCommand(tmpl, param);
+		}
+
+		//fill the in-flight window of the connector
+		HotmockInFlight &requests = in_flight[type][connectorID - plan.firstConnectorID];
+		bool idle = (requests.outstanding() == 0);
+		unsigned long long deadline = 0;
+		int total = 0;
+		if(request_timeout_ns > 0 && requests.outstanding() < request_window){
+			deadline = monotonicNanoseconds() + request_timeout_ns;
+		}
+		while(requests.outstanding() < request_window){
+			int res = appendCommand(tmpl, param);
+			if(res < 0){
+				return -1;
 			}
-		}else if(((cmd==OUTPUT) && (type != DO)) || ((cmd==INIT) && (type != PI))){
-			std::cerr << "Error in HotmockClient::sendCommandToHotmock(): invalid combination of command and connector type: command="  << command << ", connector type=" << connector << std::endl;
-			return -4;
+			unsigned int slot = requests.sent % HotmockInFlight::max_window;
+			requests.param[slot] = param;
+			requests.deadline[slot] = deadline;
+			requests.retry[slot] = 0;
+			requests.sent++;
+			total += res;
+		}
+		if(idle && total > 0){ //the timer runs while requests are outstanding
+			armRequestTimer(requests);
+		}
+		return total;
+	}
+
+	/*!
+	 * @brief Copy command template to the send buffer and write the parameter
+	 * @param tmpl Command template
+	 * @param param Parameter for the command (no parameter if negative)
+	 * @return number of bytes stored, -1 if send error
+	 */
+	int HotmockClient::appendCommand(const HotmockCommandTemplate &tmpl, int param){
+		char digits[12]; //parameter written from the end
+		int digit_len = 0;
+		int len;
+
+		//format parameter (usually a single digit)
+		if(param >= 0){
+			unsigned int value = (unsigned int)param;
+			do{
+				digits[sizeof(digits) - ++digit_len] = (char)('0' + value%10);
+				value /= 10;
+			}while(value != 0);
+			len = tmpl.len + digit_len + 1;
+		}else{
+			len = tmpl.len; //',' of the template is replaced by '&'
 		}
 
+		if(send_len + len > send_buffer_size){ //buffer full: send stored commands first
+			if(flushSendBuffer() < 0 || send_len + len > send_buffer_size){
+				return -1;
+			}
+		}
 
 		//set command
-		oss << command << ',' << connector << std::setfill('0') << std::setw(2) << connectorID;
+		char *p = send_buffer + send_len;
 		if(param >= 0){
-			oss << ',' << param;
+			std::memcpy(p, tmpl.bytes, tmpl.len);
+			std::memcpy(p + tmpl.len, digits + sizeof(digits) - digit_len, digit_len);
+		}else{
+			std::memcpy(p, tmpl.bytes, tmpl.len - 1);
 		}
-		oss << '&'; //add delimiter
+		p[len-1] = '&'; //add delimiter
+		send_len += len;
+		send_count.commands++;
+		return len;
+	}
+
+	/*!
+	 * @brief Receive data from Hotmock.
+	 * In I/O thread mode, I/O thread has already stored the samples to HotmockData buffers and this only
+	 * collects the statistics. Otherwise the connection is updated and the socket is read and parsed
+	 * in the caller's thread. A lost connection is reconnected automatically.
+	 * @return received message size if no error (0 while not connected), -1 once when the connection is lost
+	 */
+	int HotmockClient::recvDataFromHotmock(){
+		int res = 0;
+
+		std::memset(&recv_status, 0, sizeof(recv_status));
 
-		std::cout << "send command:" << oss.str() << " size:" << oss.str().size() << std::endl;
-		res = send(sock,oss.str().c_str(),oss.str().size(),0);
-		//set flag
-		if(res >= 0 && cmd == REQUEST){
-			*it_ra_vect = false;
+		if(io_thread_mode){
+			recv_status.bytes = io_bytes.exchange(0);
+			recv_status.frames = io_frames.exchange(0);
+			recv_status.recv_calls = io_recv_calls.exchange(0);
+			if(connection_lost.exchange(false)){ //I/O thread lost the connection
+				return -1;
+			}
+			return (int)recv_status.bytes;
+		}
+
+		if(updateConnection(0)){
+			//check readiness instead of calling recv() blindly
+			res = transport.wait(0);
+			if(res > 0){
+				res = receiveData(recv_status);
+			}else if(res < 0){
+				handleDisconnect();
+			}
+		}
+		if(connection_lost.exchange(false)){
+			return -1;
+		}
+
+		//retransmit requests whose response did not arrive
+		checkTimeouts();
+		if(!batching && send_len > 0){
+			if(flushSendBuffer() < 0){
+				return -1;
+			}
 		}
 		return res;
 	}
 
 	/*!
-	 * @brief Send command to Hotmock
-	 * @param cmd Command
-	 * @param type Target connector type of the command
-	 * @param connectorID Target connector ID of the command
-	 * @param param Parameter for the command
-	 * @return received message size if no error, negative value if error
+	 * @brief Main loop of I/O thread: send queued commands, sleep until data arrives, a command is queued
+	 * or the next deadline (reconnect, request timeout), and parse the data
 	 */
-	int HotmockClient::recvDataFromHotmock(){
-		const int bufsize = 256;
-		int res;
-		char buf[bufsize];
+	void HotmockClient::ioThreadMain(){
+		bool ready;
 
-		std::memset(buf,0,bufsize-1);
-		res = recv(sock,buf,bufsize-1,0);
-		if(res > 0){
-			std::cout << "received: " << buf << std::endl;
-			message += buf;
-			std::cout << "message in buffer: " << message << std::endl;
+		while(io_running){
+			bool connected = ioPrepare(0);
 
-			parseMessage();
+			unsigned long long now = monotonicNanoseconds();
+			int res = io_poller.wait(&ready, 1, timeoutMilliseconds(ioDeadline(now), now));
+			if(res < 0){ //poller is not available: poll the socket
+				if(connected){
+					ioReceive(transport.wait(io_retry_wait_ms));
+				}else{
+					std::this_thread::sleep_for(std::chrono::milliseconds((int)io_retry_wait_ms));
+				}
+			}else if(ready && connection_state == Connected){ //a finished connect is completed by the next ioPrepare()
+				ioReceive(1);
+			}
+		}
+	}
+
+	/*!
+	 * @brief Wake up the thread which drives the I/O of this client (io_thread or the I/O thread of HotmockClientManager)
+	 */
+	void HotmockClient::ioWakeup(){
+		HotmockPoller *poller = transport.getPoller();
+		if(poller != NULL){
+			poller->wakeup();
+		}
+	}
+
+	/*!
+	 * @brief Get the time by which the I/O thread must call ioPrepare() again even if no event occurs
+	 * @param now_ns current time [ns] (monotonicNanoseconds())
+	 * @return deadline [ns]
+	 */
+	unsigned long long HotmockClient::ioDeadline(unsigned long long now_ns) const{
+		unsigned long long deadline = now_ns + (unsigned long long)io_max_wait_ms * 1000000ULL;
+
+		if(send_len > 0){ //socket did not accept all data
+			deadline = std::min(deadline, now_ns + (unsigned long long)io_retry_wait_ms * 1000000ULL);
+		}
+		if(connection_state == Disconnected && !server_ip.empty()){
+			deadline = std::min(deadline, reconnect_time_ns);
+		}else if(connection_state == Connected && request_timeout_ns > 0){
+			deadline = std::min(deadline, timer_wheel.nextDeadline());
+		}
+		return deadline;
+	}
+
+	/*!
+	 * @brief First half of one I/O loop iteration: send queued commands and retransmissions, advance connect
+	 * @param timeout_ms max time to wait for a connect in progress [ms]
+	 * @return true if connected (data can be waited for)
+	 */
+	bool HotmockClient::ioPrepare(int timeout_ms){
+		HotmockCommand command;
+
+		//send commands from the execution context with one send()
+		while(command_queue.pop(command)){
+			writeCommand(command.cmd, command.type, command.connectorID, command.param);
+		}
+		if(!updateConnection(timeout_ms)){
+			return false;
+		}
+		checkTimeouts(); //retransmissions are sent together
+		if(send_len > 0){
+			flushSendBuffer();
+			io_send_commands += send_count.commands;
+			io_send_bytes += send_count.bytes;
+			io_send_calls += send_count.send_calls;
+			std::memset(&send_count, 0, sizeof(send_count));
+		}
+		return connection_state == Connected;
+	}
+
+	/*!
+	 * @brief Second half of one I/O loop iteration: receive and parse data if the socket is readable
+	 * @param ready result of waiting for the socket (1: readable, 0: no data, -1: error)
+	 */
+	void HotmockClient::ioReceive(int ready){
+		HotmockRecvStatus status;
+
+		if(ready > 0){
+			receiveData(status);
+			io_bytes += status.bytes;
+			io_frames += status.frames;
+			io_recv_calls += status.recv_calls;
+		}else if(ready < 0){
+			handleDisconnect();
+		}
+	}
+
+	/*!
+	 * @brief Start non-blocking connect to the server (reconnect is scheduled if it fails immediately)
+	 */
+	void HotmockClient::startConnect(){
+		int res = transport.open(server_ip.c_str(), server_port);
+		if(res == 0){
+			onConnected();
+		}else if(res == 1){
+			connection_state = Connecting;
 		}else{
-			int nError = WSAGetLastError();
-			if(nError!=WSAEWOULDBLOCK && nError!=0){
-				std::cerr << "Error in receive message" << std::endl;
-			}else{
-				res = 0;
+			transport.close();
+			scheduleReconnect();
+		}
+	}
+
+	/*!
+	 * @brief Advance the connection state machine: start the next connect attempt when its time has come,
+	 * and check if the connect in progress has finished
+	 * @param timeout_ms max time to wait for the connect in progress [ms]
+	 * @return true if connected
+	 */
+	bool HotmockClient::updateConnection(int timeout_ms){
+		int res;
+
+		switch(connection_state){
+			case Disconnected:
+				if(server_ip.empty() || monotonicNanoseconds() < reconnect_time_ns){
+					break;
+				}
+				startConnect();
+				break;
+			case Connecting:
+				res = transport.finishConnect(timeout_ms);
+				if(res > 0){
+					onConnected();
+				}else if(res < 0){
+					transport.close();
+					scheduleReconnect();
+				}
+				break;
+			default:
+				break;
+		}
+		return connection_state == Connected;
+	}
+
+	/*!
+	 * @brief Called when the connection is established: reset backoff and send pending requests again
+	 */
+	void HotmockClient::onConnected(){
+		connection_state = Connected;
+		reconnect_delay_ns = reconnect_min_delay_ns;
+		if(ever_connected){
+			reconnect_count++;
+		}
+		ever_connected = true;
+		sendPendingCommands();
+		rearmRequests();
+	}
+
+	/*!
+	 * @brief Send the latest OUTPUT/INIT of each connector issued while not connected
+	 */
+	void HotmockClient::sendPendingCommands(){
+		for(int c=0;c<command_num;c++){
+			for(int t=0;t<connector_type_num;t++){
+				HotmockCommandPlan &plan = command_plan[c][t];
+				for(unsigned int i=0;i<plan.pending.size();i++){
+					if(plan.pending[i] == HotmockCommandPlan::no_pending){
+						continue;
+					}
+					if(appendCommand(plan.templates[i], plan.pending[i]) < 0){
+						return;
+					}
+					plan.pending[i] = HotmockCommandPlan::no_pending;
+				}
 			}
 		}
-		
-		return res;
 	}
 
-}
+	/*!
+	 * @brief Close the lost connection, discard partial messages and schedule reconnect
+	 */
+	void HotmockClient::handleDisconnect(){
+		HMLOG_WARN("Error in HotmockClient: connection lost, reconnecting to {}:{}", server_ip, server_port);
+		transport.close();
+
+		//a command or frame cut by the disconnection cannot be completed on the next connection
+		send_len = 0;
+		frame_len = 0;
+		frame_overflow = false;
+
+		connection_lost = true;
+		scheduleReconnect();
+	}
+
+	/*!
+	 * @brief Schedule the next connect attempt with exponential backoff and jitter
+	 * (delay is chosen from [backoff/2, backoff) so that clients do not reconnect at the same time)
+	 */
+	void HotmockClient::scheduleReconnect(){
+		//xorshift32
+		jitter_seed ^= jitter_seed << 13;
+		jitter_seed ^= jitter_seed >> 17;
+		jitter_seed ^= jitter_seed << 5;
+
+		unsigned long long half = reconnect_delay_ns / 2;
+		reconnect_time_ns = monotonicNanoseconds() + half + (half * (jitter_seed % 1024)) / 1024;
+
+		reconnect_delay_ns *= 2;
+		if(reconnect_delay_ns > reconnect_max_delay_ns){
+			reconnect_delay_ns = reconnect_max_delay_ns;
+		}
+		connection_state = Disconnected;
+	}
+
+	/*!
+	 * @brief Send the requests outstanding at the disconnection again with new deadlines
+	 * (their responses were lost with the connection)
+	 */
+	void HotmockClient::rearmRequests(){
+		unsigned long long now = monotonicNanoseconds();
+
+		for(int t=0;t<connector_type_num;t++){
+			const HotmockCommandPlan &plan = command_plan[REQUEST][t];
+			for(unsigned int i=0;i<in_flight_num[t];i++){
+				HotmockInFlight &requests = in_flight[t][i];
+				for(unsigned int seq=requests.answered;seq!=requests.sent;seq++){
+					unsigned int slot = seq % HotmockInFlight::max_window;
+					if(appendCommand(plan.templates[i], requests.param[slot]) < 0){
+						return;
+					}
+					requests.deadline[slot] = now + request_timeout_ns;
+				}
+				armRequestTimer(requests);
+			}
+		}
+	}
+
+	/*!
+	 * @brief Receive all data queued in the socket and parse it.
+	 * The socket is drained into the receive buffer until recv() would block (or one buffer size has been read),
+	 * and each chunk is handed to the parser right after its recv() so that the frames completed by the chunk
+	 * are stamped with the time the chunk arrived. A frame cut at the end of a chunk is carried over in frame,
+	 * so the buffer is reused from its start by every recv().
+	 * @param status statistics of this call
+	 * @return received message size if no error, negative value if error
+	 */
+	int HotmockClient::receiveData(HotmockRecvStatus &status){
+		int res = 0;
+
+		std::memset(&status, 0, sizeof(status));
+		if(recv_buffer.empty()){
+			return 0;
+		}
+
+		for(;;){
+			//limit of one call: the rest stays in the socket, which remains readable (poll() and epoll are
+			//level-triggered), so it is read by the next call and a busy link cannot hold the caller here
+			if(status.bytes >= recv_buffer.size()){
+				status.buffer_full = true;
+				break;
+			}
+
+			res = transport.recv(&recv_buffer[0],(int)recv_buffer.size());
+			status.recv_calls++;
+			if(res <= 0){ //would block or error
+				break;
+			}
+			recv_time_ns = monotonicNanoseconds(); //stamped on the frames completed by this chunk
+			status.bytes += res;
+
+			HMLOG_DEBUG("received: {}", LogBytes(&recv_buffer[0], res));
+			status.frames += parseMessage(&recv_buffer[0], res);
+		}
+
+		if(res < 0){
+			handleDisconnect();
+			return res;
+		}
+		return (int)status.bytes;
+	}
+
+}
\ No newline at end of file
@@ -0,0 +1,273 @@
+// -*- C++ -*-
+/*!
+ * @file  hotmockclientmanager.cpp
+ * @brief manager of the hotmock clients of several boards (one event loop for all connections)
+ * @date $Date$
+ *
+ */
+
+#include "hotmockclientmanager.h"
+
+#include <chrono>
+#include <algorithm>
+
+namespace hotmock{
+
+	/*!
+	 * @brief Constuctor
+	 */
+	HotmockClientManager::HotmockClientManager(){
+		recv_buffer_size = HotmockClient::default_recv_buffer_size;
+		io_thread_mode = false;
+		request_window = 1;
+		request_timeout_ms = 500;
+		request_max_retry = 3;
+		io_running = false;
+		event_pending = false;
+	}
+
+	/*!
+	 * @brief Destructor
+	 */
+	HotmockClientManager::~HotmockClientManager(){
+		finalize();
+	}
+
+	/*!
+	 * @brief Set size of the receive buffer of each board. Takes effect at next addBoard()
+	 * @param size buffer size in bytes
+	 */
+	void HotmockClientManager::setRecvBufferSize(unsigned int size){
+		recv_buffer_size = size;
+	}
+
+	/*!
+	 * @brief Select whether one shared I/O thread owns the sockets of all boards. Takes effect at next addBoard()
+	 * @param enable true: shared I/O thread (started by start()), false: recvDataFromHotmock() in the caller's thread
+	 */
+	void HotmockClientManager::setIOThreadMode(bool enable){
+		if(!io_thread.joinable()){
+			io_thread_mode = enable;
+		}
+	}
+
+	/*!
+	 * @brief Set max # of outstanding requests per connector. Takes effect at next addBoard()
+	 * @param window 1 to HotmockInFlight::max_window
+	 */
+	void HotmockClientManager::setRequestWindow(unsigned int window){
+		request_window = window;
+	}
+
+	/*!
+	 * @brief Set timeout of REQUEST. Takes effect at next addBoard()
+	 * @param timeout_ms timeout [ms] (0: no timeout)
+	 * @param max_retry # of retransmissions
+	 */
+	void HotmockClientManager::setRequestTimeout(unsigned int timeout_ms, unsigned int max_retry){
+		request_timeout_ms = timeout_ms;
+		request_max_retry = max_retry;
+	}
+
+	/*!
+	 * @brief Add a board and start connecting to its server (must be called before start())
+	 * @param hmtype Hotmock type
+	 * @param ip IP of the server
+	 * @param port port number of the server
+	 * @return board index (0, 1, ...), -1 if error
+	 */
+	int HotmockClientManager::addBoard(HotmockBoardType hmtype, const char *ip, unsigned short port){
+		if(io_thread.joinable()){
+			HMLOG_ERROR("Error in HotmockClientManager::addBoard(): already started");
+			return -1;
+		}
+		if(clients.size() >= max_boards || clients.size() >= HotmockPoller::max_transports){
+			HMLOG_ERROR("Error in HotmockClientManager::addBoard(): too many boards");
+			return -1;
+		}
+
+		if(poller.open() != 0){
+			return -1;
+		}
+
+		std::unique_ptr<HotmockClient> client(new HotmockClient());
+		client->setRecvBufferSize(recv_buffer_size);
+		client->setIOThreadMode(io_thread_mode);
+		client->io_external = true; //driven by ioThreadMain() of the manager
+		client->transport.attach(&poller, (unsigned int)clients.size()); //socket is added to the shared epoll set while open
+		client->setRequestWindow(request_window);
+		client->setRequestTimeout(request_timeout_ms, request_max_retry);
+		if(client->initialize(hmtype, ip, port) != 0){
+			return -1;
+		}
+
+		clients.push_back(std::move(client));
+		return (int)clients.size() - 1;
+	}
+
+	/*!
+	 * @brief Start the shared I/O thread (nothing is done in the caller's thread mode)
+	 * @return 0 if no error
+	 */
+	int HotmockClientManager::start(){
+		if(io_thread_mode && !io_thread.joinable() && !clients.empty()){
+			io_running = true;
+			io_thread = std::thread(&HotmockClientManager::ioThreadMain, this);
+		}
+		return 0;
+	}
+
+	/*!
+	 * @brief Stop the shared I/O thread, close all connections and remove all boards
+	 */
+	void HotmockClientManager::finalize(){
+		if(io_thread.joinable()){
+			io_running = false;
+			poller.wakeup();
+			io_thread.join();
+		}
+		for(unsigned int i=0;i<clients.size();i++){
+			clients[i]->finalize();
+		}
+		clients.clear();
+		poller.close();
+	}
+
+	/*!
+	 * @brief Check if all boards are connected
+	 * @return true if every board is connected
+	 */
+	bool HotmockClientManager::isConnected() const{
+		for(unsigned int i=0;i<clients.size();i++){
+			if(!clients[i]->isConnected()){
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/*!
+	 * @brief Start batching commands of all boards (see HotmockClient::beginBatch())
+	 */
+	void HotmockClientManager::beginBatch(){
+		for(unsigned int i=0;i<clients.size();i++){
+			clients[i]->beginBatch();
+		}
+	}
+
+	/*!
+	 * @brief Send the batched commands of all boards (see HotmockClient::flush())
+	 * @return total # of bytes sent (0 in I/O thread mode), -1 if a board lost its connection
+	 */
+	int HotmockClientManager::flush(){
+		int total = 0;
+		bool lost = false;
+
+		for(unsigned int i=0;i<clients.size();i++){
+			int res = clients[i]->flush();
+			if(res < 0){
+				lost = true;
+			}else{
+				total += res;
+			}
+		}
+		return lost ? -1 : total;
+	}
+
+	/*!
+	 * @brief Receive data of all boards (see HotmockClient::recvDataFromHotmock()).
+	 * In the caller's thread mode each board is checked without waiting
+	 * @return total # of bytes received, -1 if a board lost its connection
+	 */
+	int HotmockClientManager::recvDataFromHotmock(){
+		int total = 0;
+		bool lost = false;
+
+		for(unsigned int i=0;i<clients.size();i++){
+			int res = clients[i]->recvDataFromHotmock();
+			if(res < 0){
+				lost = true;
+			}else{
+				total += res;
+			}
+		}
+		return lost ? -1 : total;
+	}
+
+	/*!
+	 * @brief Wait until the shared I/O thread receives data of any board or notifyEvent() is called.
+	 * Events which occurred since the last call are not lost (the call returns immediately)
+	 * @param timeout_ms max time to wait [ms]
+	 * @return true if an event occurred, false if timed out
+	 */
+	bool HotmockClientManager::waitEvent(int timeout_ms){
+		if(event_pending.exchange(false)){
+			return true;
+		}
+
+		std::unique_lock<std::mutex> lock(event_mutex);
+		event_cond.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this]{return event_pending.load();});
+		return event_pending.exchange(false);
+	}
+
+	/*!
+	 * @brief Wake up the thread waiting in waitEvent() (ex. a command to be sent was given)
+	 */
+	void HotmockClientManager::notifyEvent(){
+		if(event_pending.exchange(true)){ //already signalled and not consumed yet
+			return;
+		}
+		std::lock_guard<std::mutex> lock(event_mutex);
+		event_cond.notify_one();
+	}
+
+	/*!
+	 * @brief Main loop of the shared I/O thread: send queued commands of every board,
+	 * sleep on all sockets at once (one epoll_wait()) until data arrives, a command is queued (poller.wakeup())
+	 * or the nearest deadline of the boards (reconnect, request timeout), and parse the data.
+	 * If the poller is not available, each connected socket is polled instead (as HotmockClient::ioThreadMain() does)
+	 */
+	void HotmockClientManager::ioThreadMain(){
+		unsigned int num = (unsigned int)clients.size();
+		bool connected[HotmockPoller::max_transports];
+
+		while(io_running){
+			for(unsigned int i=0;i<num;i++){
+				connected[i] = clients[i]->ioPrepare(0);
+			}
+
+			unsigned long long now = monotonicNanoseconds();
+			unsigned long long deadline = ~0ULL;
+			for(unsigned int i=0;i<num;i++){
+				deadline = std::min(deadline, clients[i]->ioDeadline(now));
+			}
+			if(poller.wait(ready, num, timeoutMilliseconds(deadline, now)) < 0){ //poller is not available: poll the sockets
+				bool received = false;
+				for(unsigned int i=0;i<num;i++){
+					if(connected[i]){
+						int res = clients[i]->transport.wait(0);
+						clients[i]->ioReceive(res); //res < 0: connection lost (reconnect is scheduled)
+						received = received || (res > 0);
+					}
+				}
+				if(received){
+					notifyEvent();
+				}else{
+					std::this_thread::sleep_for(std::chrono::milliseconds((int)HotmockClient::io_retry_wait_ms));
+				}
+				continue;
+			}
+			bool received = false;
+			for(unsigned int i=0;i<num;i++){
+				if(ready[i] && clients[i]->isConnected()){ //a finished connect is completed by the next ioPrepare()
+					clients[i]->ioReceive(1);
+					received = true;
+				}
+			}
+			if(received){
+				notifyEvent();
+			}
+		}
+	}
+
+}
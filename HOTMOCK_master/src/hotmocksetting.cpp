@@ -1,129 +1,337 @@
-#include <windows.h>
 #include <fstream>
-#include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
-
-#import "msxml6.dll" raw_interfaces_only
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <cstdint>
 
 #include "hotmocksetting.h"
+#include "hotmock/hotmocklog.h"
 
 namespace hotmock{
 
-	HotmockSetting::HotmockSetting(){
+	/*!
+	 * @brief ̑Ő󔒕菜
+	 */
+	static std::string trimSpace(const std::string &str){
+		const char *space=" \t\r\n";
+		std::size_t begin=str.find_first_not_of(space);
+		if(begin==std::string::npos){
+			return "";
+		}
+		std::size_t end=str.find_last_not_of(space);
+		return str.substr(begin,end-begin+1);
 	}
 
-	HotmockSetting::~HotmockSetting(){
+	/*!
+	 * @brief Q(&amp;,&#x41;)WJtextɒǉ
+	 */
+	static void appendDecodedText(std::string &text, const char *p, const char *end){
+		while(p<end){
+			if(*p!='&'){
+				text+=*p++;
+				continue;
+			}
+			const char *semi=(const char *)std::memchr(p,';',end-p);
+			if(semi==NULL){ //QƂł͂Ȃ
+				text+=*p++;
+				continue;
+			}
+			std::string ref(p+1,semi);
+			if(ref=="lt") text+='<';
+			else if(ref=="gt") text+='>';
+			else if(ref=="amp") text+='&';
+			else if(ref=="quot") text+='"';
+			else if(ref=="apos") text+='\'';
+			else if(ref.size()>1&&ref[0]=='#'){ //lQƂUTF-8Œǉ
+				unsigned long c=(ref[1]=='x'||ref[1]=='X') ? std::strtoul(ref.c_str()+2,NULL,16) : std::strtoul(ref.c_str()+1,NULL,10);
+				if(c<0x80){
+					text+=(char)c;
+				}
+				else if(c<0x800){
+					text+=(char)(0xC0|(c>>6));
+					text+=(char)(0x80|(c&0x3F));
+				}
+				else if(c<0x10000){
+					text+=(char)(0xE0|(c>>12));
+					text+=(char)(0x80|((c>>6)&0x3F));
+					text+=(char)(0x80|(c&0x3F));
+				}
+				else{
+					text+=(char)(0xF0|(c>>18));
+					text+=(char)(0x80|((c>>12)&0x3F));
+					text+=(char)(0x80|((c>>6)&0x3F));
+					text+=(char)(0x80|(c&0x3F));
+				}
+			}
+			else{ //m̎̎QƂ͂̂܂܎c
+				text.append(p,semi+1);
+			}
+			p=semi+1;
+		}
 	}
 
-	int HotmockSetting::initialize(std::string hmst){
-		hmstFilename=hmst;
-		std::ifstream infile(hmstFilename,std::ios::in); //hmstt@CJ
+	/*!
+	 * @brief XML擪1񂾂Adevice_namevfidvf̕𕶏̏Ɏo
+	 * (vf̓q͍̌ؓsȂ)
+	 * @return 0 if no error, -1 if the document is broken
+	 */
+	static int scanConfig(const char *p, const char *end, std::vector<std::string> &deviceNameList, std::vector<std::string> &idList){
+		std::string captureName; //oĂvf̖O(""ȂΗvf̊O)
+		std::string text;
 
-		if(!infile){
-			std::cerr << "hmst file can not open : " << hmstFilename << std::endl;
+		while(p<end){
+			const char *lt=(const char *)std::memchr(p,'<',end-p);
+			if(lt==NULL){
+				lt=end;
+			}
+			if(!captureName.empty()){
+				appendDecodedText(text,p,lt);
+			}
+			if(lt==end){
+				break;
+			}
+			p=lt;
+
+			std::size_t rest=end-p;
+			if(rest>=4&&std::strncmp(p,"<!--",4)==0){ //Rg
+				const char *close=std::search(p+4,end,"-->","-->"+3);
+				if(close==end) return -1;
+				p=close+3;
+			}
+			else if(rest>=9&&std::strncmp(p,"<![CDATA[",9)==0){ //CDATAZNV͕ƂĈ
+				const char *close=std::search(p+9,end,"]]>","]]>"+3);
+				if(close==end) return -1;
+				if(!captureName.empty()){
+					text.append(p+9,close);
+				}
+				p=close+3;
+			}
+			else if(rest>=2&&(p[1]=='?'||p[1]=='!')){ //XML錾,DOCTYPE
+				const char *close=(const char *)std::memchr(p,'>',end-p);
+				if(close==NULL) return -1;
+				p=close+1;
+			}
+			else{ //Jn^O,I^O
+				bool endTag=(rest>=2&&p[1]=='/');
+				const char *name=p+(endTag ? 2 : 1);
+				const char *nameEnd=name;
+				while(nameEnd<end&&std::strchr(" \t\r\n/>",*nameEnd)==NULL){
+					nameEnd++;
+				}
+
+				//l̒'>'͖ă^ȌIT
+				const char *close=nameEnd;
+				char quote=0;
+				while(close<end&&(quote!=0||*close!='>')){
+					if(quote==0&&(*close=='"'||*close=='\'')) quote=*close;
+					else if(quote==*close) quote=0;
+					close++;
+				}
+				if(close==end) return -1;
+				bool emptyTag=(!endTag&&close[-1]=='/');
+				std::string tagName(name,nameEnd);
+
+				if(endTag){
+					if(!captureName.empty()&&tagName==captureName){
+						(captureName=="device_name" ? deviceNameList : idList).push_back(trimSpace(text));
+						captureName.clear();
+					}
+				}
+				else if(captureName.empty()&&(tagName=="device_name"||tagName=="id")){
+					if(emptyTag){
+						(tagName=="device_name" ? deviceNameList : idList).push_back("");
+					}
+					else{
+						captureName=tagName;
+						text.clear();
+					}
+				}
+				p=close+1;
+			}
+		}
+
+		if(!captureName.empty()){ //I^O
 			return -1;
 		}
+		return 0;
+	}
 
-		do{
-			std::string str;
-			std::getline(infile,str); //Jt@Csǂݍ
+	static const char plan_magic[4]={'H','M','P','L'}; //.plant@C̐擪
+	static const uint32_t plan_version=1;
 
-			std::string bom(str,0,3); //BOMۑ
-			str.erase(0,3); //BOM폜
+	//vZX̃|[g\̃LbV(L[hmstt@C̓ẽnbVl)
+	static std::map<unsigned long long, std::string> plan_cache;
+	static std::mutex plan_cache_mutex;
 
-			while(str.find(".xml")!=std::string::npos){ //".xml"Ɉv镶񂪂ȂΌp
-        		configFilenameList.push_back(str);      //xmlt@C̖Oꗗ(FileList)쐬
-				std::getline(infile,str);
-			}
+	/*!
+	 * @brief FNV-1a(64bit)ɂnbVl߂
+	 */
+	static unsigned long long fnv1a64(const char *data, std::size_t size){
+		unsigned long long hash=14695981039346656037ULL;
+		for(std::size_t i=0;i<size;i++){
+			hash^=(unsigned char)data[i];
+			hash*=1099511628211ULL;
+		}
+		return hash;
+	}
 
-			int list_num=configFilenameList.size();
+	/*!
+	 * @brief 4byteE܂ł0Ŗ߂
+	 */
+	static void appendPadding(std::string &plan){
+		while(plan.size()%4!=0){
+			plan+='\0';
+		}
+	}
 
-			for(int i=0;i<list_num;i++){
-				if(str.find("<?xml")!=std::string::npos){ //XML錾FileListɂ閼ȌɃt@C쐬
-					std::ofstream outfile(configFilenameList[i],std::ios::out);
+	template <class T>
+	static void appendValue(std::string &plan, T value){
+		plan.append((const char *)&value,sizeof(value));
+	}
 
-					if (!outfile) {
-						std::cerr << "out file can not open" << std::endl;
-						return -1;
-					}
+	template <class T>
+	static bool readValue(const std::string &plan, std::size_t &pos, T &value){
+		if(pos+sizeof(value)>plan.size()){
+			return false;
+		}
+		std::memcpy(&value,plan.data()+pos,sizeof(value));
+		pos+=sizeof(value);
+		return true;
+	}
 
-					outfile << bom; //R[hUFT-8ɂ
-					outfile << str; //XML錾t@Cɏ
-					outfile << std::endl;
-					std::getline(infile,str); //̍sǂݍ
+	HotmockSetting::HotmockSetting(){
+		contentHash=0;
+		fromCache=false;
+		planCache=PlanCacheMemory;
+	}
 
-					while(str.find("<?xml")==std::string::npos&&str.length()!=0){ //XML錾̎O܂Ńt@C
-						outfile << str;
-						outfile << std::endl;
-						std::getline(infile,str);
-					}		
-					outfile.close();
-				}
-			}
+	HotmockSetting::~HotmockSetting(){
+	}
 
-		}while(!infile.eof());
+	/*!
+	 * @brief hmstt@Cɓǂݍ݁A擪xmlt@C̈ꗗƊeXML̈ʒu擾
+	 * @return 0 if no error
+	 */
+	int HotmockSetting::initialize(std::string hmst){
+		hmstFilename=hmst;
+		configFilenameList.clear();
+		configBeginList.clear();
+		configEndList.clear();
+
+		std::ifstream infile(hmstFilename.c_str(),std::ios::in|std::ios::binary); //hmstt@CJ
+		if(!infile){
+			HMLOG_ERROR("hmst file can not open : {}", hmstFilename);
+			return -1;
+		}
+		std::ostringstream buffer;
+		buffer << infile.rdbuf(); //t@CŜxɓǂݍ
+		hmstData=buffer.str();
 		infile.close();
+		contentHash=fnv1a64(hmstData.data(),hmstData.size());
+
+		std::size_t pos=0;
+		if(hmstData.compare(0,3,"\xEF\xBB\xBF")==0){ //BOMǂݔ΂
+			pos=3;
+		}
+
+		//".xml"ɈvsԁAxmlt@C̖Oꗗ(FileList)쐬
+		while(pos<hmstData.size()){
+			std::size_t eol=hmstData.find('\n',pos);
+			if(eol==std::string::npos){
+				eol=hmstData.size();
+			}
+			std::string line=trimSpace(hmstData.substr(pos,eol-pos)); //s(CR LF)
+			if(line.find(".xml")==std::string::npos||line.find("<?xml")!=std::string::npos){
+				break;
+			}
+			configFilenameList.push_back(line);
+			pos=eol+1;
+		}
+
+		//XML錾玟XML錾̎O܂łFileListɂ閼ȌXMLƂ
+		std::size_t begin=hmstData.find("<?xml",pos);
+		for(unsigned int i=0;i<configFilenameList.size();i++){
+			if(begin==std::string::npos){
+				HMLOG_ERROR("config of {} is not found in : {}", configFilenameList[i], hmstFilename);
+				return -1;
+			}
+			std::size_t next=hmstData.find("<?xml",begin+5);
+			configBeginList.push_back(begin);
+			configEndList.push_back(next==std::string::npos ? hmstData.size() : next);
+			begin=next;
+		}
 
 		return 0;
 	}
 
+	/*!
+	 * @brief eXMLdevice_name{[ȟ^ƎgpĂID̈ꗗ(useIDFlagList)쐬
+	 * @return 0 if no error
+	 */
 	int HotmockSetting::setPort(){
-		CoInitialize(NULL); //COMCȕ
+		useIDFlagList.clear();
+		fromCache=false;
 
-		for(int i=0;i<configFilenameList.size();i++){ //configFilenameListɂt@C̏ɐݒ
-			HRESULT hr = Doc.CreateInstance(CLSID_DOMDocument);
-			if(FAILED(hr)){
-				 std::cerr << "can not createInstance" << std::endl;
-				 return -1;
+		//hmstt@C̓eȂ΃LbV|[g\gp
+		if(planCache==PlanCacheMemory||planCache==PlanCacheFile){
+			std::string plan;
+			{
+				std::lock_guard<std::mutex> lock(plan_cache_mutex);
+				std::map<unsigned long long, std::string>::const_iterator it=plan_cache.find(contentHash);
+				if(it!=plan_cache.end()){
+					plan=it->second;
+				}
 			}
-
-			Doc->put_async(VARIANT_FALSE); //[h҂
-
-			VARIANT_BOOL varResult; 
-			hr = Doc->load(_variant_t(configFilenameList[i].c_str()), &varResult); //[h
-			if((hr!=S_OK)||!varResult){
-				std::cerr << "config file can not load" << std::endl;
-				return -1;
+			if(plan.empty()&&planCache==PlanCacheFile){
+				std::ifstream planfile((hmstFilename+".plan").c_str(),std::ios::in|std::ios::binary);
+				if(planfile){
+					std::ostringstream buffer;
+					buffer << planfile.rdbuf();
+					plan=buffer.str();
+				}
 			}
+			if(!plan.empty()&&decodePlan(plan)){
+				std::lock_guard<std::mutex> lock(plan_cache_mutex);
+				plan_cache[contentHash]=plan;
+				fromCache=true;
+				return 0;
+			}
+		}
 
-			MSXML2::IXMLDOMNodePtr node_deviceName=NULL;
-			MSXML2::IXMLDOMNodePtr node_ID=NULL;
-			MSXML2::IXMLDOMNodePtr node=NULL;
-			MSXML2::IXMLDOMNodeListPtr nodeList_deviceName=NULL;
-			MSXML2::IXMLDOMNodeListPtr nodeList_ID=NULL;
-			_variant_t var1,var2,var3;
-			long node_num = 0;
-			std::string str;
+		for(unsigned int i=0;i<configFilenameList.size();i++){ //configFilenameListɂt@C̏ɐݒ
+			std::vector<std::string> deviceNameList;
+			std::vector<std::string> idList;
 			std::vector<unsigned short> useIDflag;
 			int BDflag=0;
 
-			Doc->getElementsByTagName(L"device_name",&nodeList_deviceName);
-			nodeList_deviceName->get_length( &node_num );
-			Doc->getElementsByTagName(L"id",&nodeList_ID);
+			const char *data=hmstData.data();
+			if(scanConfig(data+configBeginList[i],data+configEndList[i],deviceNameList,idList)!=0||idList.size()<deviceNameList.size()){
+				HMLOG_ERROR("config file can not load : {}", configFilenameList[i]);
+				return -1;
+			}
 
 			if(configFilenameList[i]=="BD_Config.xml") BDflag=1;
 
-			for(int i=0;i<node_num;i++){
-				nodeList_deviceName->get_item( i, &node_deviceName);
-				node_deviceName->get_text(&var1.bstrVal);
-				nodeList_ID->get_item( i, &node_ID);
-				node_ID->get_text(&var2.bstrVal);
-
+			for(unsigned int j=0;j<deviceNameList.size();j++){
 				if(BDflag==1){ //{[h^̎w
-					if(_bstr_t(var1.bstrVal)==_bstr_t("DigitalBoard")){
+					if(deviceNameList[j]=="DigitalBoard"){
 						boardType="digital";
 					}
-					else if(_bstr_t(var1.bstrVal)==_bstr_t("AnalogBoard")){
+					else if(deviceNameList[j]=="AnalogBoard"){
 						boardType="analog";
 					}
 					else{ //error
-						std::cerr<<"??? board type ???"<<std::endl;
+						HMLOG_ERROR("??? board type ??? : {}", hmstFilename);
 						return -1;
 					}
 				}
 
-				if(_bstr_t(var1.bstrVal)!=_bstr_t("")){
+				if(deviceNameList[j]!=""){
 					useIDflag.push_back(1);
 				}
 				else{
@@ -132,18 +340,113 @@ namespace hotmock{
 			}
 
 			useIDFlagList.push_back(useIDflag);
+		}
 
+		//͂|[g\LbV
+		if(planCache!=PlanCacheOff){
+			std::string plan;
+			encodePlan(plan);
+			{
+				std::lock_guard<std::mutex> lock(plan_cache_mutex);
+				plan_cache[contentHash]=plan;
+			}
+			if(planCache==PlanCacheFile||planCache==PlanCacheRebuild){
+				std::ofstream planfile((hmstFilename+".plan").c_str(),std::ios::out|std::ios::binary|std::ios::trunc);
+				if(!planfile||!planfile.write(plan.data(),plan.size())){ //LbVȂĂݒ͎gpł
+					HMLOG_WARN("plan file can not write : {}.plan", hmstFilename);
+				}
+			}
 		}
 
-		Doc=NULL;
-		CoFreeUnusedLibraries(); //COMCủ
-		CoUninitialize();
 		return 0;
 	}
 
+	/*!
+	 * @brief |[g\̃LbV̎gݒ肷(setPort()L)
+	 */
+	void HotmockSetting::setPlanCache(HotmockPlanCache mode){
+		planCache=mode;
+	}
+
+	/*!
+	 * @brief |[g\oCi`(.plant@C̓e)ɂ
+	 *
+	 * `(el4byteEɔzuBǂݍ݂decodePlan()ŃRs[):
+	 *   char[4] "HMPL", uint32 version, uint64 contentHash,
+	 *   uint32 boardType(0:s,1:digital,2:analog), uint32 t@C,
+	 *   t@CƂ uint32 O̒, uint32 ID̐, O, uint16 gptO[ID̐]
+	 */
+	void HotmockSetting::encodePlan(std::string &plan) const{
+		plan.clear();
+		plan.append(plan_magic,sizeof(plan_magic));
+		appendValue(plan,plan_version);
+		appendValue(plan,(uint64_t)contentHash);
+		appendValue(plan,(uint32_t)(boardType=="digital" ? 1 : boardType=="analog" ? 2 : 0));
+		appendValue(plan,(uint32_t)configFilenameList.size());
+		for(unsigned int i=0;i<configFilenameList.size();i++){
+			appendValue(plan,(uint32_t)configFilenameList[i].size());
+			appendValue(plan,(uint32_t)useIDFlagList[i].size());
+			plan+=configFilenameList[i];
+			appendPadding(plan);
+			for(unsigned int j=0;j<useIDFlagList[i].size();j++){
+				appendValue(plan,(uint16_t)useIDFlagList[i][j]);
+			}
+			appendPadding(plan);
+		}
+	}
+
+	/*!
+	 * @brief oCi`̃|[g\ǂݍ
+	 * @return true if the plan is valid and made from the same hmst file
+	 */
+	bool HotmockSetting::decodePlan(const std::string &plan){
+		std::size_t pos=sizeof(plan_magic);
+		uint32_t version,type,listNum;
+		uint64_t hash;
+
+		if(plan.size()<pos||plan.compare(0,pos,plan_magic,sizeof(plan_magic))!=0){
+			return false;
+		}
+		if(!readValue(plan,pos,version)||version!=plan_version||!readValue(plan,pos,hash)||hash!=contentHash||
+		   !readValue(plan,pos,type)||!readValue(plan,pos,listNum)||listNum!=configFilenameList.size()){
+			return false;
+		}
+
+		std::vector<std::vector<unsigned short>> flagList;
+		for(uint32_t i=0;i<listNum;i++){
+			uint32_t nameLen,flagNum;
+			if(!readValue(plan,pos,nameLen)||!readValue(plan,pos,flagNum)||pos+nameLen>plan.size()){
+				return false;
+			}
+			if(plan.compare(pos,nameLen,configFilenameList[i])!=0){
+				return false;
+			}
+			pos=(pos+nameLen+3)/4*4;
+
+			std::vector<unsigned short> useIDflag;
+			for(uint32_t j=0;j<flagNum;j++){
+				uint16_t flag;
+				if(!readValue(plan,pos,flag)){
+					return false;
+				}
+				useIDflag.push_back(flag);
+			}
+			pos=(pos+3)/4*4;
+			flagList.push_back(useIDflag);
+		}
+
+		boardType=(type==1 ? "digital" : type==2 ? "analog" : "");
+		useIDFlagList.swap(flagList);
+		return true;
+	}
+
 	void HotmockSetting::finalize(){
 		configFilenameList.clear();
 		useIDFlagList.clear();
+		configBeginList.clear();
+		configEndList.clear();
+		hmstData.clear();
+		fromCache=false;
 		return;
 	}
 };
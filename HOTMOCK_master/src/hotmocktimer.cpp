@@ -0,0 +1,129 @@
+// -*- C++ -*-
+/*!
+ * @file  hotmocktimer.cpp
+ * @brief timing wheel used for request timeouts
+ * @date $Date$
+ *
+ */
+
+#include <cstddef>
+
+#include "hotmocktimer.h"
+
+namespace hotmock{
+
+	/*!
+	 * @brief Constuctor
+	 * @param tick length of one tick [ns]
+	 */
+	HotmockTimerWheel::HotmockTimerWheel(unsigned long long tick){
+		tick_ns = (tick > 0) ? tick : 1;
+		reset(monotonicNanoseconds());
+	}
+
+	/*!
+	 * @brief Discard all timers (the nodes must be reinitialized by the owner) and restart from current time
+	 * @param now_ns current time [ns] (monotonicNanoseconds())
+	 */
+	void HotmockTimerWheel::reset(unsigned long long now_ns){
+		for(unsigned int i=0;i<slot_num;i++){
+			slots[i].prev = &slots[i];
+			slots[i].next = &slots[i];
+		}
+		current_tick = now_ns / tick_ns;
+		count = 0;
+	}
+
+	/*!
+	 * @brief Schedule timer (rescheduled if already scheduled)
+	 * @param node Timer
+	 * @param deadline_ns time at which the timer expires [ns] (expires at next advance() if already past)
+	 */
+	void HotmockTimerWheel::schedule(HotmockTimerNode *node, unsigned long long deadline_ns){
+		cancel(node);
+
+		unsigned long long tick = deadline_ns / tick_ns;
+		if(tick <= current_tick){
+			tick = current_tick + 1;
+		}
+		node->expire_tick = tick;
+
+		HotmockTimerNode *head = &slots[tick % slot_num];
+		node->prev = head->prev;
+		node->next = head;
+		head->prev->next = node;
+		head->prev = node;
+		count++;
+	}
+
+	/*!
+	 * @brief Cancel timer (nothing is done if not scheduled)
+	 * @param node Timer
+	 */
+	void HotmockTimerWheel::cancel(HotmockTimerNode *node){
+		if(!isScheduled(node)){
+			return;
+		}
+		node->prev->next = node->next;
+		node->next->prev = node->prev;
+		node->prev = NULL;
+		node->next = NULL;
+		count--;
+	}
+
+	/*!
+	 * @brief Expire timers whose deadline has passed
+	 * @param now_ns current time [ns] (monotonicNanoseconds())
+	 * @param func Function called for each expired timer
+	 * @param context Argument passed to func
+	 */
+	void HotmockTimerWheel::advance(unsigned long long now_ns, ExpireFunc func, void *context){
+		unsigned long long now_tick = now_ns / tick_ns;
+		unsigned long long tick = current_tick + 1;
+
+		if(now_tick < tick){
+			return;
+		}
+		if(now_tick - tick >= slot_num){ //every slot is visited once
+			tick = now_tick - slot_num + 1;
+		}
+
+		for(;tick<=now_tick && count>0;tick++){
+			HotmockTimerNode *head = &slots[tick % slot_num];
+			HotmockTimerNode *node = head->next;
+
+			current_tick = tick; //timers rescheduled by func go to later ticks
+			while(node != head){
+				HotmockTimerNode *next = node->next;
+				if(node->expire_tick <= tick){ //not a timer of a later round
+					cancel(node);
+					func(node, context);
+				}
+				node = next;
+			}
+		}
+		current_tick = now_tick;
+	}
+
+	/*!
+	 * @brief Get the time by which advance() must be called to expire the earliest timer on time.
+	 * Visits at most slot_num slots; if the earliest timer is more than one round ahead,
+	 * the end of the round is returned (calling advance() earlier is harmless)
+	 * @return time [ns] (monotonicNanoseconds()), ~0ULL if no timer is scheduled
+	 */
+	unsigned long long HotmockTimerWheel::nextDeadline() const{
+		if(count == 0){
+			return ~0ULL;
+		}
+		for(unsigned long long tick=current_tick+1;tick<=current_tick+slot_num;tick++){
+			const HotmockTimerNode *head = &slots[tick % slot_num];
+			for(const HotmockTimerNode *node=head->next;node!=head;node=node->next){
+				if(node->expire_tick <= tick){
+					return tick * tick_ns;
+				}
+			}
+		}
+		return (current_tick + slot_num) * tick_ns;
+	}
+
+}
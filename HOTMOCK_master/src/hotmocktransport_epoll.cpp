@@ -0,0 +1,407 @@
+// -*- C++ -*-
+/*!
+ * @file  hotmocktransport_epoll.cpp
+ * @brief POSIX (non-blocking socket + epoll) backend of hotmock transport
+ * @date $Date$
+ *
+ */
+
+#include <cstring> //needed for memset and strerror
+#include <cerrno>
+#include <stdint.h>
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "hotmocktransport.h"
+#include "hotmock/hotmocklog.h"
+
+namespace hotmock{
+
+	/*!
+	 * @brief Constuctor
+	 */
+	HotmockTransport::HotmockTransport(){
+		sock = -1;
+		connected = false;
+		poller = NULL;
+		poller_index = 0;
+	}
+
+	/*!
+	 * @brief Destructor
+	 */
+	HotmockTransport::~HotmockTransport(){
+		close();
+		attach(NULL, 0);
+	}
+
+	/*!
+	 * @brief Start non-blocking connect to server and add the socket to the attached poller
+	 * @param ip IP of the server
+	 * @param port port number of the server
+	 * @return 0 if connected, 1 if connect in progress (call finishConnect()), -1 if error
+	 */
+	int HotmockTransport::open(const char *ip, unsigned short port){
+		struct sockaddr_in addr; //server address information
+		int res = 0;
+
+		close();
+
+		//create nonblocking socket
+		sock = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+		if(sock == -1){
+			HMLOG_ERROR("error in socket: {}", std::strerror(errno));
+			return -1;
+		}
+
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;    // host byte order
+		addr.sin_port = htons(port);  // short, network byte order  / port -> each program
+		if(inet_pton(AF_INET, ip, &addr.sin_addr) != 1){	// IP of the server
+			HMLOG_ERROR("error in address: {}", ip);
+			close();
+			return -1;
+		}
+
+		HMLOG_INFO("Connecting to the server:{} port:{}...", ip, port);
+
+		if(connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == -1){
+			if(errno != EINPROGRESS){
+				HMLOG_ERROR("error in connect: {}", std::strerror(errno));
+				close();
+				return -1;
+			}
+			res = 1;
+		}
+
+		if(res == 0){
+			connected = true;
+			HMLOG_INFO("connected");
+		}
+		//watch readiness of the socket (writable: connect finished, readable: data arrived)
+		if(poller != NULL){
+			poller->watch(this);
+		}
+		return res;
+	}
+
+	/*!
+	 * @brief Check if non-blocking connect started by open() has finished
+	 * @param timeout_ms max time to wait [ms] (0: check only)
+	 * @return 1 if connected, 0 if still in progress, -1 if connect failed
+	 */
+	int HotmockTransport::finishConnect(int timeout_ms){
+		struct pollfd fd;
+		int err = 0;
+		socklen_t len = sizeof(err);
+
+		if(connected){
+			return 1;
+		}
+		if(sock == -1){
+			return -1;
+		}
+
+		fd.fd = sock;
+		fd.events = POLLOUT;
+		fd.revents = 0;
+		int res = poll(&fd, 1, timeout_ms);
+		if(res == -1 && errno != EINTR){
+			HMLOG_ERROR("Error in HotmockTransport::finishConnect(): {}", std::strerror(errno));
+			return -1;
+		}
+		if(res <= 0){
+			return 0;
+		}
+
+		if(getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &len) == -1 || err != 0){
+			HMLOG_ERROR("error in connect: {}", std::strerror(err != 0 ? err : errno));
+			return -1;
+		}
+
+		//connected: watch incoming data from now on
+		connected = true;
+		if(poller != NULL){
+			poller->watch(this);
+		}
+		HMLOG_INFO("connected");
+		return 1;
+	}
+
+	/*!
+	 * @brief Close socket (removed from the attached poller)
+	 */
+	void HotmockTransport::close(){
+		if(sock != -1){
+			if(poller != NULL){
+				poller->unwatch(this);
+			}
+			::close(sock);
+			sock = -1;
+		}
+		connected = false;
+	}
+
+	/*!
+	 * @brief Check if socket is open
+	 * @return true if connected
+	 */
+	bool HotmockTransport::isOpen() const{
+		return sock != -1;
+	}
+
+	/*!
+	 * @brief Wait until data arrives (or the connection is closed)
+	 * @param timeout_ms timeout [ms] (0: check only, -1: infinite)
+	 * @return 1 if readable, 0 if timeout, -1 if error
+	 */
+	int HotmockTransport::wait(int timeout_ms){
+		struct pollfd fd;
+
+		if(sock == -1){
+			return -1;
+		}
+
+		fd.fd = sock;
+		fd.events = POLLIN;
+		fd.revents = 0;
+		int res = poll(&fd, 1, timeout_ms);
+		if(res == -1){
+			if(errno == EINTR){
+				return 0;
+			}
+			HMLOG_ERROR("Error in HotmockTransport::wait(): {}", std::strerror(errno));
+			return -1;
+		}
+		return (res > 0) ? 1 : 0;
+	}
+
+	/*!
+	 * @brief Send data
+	 * @param buf data to be sent
+	 * @param len size of data
+	 * @return number of bytes sent, -1 if error
+	 */
+	int HotmockTransport::send(const char *buf, int len){
+		ssize_t res;
+
+		do{
+			res = ::send(sock, buf, len, MSG_NOSIGNAL); //no SIGPIPE when the server has gone
+		}while(res == -1 && errno == EINTR);
+
+		if(res == -1){
+			if(errno == EAGAIN || errno == EWOULDBLOCK){
+				return 0;
+			}
+			return -1;
+		}
+		return (int)res;
+	}
+
+	/*!
+	 * @brief Receive data
+	 * @param buf buffer
+	 * @param len size of buffer
+	 * @return number of bytes received, 0 if no data (would block), -1 if error or connection closed
+	 */
+	int HotmockTransport::recv(char *buf, int len){
+		ssize_t res;
+
+		do{
+			res = ::recv(sock, buf, len, 0);
+		}while(res == -1 && errno == EINTR);
+
+		if(res > 0){
+			return (int)res;
+		}
+		if(res == 0){ //connection closed by the server
+			HMLOG_ERROR("Error in receive message: connection closed");
+			return -1;
+		}
+		if(errno == EAGAIN || errno == EWOULDBLOCK){
+			return 0;
+		}
+		HMLOG_ERROR("Error in receive message: {}", std::strerror(errno));
+		return -1;
+	}
+
+	/*!
+	 * @brief Constuctor
+	 */
+	HotmockPoller::HotmockPoller(){
+		epfd = -1;
+		wake_fd = -1;
+		wake_pending = false;
+		for(unsigned int i=0;i<max_transports;i++){
+			transports[i] = NULL;
+		}
+	}
+
+	/*!
+	 * @brief Destructor (the attached transports are detached)
+	 */
+	HotmockPoller::~HotmockPoller(){
+		for(unsigned int i=0;i<max_transports;i++){
+			if(transports[i] != NULL){
+				transports[i]->attach(NULL, 0);
+			}
+		}
+		close();
+	}
+
+	/*!
+	 * @brief Create the epoll set with the wakeup eventfd and add the sockets of the attached transports which are open
+	 * @return 0 if no error (or already open), -1 if error
+	 */
+	int HotmockPoller::open(){
+		struct epoll_event ev;
+
+		if(epfd != -1){
+			return 0;
+		}
+		epfd = epoll_create1(EPOLL_CLOEXEC);
+		if(epfd == -1){
+			HMLOG_ERROR("error in epoll_create1: {}", std::strerror(errno));
+			return -1;
+		}
+		wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		if(wake_fd == -1){
+			HMLOG_ERROR("error in eventfd: {}", std::strerror(errno));
+			close();
+			return -1;
+		}
+		std::memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.u32 = max_transports; //not an index of a transport
+		if(epoll_ctl(epfd, EPOLL_CTL_ADD, wake_fd, &ev) == -1){
+			HMLOG_ERROR("error in epoll_ctl: {}", std::strerror(errno));
+			close();
+			return -1;
+		}
+		wake_pending = false;
+		for(unsigned int i=0;i<max_transports;i++){
+			if(transports[i] != NULL && transports[i]->isOpen()){
+				watch(transports[i]);
+			}
+		}
+		return 0;
+	}
+
+	/*!
+	 * @brief Close the epoll set (the transports stay attached)
+	 */
+	void HotmockPoller::close(){
+		if(wake_fd != -1){
+			::close(wake_fd);
+			wake_fd = -1;
+		}
+		if(epfd != -1){
+			::close(epfd);
+			epfd = -1;
+		}
+	}
+
+	/*!
+	 * @brief Add the socket of a transport to the epoll set, or update the events watched for
+	 * (writable while connecting, readable once connected)
+	 * @param transport attached transport
+	 */
+	void HotmockPoller::watch(HotmockTransport *transport){
+		struct epoll_event ev;
+
+		if(epfd == -1 || transport->sock == -1){
+			return;
+		}
+		std::memset(&ev, 0, sizeof(ev));
+		ev.events = transport->connected ? (EPOLLIN | EPOLLRDHUP) : EPOLLOUT;
+		ev.data.u32 = transport->poller_index;
+		if(epoll_ctl(epfd, EPOLL_CTL_ADD, transport->sock, &ev) == -1){
+			if(errno != EEXIST || epoll_ctl(epfd, EPOLL_CTL_MOD, transport->sock, &ev) == -1){
+				HMLOG_ERROR("error in epoll_ctl: {}", std::strerror(errno));
+			}
+		}
+	}
+
+	/*!
+	 * @brief Remove the socket of a transport from the epoll set (before the socket is closed)
+	 * @param transport attached transport
+	 */
+	void HotmockPoller::unwatch(HotmockTransport *transport){
+		if(epfd == -1 || transport->sock == -1){
+			return;
+		}
+		epoll_ctl(epfd, EPOLL_CTL_DEL, transport->sock, NULL);
+	}
+
+	/*!
+	 * @brief Wait until any of the attached transports is ready or wakeup() is called (one epoll_wait() for all)
+	 * @param ready set to true for the index of each transport which is readable, closed by the server
+	 * or whose connect finished
+	 * @param num size of ready
+	 * @param timeout_ms timeout [ms] (0: check only, -1: infinite)
+	 * @return # of ready transports, 0 if timeout or woken up, -1 if error
+	 */
+	int HotmockPoller::wait(bool *ready, unsigned int num, int timeout_ms){
+		struct epoll_event events[max_transports+1];
+		int ready_num = 0;
+
+		for(unsigned int i=0;i<num;i++){
+			ready[i] = false;
+		}
+		if(epfd == -1){
+			return -1;
+		}
+
+		int res = epoll_wait(epfd, events, (int)max_transports+1, timeout_ms);
+		if(res == -1){
+			if(errno == EINTR){
+				return 0;
+			}
+			HMLOG_ERROR("Error in HotmockPoller::wait(): {}", std::strerror(errno));
+			return -1;
+		}
+		for(int k=0;k<res;k++){
+			unsigned int index = events[k].data.u32;
+			if(index == max_transports){
+				consumeWakeup();
+			}else if(index < num && !ready[index]){
+				ready[index] = true;
+				ready_num++;
+			}
+		}
+		return ready_num;
+	}
+
+	/*!
+	 * @brief End wait() of the thread waiting on this poller (or the next wait() if nobody is waiting).
+	 * Can be called from any thread; calls before wait() consumes the first one cost no system call
+	 */
+	void HotmockPoller::wakeup(){
+		if(wake_fd == -1 || wake_pending.exchange(true, std::memory_order_acq_rel)){
+			return;
+		}
+		uint64_t one = 1;
+		ssize_t res;
+		do{
+			res = ::write(wake_fd, &one, sizeof(one));
+		}while(res == -1 && errno == EINTR);
+	}
+
+	/*!
+	 * @brief Reset the eventfd signalled by wakeup() so that the next wakeup() writes it again
+	 */
+	void HotmockPoller::consumeWakeup(){
+		uint64_t count;
+		while(::read(wake_fd, &count, sizeof(count)) == -1 && errno == EINTR){
+		}
+		wake_pending.exchange(false, std::memory_order_acq_rel);
+	}
+
+}
@@ -0,0 +1,400 @@
+// -*- C++ -*-
+/*!
+ * @file  hotmocktransport_winsock.cpp
+ * @brief Winsock backend of hotmock transport
+ * @date $Date$
+ *
+ */
+
+#include <cstring> //needed for memset
+
+#include "hotmocktransport.h"
+#include "hotmock/hotmocklog.h"
+
+namespace hotmock{
+
+	/*!
+	 * @brief Constuctor
+	 */
+	HotmockTransport::HotmockTransport(){
+		sock = INVALID_SOCKET;
+		wsa_set = false;
+		connected = false;
+		poller = NULL;
+		poller_index = 0;
+	}
+
+	/*!
+	 * @brief Destructor
+	 */
+	HotmockTransport::~HotmockTransport(){
+		close();
+		attach(NULL, 0);
+	}
+
+	/*!
+	 * @brief Set nonblocking mode and start connect to server
+	 * @param ip IP of the server
+	 * @param port port number of the server
+	 * @return 0 if connected, 1 if connect in progress (call finishConnect()), otherwise error
+	 */
+	int HotmockTransport::open(const char *ip, unsigned short port){
+		struct sockaddr_in addr; //server address information
+
+		close();
+
+		// Initialize Winsock
+		int res = WSAStartup(MAKEWORD(2,2), &wsaData);
+		if(res != 0) {
+			WSACleanup();
+			HMLOG_ERROR("WSAStartup failed with error:{}", res);
+			return res;
+		}
+		wsa_set = true;
+
+		//create socket
+		sock = socket(AF_INET, SOCK_STREAM, 0);
+		if(sock == INVALID_SOCKET){
+			HMLOG_ERROR("error in socket");
+			close();
+			return -1;
+		}
+
+		addr.sin_family = AF_INET;    // host byte order
+		addr.sin_port = htons(port);  // short, network byte order  / port -> each program
+		addr.sin_addr.s_addr = inet_addr(ip);	// IP of the server
+		memset(&(addr.sin_zero), '\0', 8);  // zero the rest of the struct
+
+		//set nonblocking mode
+		u_long iMode = 1;
+		ioctlsocket(sock, FIONBIO, &iMode);
+
+		HMLOG_INFO("Connecting to the server:{} port:{}...", ip, port);
+
+		if(connect(sock, (sockaddr *)&addr, sizeof(sockaddr)) == SOCKET_ERROR){
+			if(WSAGetLastError() != WSAEWOULDBLOCK){
+				HMLOG_ERROR("error in connect");
+				close();
+				return -1;
+			}
+			return 1;
+		}
+		connected = true;
+		HMLOG_INFO("connected");
+
+		return 0;
+	}
+
+	/*!
+	 * @brief Check if non-blocking connect started by open() has finished
+	 * @param timeout_ms max time to wait [ms] (0: check only)
+	 * @return 1 if connected, 0 if still in progress, -1 if connect failed
+	 */
+	int HotmockTransport::finishConnect(int timeout_ms){
+		fd_set writefds;
+		fd_set exceptfds;
+		struct timeval tv;
+
+		if(connected){
+			return 1;
+		}
+		if(sock == INVALID_SOCKET){
+			return -1;
+		}
+		FD_ZERO(&writefds);
+		FD_ZERO(&exceptfds);
+		FD_SET(sock, &writefds);
+		FD_SET(sock, &exceptfds);
+		tv.tv_sec = timeout_ms/1000;
+		tv.tv_usec = (timeout_ms%1000)*1000;
+
+		int res = select(0, NULL, &writefds, &exceptfds, &tv);
+		if(res == SOCKET_ERROR){
+			HMLOG_ERROR("Error in HotmockTransport::finishConnect(): {}", WSAGetLastError());
+			return -1;
+		}
+		if(res == 0){
+			return 0;
+		}
+		if(FD_ISSET(sock, &exceptfds)){ //connect failed
+			HMLOG_ERROR("error in connect");
+			return -1;
+		}
+		connected = true;
+		HMLOG_INFO("connected");
+		return 1;
+	}
+
+	/*!
+	 * @brief Close socket
+	 */
+	void HotmockTransport::close(){
+		if(sock != INVALID_SOCKET){
+			closesocket(sock);
+			sock = INVALID_SOCKET;
+		}
+		connected = false;
+		if(wsa_set){
+			WSACleanup();
+			wsa_set = false;
+		}
+	}
+
+	/*!
+	 * @brief Check if socket is open
+	 * @return true if connected
+	 */
+	bool HotmockTransport::isOpen() const{
+		return sock != INVALID_SOCKET;
+	}
+
+	/*!
+	 * @brief Wait until data arrives
+	 * @param timeout_ms timeout [ms] (0: check only)
+	 * @return 1 if readable, 0 if timeout, -1 if error
+	 */
+	int HotmockTransport::wait(int timeout_ms){
+		fd_set readfds;
+		struct timeval tv;
+
+		if(sock == INVALID_SOCKET){
+			return -1;
+		}
+		FD_ZERO(&readfds);
+		FD_SET(sock, &readfds);
+		tv.tv_sec = timeout_ms/1000;
+		tv.tv_usec = (timeout_ms%1000)*1000;
+
+		int res = select(0, &readfds, NULL, NULL, &tv);
+		if(res == SOCKET_ERROR){
+			HMLOG_ERROR("Error in HotmockTransport::wait(): {}", WSAGetLastError());
+			return -1;
+		}
+		return (res > 0) ? 1 : 0;
+	}
+
+	/*!
+	 * @brief Send data
+	 * @param buf data to be sent
+	 * @param len size of data
+	 * @return number of bytes sent, -1 if error
+	 */
+	int HotmockTransport::send(const char *buf, int len){
+		int res = ::send(sock, buf, len, 0);
+		if(res == SOCKET_ERROR){
+			if(WSAGetLastError() == WSAEWOULDBLOCK){
+				return 0;
+			}
+			return -1;
+		}
+		return res;
+	}
+
+	/*!
+	 * @brief Receive data
+	 * @param buf buffer
+	 * @param len size of buffer
+	 * @return number of bytes received, 0 if no data (would block), -1 if error or connection closed
+	 */
+	int HotmockTransport::recv(char *buf, int len){
+		int res = ::recv(sock, buf, len, 0);
+		if(res > 0){
+			return res;
+		}
+		if(res == 0){ //connection closed by the server
+			HMLOG_ERROR("Error in receive message: connection closed");
+			return -1;
+		}
+
+		int nError = WSAGetLastError();
+		if(nError!=WSAEWOULDBLOCK && nError!=0){
+			HMLOG_ERROR("Error in receive message");
+			return -1;
+		}
+		return 0;
+	}
+
+	/*!
+	 * @brief Constuctor
+	 */
+	HotmockPoller::HotmockPoller(){
+		wake_sock = INVALID_SOCKET;
+		wsa_set = false;
+		wake_pending = false;
+		for(unsigned int i=0;i<max_transports;i++){
+			transports[i] = NULL;
+		}
+	}
+
+	/*!
+	 * @brief Destructor (the attached transports are detached)
+	 */
+	HotmockPoller::~HotmockPoller(){
+		for(unsigned int i=0;i<max_transports;i++){
+			if(transports[i] != NULL){
+				transports[i]->attach(NULL, 0);
+			}
+		}
+		close();
+	}
+
+	/*!
+	 * @brief Create the wakeup socket: a UDP socket bound to loopback and connected to itself,
+	 * so that it can be put in the fd_set with the sockets of the transports
+	 * (the fd_set itself is built from the attached transports by wait())
+	 * @return 0 if no error (or already open), -1 if error
+	 */
+	int HotmockPoller::open(){
+		struct sockaddr_in addr;
+		int addr_len = sizeof(addr);
+		u_long nonblock = 1;
+
+		if(wake_sock != INVALID_SOCKET){
+			return 0;
+		}
+		int res = WSAStartup(MAKEWORD(2,2), &wsaData);
+		if(res != 0) {
+			WSACleanup();
+			HMLOG_ERROR("WSAStartup failed with error:{}", res);
+			return -1;
+		}
+		wsa_set = true;
+
+		wake_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		if(wake_sock == INVALID_SOCKET){
+			HMLOG_ERROR("error in socket");
+			close();
+			return -1;
+		}
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = 0; //any free port
+		if(bind(wake_sock, (struct sockaddr *)&addr, sizeof(addr)) == SOCKET_ERROR
+			|| getsockname(wake_sock, (struct sockaddr *)&addr, &addr_len) == SOCKET_ERROR
+			|| connect(wake_sock, (struct sockaddr *)&addr, sizeof(addr)) == SOCKET_ERROR
+			|| ioctlsocket(wake_sock, FIONBIO, &nonblock) != 0){
+			HMLOG_ERROR("error in creating wakeup socket: {}", WSAGetLastError());
+			close();
+			return -1;
+		}
+		wake_pending = false;
+		return 0;
+	}
+
+	/*!
+	 * @brief Close the wakeup socket (the transports stay attached)
+	 */
+	void HotmockPoller::close(){
+		if(wake_sock != INVALID_SOCKET){
+			closesocket(wake_sock);
+			wake_sock = INVALID_SOCKET;
+		}
+		if(wsa_set){
+			WSACleanup();
+			wsa_set = false;
+		}
+	}
+
+	/*!
+	 * @brief Nothing to do: wait() checks the state of the attached transports every call
+	 * @param transport attached transport
+	 */
+	void HotmockPoller::watch(HotmockTransport *transport){
+	}
+
+	/*!
+	 * @brief Nothing to do: wait() checks the state of the attached transports every call
+	 * @param transport attached transport
+	 */
+	void HotmockPoller::unwatch(HotmockTransport *transport){
+	}
+
+	/*!
+	 * @brief Wait until any of the attached transports is ready or wakeup() is called (one select() for all)
+	 * @param ready set to true for the index of each transport which is readable
+	 * or whose connect finished (or failed)
+	 * @param num size of ready
+	 * @param timeout_ms timeout [ms] (0: check only, -1: infinite)
+	 * @return # of ready transports, 0 if timeout or woken up, -1 if error
+	 */
+	int HotmockPoller::wait(bool *ready, unsigned int num, int timeout_ms){
+		fd_set readfds;
+		fd_set writefds;
+		fd_set exceptfds;
+		struct timeval tv;
+		unsigned int waiting = 0;
+		int ready_num = 0;
+
+		FD_ZERO(&readfds);
+		FD_ZERO(&writefds);
+		FD_ZERO(&exceptfds);
+		for(unsigned int i=0;i<num;i++){
+			ready[i] = false;
+			HotmockTransport *t = (i < max_transports) ? transports[i] : NULL;
+			if(t == NULL || t->sock == INVALID_SOCKET){
+				continue;
+			}
+			if(t->connected){
+				FD_SET(t->sock, &readfds);
+			}else{
+				FD_SET(t->sock, &writefds);
+				FD_SET(t->sock, &exceptfds);
+			}
+			waiting++;
+		}
+		if(wake_sock != INVALID_SOCKET){
+			FD_SET(wake_sock, &readfds);
+			waiting++;
+		}
+		if(waiting == 0){ //select() without sockets is an error on Winsock
+			Sleep(timeout_ms < 0 ? INFINITE : (DWORD)timeout_ms);
+			return 0;
+		}
+		tv.tv_sec = timeout_ms/1000;
+		tv.tv_usec = (timeout_ms%1000)*1000;
+
+		int res = select(0, &readfds, &writefds, &exceptfds, timeout_ms < 0 ? NULL : &tv);
+		if(res == SOCKET_ERROR){
+			HMLOG_ERROR("Error in HotmockPoller::wait(): {}", WSAGetLastError());
+			return -1;
+		}
+		if(wake_sock != INVALID_SOCKET && FD_ISSET(wake_sock, &readfds)){
+			consumeWakeup();
+		}
+		for(unsigned int i=0;i<num && i<max_transports && res>0;i++){
+			HotmockTransport *t = transports[i];
+			if(t == NULL || t->sock == INVALID_SOCKET){
+				continue;
+			}
+			if(FD_ISSET(t->sock, &readfds) || FD_ISSET(t->sock, &writefds) || FD_ISSET(t->sock, &exceptfds)){
+				ready[i] = true;
+				ready_num++;
+			}
+		}
+		return ready_num;
+	}
+
+	/*!
+	 * @brief End wait() of the thread waiting on this poller (or the next wait() if nobody is waiting).
+	 * Can be called from any thread; calls before wait() consumes the first one cost no system call
+	 */
+	void HotmockPoller::wakeup(){
+		if(wake_sock == INVALID_SOCKET || wake_pending.exchange(true, std::memory_order_acq_rel)){
+			return;
+		}
+		char one = 1;
+		send(wake_sock, &one, 1, 0);
+	}
+
+	/*!
+	 * @brief Read the datagrams sent by wakeup() so that the next wakeup() sends again
+	 */
+	void HotmockPoller::consumeWakeup(){
+		char buf[16];
+		while(recv(wake_sock, buf, sizeof(buf), 0) > 0){
+		}
+		wake_pending.exchange(false, std::memory_order_acq_rel);
+	}
+
+}
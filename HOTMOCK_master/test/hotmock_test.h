@@ -0,0 +1,31 @@
+// -*- C++ -*-
+/*!
+ * @file  hotmock_test.h
+ * @brief minimal check macros shared by the unit tests (each test is one executable run by CTest)
+ * @date $Date$
+ *
+ */
+#ifndef HOTMOCK_TEST_H
+#define HOTMOCK_TEST_H
+
+#include <iostream>
+
+static int hotmock_test_failures = 0; /*!< # of failed checks in this executable */
+
+/*!
+ * @brief Report the expression and continue if it is false
+ */
+#define HOTMOCK_CHECK(cond) \
+	do{ \
+		if(!(cond)){ \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " << #cond << std::endl; \
+			hotmock_test_failures++; \
+		} \
+	}while(0)
+
+/*!
+ * @brief Result of the test executable (0 if every check passed)
+ */
+#define HOTMOCK_TEST_RESULT() (hotmock_test_failures == 0 ? 0 : 1)
+
+#endif
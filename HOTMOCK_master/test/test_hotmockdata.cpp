@@ -0,0 +1,149 @@
+// -*- C++ -*-
+/*!
+ * @file  test_hotmockdata.cpp
+ * @brief unit test of HotmockData (overflow policy and counter, drain and discard)
+ * @date $Date$
+ *
+ */
+
+#include <thread>
+
+#include "hotmock_test.h"
+#include "hotmockclient.h"
+
+using hotmock::HotmockData;
+
+/*!
+ * @brief Data arriving while a ring is full replaces the oldest data, which is counted; the other connectors are not affected
+ */
+static void testOverflow(){
+	HotmockData<double, 4> data(2, 1); //connector ID 1 and 2
+
+	for(int i=0;i<4;i++){
+		HOTMOCK_CHECK(data.setData(1, i, 100 + i) == 0);
+	}
+	HOTMOCK_CHECK(data.setData(1, 4.0, 104) == -2);
+	HOTMOCK_CHECK(data.setData(1, 5.0, 105) == -2);
+	HOTMOCK_CHECK(data.getOverflowCount(1) == 2);
+	HOTMOCK_CHECK(data.getOverflowCount(2) == 0);
+	HOTMOCK_CHECK(data.setData(2, 1.0, 100) == 0);
+	HOTMOCK_CHECK(data.setData(3, 1.0, 100) == -1); //out of range
+	HOTMOCK_CHECK(data.getOverflowCount(3) == 0);
+
+	//the ring keeps the newest data: 0 and 1 were dropped
+	unsigned long long time_ns;
+	HOTMOCK_CHECK(data.getNextData(1, time_ns) == 2.0 && time_ns == 102);
+	HOTMOCK_CHECK(data.setData(1, 6.0, 106) == 0);
+	HOTMOCK_CHECK(data.getLatestData(1, time_ns) == 6.0 && time_ns == 106);
+	HOTMOCK_CHECK(!data.isNew(1));
+
+	//initialize() clears the rings and the counters
+	data.initialize(2, 1);
+	HOTMOCK_CHECK(data.getOverflowCount(1) == 0);
+	HOTMOCK_CHECK(!data.isNew(2));
+}
+
+/*!
+ * @brief A consumer which empties the ring every cycle (getLatestData, drain or discard) never loses the newest data
+ */
+static void testConsumeEveryCycle(){
+	HotmockData<double, 4> data(1, 1);
+	double out[4];
+	unsigned long long times[4];
+	unsigned long long time_ns;
+
+	for(int cycle=0;cycle<10;cycle++){
+		for(int i=0;i<3;i++){ //less than the capacity per cycle
+			data.setData(1, cycle*10 + i, cycle*10 + i);
+		}
+		switch(cycle%3){
+			case 0:
+				HOTMOCK_CHECK(data.getLatestData(1, time_ns) == cycle*10 + 2 && time_ns == (unsigned long long)(cycle*10 + 2));
+				break;
+			case 1:
+				HOTMOCK_CHECK(data.drain(1, out, 4, times) == 3 && out[2] == cycle*10 + 2 && times[0] == (unsigned long long)(cycle*10));
+				break;
+			default:
+				HOTMOCK_CHECK(data.discard(1) == 3);
+				break;
+		}
+		HOTMOCK_CHECK(!data.isNew(1));
+	}
+	HOTMOCK_CHECK(data.getOverflowCount(1) == 0);
+	HOTMOCK_CHECK(data.discard(2) == 0); //out of range
+}
+
+/*!
+ * @brief drain() returns the backlog in order of arrival with the receive time of each data,
+ * at most max at a time (the rest stays for the next call)
+ */
+static void testDrain(){
+	HotmockData<hotmock::Vector3d, 8> data(1, 1);
+	hotmock::Vector3d out[8];
+	unsigned long long times[8];
+
+	for(int round=0;round<3;round++){ //wraps around the ring
+		for(int i=0;i<5;i++){
+			hotmock::Vector3d value;
+			value.x = round*10 + i;
+			value.y = -value.x;
+			value.z = 0.5;
+			HOTMOCK_CHECK(data.setData(1, value, 1000 + round*10 + i) == 0);
+		}
+		HOTMOCK_CHECK(data.drain(1, out, 3, times) == 3);
+		for(int i=0;i<3;i++){
+			HOTMOCK_CHECK(out[i].x == round*10 + i && out[i].y == -out[i].x && out[i].z == 0.5);
+			HOTMOCK_CHECK(times[i] == (unsigned long long)(1000 + round*10 + i));
+		}
+		HOTMOCK_CHECK(data.isNew(1));
+		HOTMOCK_CHECK(data.drain(1, out, 8, NULL) == 2); //times are optional
+		HOTMOCK_CHECK(out[0].x == round*10 + 3 && out[1].x == round*10 + 4);
+		HOTMOCK_CHECK(data.drain(1, out, 8, times) == 0);
+	}
+	HOTMOCK_CHECK(data.drain(0, out, 8, times) == 0); //out of range
+}
+
+/*!
+ * @brief A producer which overruns a slow consumer: the values taken out keep increasing,
+ * none is taken out twice and the last one is always kept
+ */
+static void testOverrunTwoThreads(){
+	static const int count = 20000;
+	HotmockData<double, 4> data(1, 1);
+	double out[4];
+	double last = -1.0;
+	bool ordered = true;
+	std::size_t taken = 0;
+
+	std::thread producer([&data]{
+		for(int i=0;i<count;i++){
+			data.setData(1, i, i);
+			if(i % 64 == 0){
+				std::this_thread::yield(); //let the consumer run on a single CPU
+			}
+		}
+	});
+	while(last < count-1){
+		std::size_t n = data.drain(1, out, 2, NULL);
+		for(std::size_t i=0;i<n;i++){
+			ordered = ordered && (out[i] > last);
+			last = out[i];
+		}
+		taken += n;
+		if(n == 0){
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+	HOTMOCK_CHECK(ordered);
+	HOTMOCK_CHECK(last == count-1);
+	HOTMOCK_CHECK(taken + data.getOverflowCount(1) == (std::size_t)count);
+}
+
+int main(){
+	testOverflow();
+	testConsumeEveryCycle();
+	testDrain();
+	testOverrunTwoThreads();
+	return HOTMOCK_TEST_RESULT();
+}
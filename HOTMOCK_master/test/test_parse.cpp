@@ -0,0 +1,233 @@
+// -*- C++ -*-
+/*!
+ * @file  test_parse.cpp
+ * @brief unit test of the receive path (frames split across recv() chunks, oversize frames and numbers, read limit)
+ * @date $Date$
+ *
+ */
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "hotmock_test.h"
+#include "hotmockclient.h"
+
+using namespace hotmock;
+
+static const int max_poll = 2000; //# of 1ms polls before giving up
+
+/*!
+ * @brief Loopback server which plays Hotmock (sends the given bytes as they are)
+ */
+class TestServer{
+	int listen_fd;
+	int conn_fd;
+public:
+	unsigned short port;
+
+	TestServer() : listen_fd(-1), conn_fd(-1), port(0) {}
+	~TestServer(){
+		if(conn_fd >= 0) close(conn_fd);
+		if(listen_fd >= 0) close(listen_fd);
+	}
+
+	/*!
+	 * @brief Listen on an ephemeral port of 127.0.0.1
+	 * @return 0 if no error, -1 if error
+	 */
+	int listen(){
+		sockaddr_in addr;
+		socklen_t len = sizeof(addr);
+
+		listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+		if(listen_fd < 0){
+			return -1;
+		}
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = 0;
+		if(bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) < 0 || ::listen(listen_fd, 1) < 0
+			|| getsockname(listen_fd, (sockaddr *)&addr, &len) < 0){
+			return -1;
+		}
+		port = ntohs(addr.sin_port);
+		return 0;
+	}
+
+	/*!
+	 * @brief Accept the client (the client's connect is driven by recvDataFromHotmock())
+	 * @return 0 if no error, -1 if error
+	 */
+	int accept(HotmockClient &client){
+		for(int i=0;i<max_poll && !client.isConnected();i++){
+			client.recvDataFromHotmock();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		conn_fd = ::accept(listen_fd, NULL, NULL);
+		if(conn_fd < 0){
+			return -1;
+		}
+		int nodelay = 1;
+		setsockopt(conn_fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+		return client.isConnected() ? 0 : -1;
+	}
+
+	/*!
+	 * @brief Send bytes without waiting for the client
+	 * @return # of bytes sent
+	 */
+	int sendRaw(const char *data){
+		return (int)send(conn_fd, data, std::strlen(data), 0);
+	}
+
+	/*!
+	 * @brief Send one chunk and wait until the client has received it with its own recv() calls
+	 * @return # of frames parsed from the chunk
+	 */
+	unsigned int sendChunk(HotmockClient &client, const char *chunk){
+		int len = (int)std::strlen(chunk);
+		unsigned int bytes = 0;
+		unsigned int frames = 0;
+
+		HOTMOCK_CHECK(send(conn_fd, chunk, len, 0) == len);
+		for(int i=0;i<max_poll && bytes<(unsigned int)len;i++){
+			if(client.recvDataFromHotmock() > 0){
+				bytes += client.getRecvStatus().bytes;
+				frames += client.getRecvStatus().frames;
+			}else{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+		HOTMOCK_CHECK(bytes == (unsigned int)len);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1)); //next chunk arrives later
+		return frames;
+	}
+};
+
+/*!
+ * @brief Frames split across chunks are completed by the chunk carrying their delimiter and stamped with its time
+ */
+static void testSplitFrames(HotmockClient &client, TestServer &server){
+	unsigned long long t_di1, t_di2, t_ai1;
+
+	HOTMOCK_CHECK(server.sendChunk(client, "DI01,1&DI0") == 1);
+	HOTMOCK_CHECK(client.DIData.getLatestData(1, t_di1) == 1);
+	HOTMOCK_CHECK(!client.DIData.isNew(2));
+
+	HOTMOCK_CHECK(server.sendChunk(client, "2,0&AI01,2.5") == 1);
+	HOTMOCK_CHECK(client.DIData.getLatestData(2, t_di2) == 0);
+	HOTMOCK_CHECK(!client.AIData.isNew(1));
+
+	HOTMOCK_CHECK(server.sendChunk(client, "&") == 1);
+	HOTMOCK_CHECK(client.AIData.getLatestData(1, t_ai1) == 2.5);
+
+	HOTMOCK_CHECK(t_di1 < t_di2 && t_di2 < t_ai1);
+}
+
+/*!
+ * @brief A frame longer than the carry-over buffer is discarded up to its delimiter; the next frame is parsed
+ */
+static void testOversizeFrame(HotmockClient &client, TestServer &server){
+	char longFrame[81];
+	unsigned long long time_ns;
+
+	std::memset(longFrame, 'X', sizeof(longFrame)-1);
+	longFrame[sizeof(longFrame)-1] = '\0';
+
+	//longer than the buffer in one chunk
+	HOTMOCK_CHECK(server.sendChunk(client, longFrame) == 0);
+	HOTMOCK_CHECK(server.sendChunk(client, "&AI01,1.0&") == 1);
+	HOTMOCK_CHECK(client.AIData.getLatestData(1, time_ns) == 1.0);
+
+	//each chunk fits but the frame does not
+	longFrame[40] = '\0';
+	HOTMOCK_CHECK(server.sendChunk(client, "AI01,") == 0);
+	HOTMOCK_CHECK(server.sendChunk(client, longFrame) == 0);
+	HOTMOCK_CHECK(server.sendChunk(client, longFrame) == 0);
+	HOTMOCK_CHECK(server.sendChunk(client, "&AI01,3.0&PI0") == 1);
+	HOTMOCK_CHECK(client.AIData.getLatestData(1, time_ns) == 3.0);
+	HOTMOCK_CHECK(server.sendChunk(client, "2,4.0&") == 1);
+	HOTMOCK_CHECK(client.PIData.getLatestData(2, time_ns) == 4.0);
+}
+
+/*!
+ * @brief Numbers longer than their field allows are rejected without overflowing; the next frame is parsed
+ */
+static void testLongNumbers(HotmockClient &client, TestServer &server){
+	unsigned long long time_ns;
+
+	HOTMOCK_CHECK(server.sendChunk(client, "DI99999999999999999999,1&DI01,99999999999999999999&DI65537,1&") == 0);
+	HOTMOCK_CHECK(!client.DIData.isNew(1)); //65537 is not taken as 1
+	HOTMOCK_CHECK(server.sendChunk(client, "AI01,1e99999999999&AI01,2e-99999999999&AI01,3e1000&") == 0);
+	HOTMOCK_CHECK(!client.AIData.isNew(1));
+
+	HOTMOCK_CHECK(server.sendChunk(client, "DI01,1000000000&DI01,999999999&") == 1);
+	HOTMOCK_CHECK(client.DIData.getLatestData(1, time_ns) == (unsigned char)999999999);
+	HOTMOCK_CHECK(server.sendChunk(client, "AI01,1.5e2&") == 1);
+	HOTMOCK_CHECK(client.AIData.getLatestData(1, time_ns) == 150.0);
+	HOTMOCK_CHECK(server.sendChunk(client, "AI01,100000000000000000000000000000&") == 1); //mantissa longer than double precision
+	double value = client.AIData.getLatestData(1, time_ns);
+	HOTMOCK_CHECK(value > 0.999999e29 && value < 1.000001e29);
+}
+
+/*!
+ * @brief One call reads at most one receive buffer size; the rest stays in the socket and is read by the next calls
+ */
+static void testReadLimit(HotmockClient &client, TestServer &server){
+	static const int frame_num = 100;
+	static const char frame[] = "DI01,1&";
+	char data[frame_num*(sizeof(frame)-1) + 1];
+	unsigned int total = (unsigned int)(sizeof(data)-1);
+	unsigned int bytes = 0;
+	unsigned int frames = 0;
+	int calls = 0;
+
+	for(int i=0;i<frame_num;i++){
+		std::memcpy(&data[i*(sizeof(frame)-1)], frame, sizeof(frame));
+	}
+	HOTMOCK_CHECK(server.sendRaw(data) == (int)total);
+	std::this_thread::sleep_for(std::chrono::milliseconds(20)); //everything is queued in the socket
+
+	HOTMOCK_CHECK(client.recvDataFromHotmock() == (int)HotmockClient::min_recv_buffer_size);
+	HOTMOCK_CHECK(client.getRecvStatus().buffer_full);
+	bytes = client.getRecvStatus().bytes;
+	frames = client.getRecvStatus().frames;
+	while(bytes < total && calls < max_poll){
+		HOTMOCK_CHECK(client.recvDataFromHotmock() > 0);
+		HOTMOCK_CHECK(client.getRecvStatus().bytes <= HotmockClient::min_recv_buffer_size);
+		bytes += client.getRecvStatus().bytes;
+		frames += client.getRecvStatus().frames;
+		calls++;
+	}
+	HOTMOCK_CHECK(bytes == total && frames == (unsigned int)frame_num);
+	HOTMOCK_CHECK(!client.getRecvStatus().buffer_full);
+	HOTMOCK_CHECK(client.recvDataFromHotmock() == 0);
+}
+
+int main(){
+	HotmockClient client;
+	TestServer server;
+
+	HOTMOCK_CHECK(server.listen() == 0);
+	client.setIOThreadMode(false);
+	client.setRecvBufferSize(1); //smallest buffer (testReadLimit())
+	client.setRequestTimeout(0, 0);
+	HOTMOCK_CHECK(client.initialize(Digital, "127.0.0.1", server.port) == 0);
+	HOTMOCK_CHECK(server.accept(client) == 0);
+	if(client.isConnected()){
+		testSplitFrames(client, server);
+		testOversizeFrame(client, server);
+		testLongNumbers(client, server);
+		testReadLimit(client, server);
+	}
+	client.finalize();
+	return HOTMOCK_TEST_RESULT();
+}
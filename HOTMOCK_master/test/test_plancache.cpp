@@ -0,0 +1,141 @@
+// -*- C++ -*-
+/*!
+ * @file  test_plancache.cpp
+ * @brief unit test of the port plan cache of HotmockSetting (hit, miss and forced rebuild)
+ * @date $Date$
+ *
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "hotmock_test.h"
+#include "hotmocksetting.h"
+
+using hotmock::HotmockSetting;
+
+static const char *hmst = "test_plancache.hmst"; //written to the working directory of the test
+
+/*!
+ * @brief Write a .hmst file with a DigitalBoard and a DI config whose second ID is unused
+ * @param di3 device name of DI ID 3 ("" if unused)
+ */
+static void writeHmst(const char *di3){
+	std::ofstream out(hmst, std::ios::out|std::ios::binary|std::ios::trunc);
+	out << "BD_Config.xml\r\n"
+		<< "DI_Config.xml\r\n"
+		<< "<?xml version=\"1.0\"?><config><item><id>1</id><device_name>DigitalBoard</device_name></item></config>\r\n"
+		<< "<?xml version=\"1.0\"?><config>"
+		<< "<item><id>1</id><device_name>sw</device_name></item>"
+		<< "<item><id>2</id><device_name/></item>"
+		<< "<item><id>3</id><device_name>" << di3 << "</device_name></item>"
+		<< "</config>\r\n";
+}
+
+static bool fileExists(const std::string &name){
+	std::ifstream in(name.c_str());
+	return (bool)in;
+}
+
+/*!
+ * @brief Check the port plan read from the file written by writeHmst()
+ */
+static void checkPlan(const HotmockSetting &setting, unsigned short di3){
+	HOTMOCK_CHECK(setting.boardType == "digital");
+	HOTMOCK_CHECK(setting.useIDFlagList.size() == 2);
+	if(setting.useIDFlagList.size() == 2){
+		HOTMOCK_CHECK(setting.useIDFlagList[0].size() == 1 && setting.useIDFlagList[0][0] == 1);
+		HOTMOCK_CHECK(setting.useIDFlagList[1].size() == 3);
+		if(setting.useIDFlagList[1].size() == 3){
+			HOTMOCK_CHECK(setting.useIDFlagList[1][0] == 1);
+			HOTMOCK_CHECK(setting.useIDFlagList[1][1] == 0);
+			HOTMOCK_CHECK(setting.useIDFlagList[1][2] == di3);
+		}
+	}
+}
+
+/*!
+ * @brief The same content is a hit for another instance; changed content is a miss even if a .plan file exists
+ */
+static void testHitMiss(){
+	std::string plan = std::string(hmst) + ".plan";
+	unsigned long long hash;
+
+	std::remove(plan.c_str());
+	writeHmst("lamp");
+	{
+		HotmockSetting setting;
+		setting.setPlanCache(hotmock::PlanCacheFile);
+		HOTMOCK_CHECK(setting.initialize(hmst) == 0);
+		HOTMOCK_CHECK(setting.setPort() == 0);
+		HOTMOCK_CHECK(!setting.fromCache);
+		checkPlan(setting, 1);
+		HOTMOCK_CHECK(fileExists(plan));
+		hash = setting.contentHash;
+	}
+	{
+		HotmockSetting setting; //another instance shares the cache
+		HOTMOCK_CHECK(setting.initialize(hmst) == 0);
+		HOTMOCK_CHECK(setting.contentHash == hash);
+		HOTMOCK_CHECK(setting.setPort() == 0);
+		HOTMOCK_CHECK(setting.fromCache);
+		checkPlan(setting, 1);
+	}
+
+	//the .plan file of the old content is not used
+	writeHmst("");
+	{
+		HotmockSetting setting;
+		setting.setPlanCache(hotmock::PlanCacheFile);
+		HOTMOCK_CHECK(setting.initialize(hmst) == 0);
+		HOTMOCK_CHECK(setting.contentHash != hash);
+		HOTMOCK_CHECK(setting.setPort() == 0);
+		HOTMOCK_CHECK(!setting.fromCache);
+		checkPlan(setting, 0);
+	}
+	{
+		HotmockSetting setting;
+		setting.setPlanCache(hotmock::PlanCacheOff);
+		HOTMOCK_CHECK(setting.initialize(hmst) == 0);
+		HOTMOCK_CHECK(setting.setPort() == 0);
+		HOTMOCK_CHECK(!setting.fromCache);
+		checkPlan(setting, 0);
+	}
+}
+
+/*!
+ * @brief PlanCacheRebuild parses the file even if cached and writes the .plan file again
+ */
+static void testRebuild(){
+	std::string plan = std::string(hmst) + ".plan";
+
+	writeHmst("lamp"); //cached by testHitMiss()
+	std::remove(plan.c_str());
+	{
+		HotmockSetting setting;
+		setting.setPlanCache(hotmock::PlanCacheRebuild);
+		HOTMOCK_CHECK(setting.initialize(hmst) == 0);
+		HOTMOCK_CHECK(setting.setPort() == 0);
+		HOTMOCK_CHECK(!setting.fromCache);
+		checkPlan(setting, 1);
+		HOTMOCK_CHECK(fileExists(plan));
+	}
+	{
+		HotmockSetting setting;
+		setting.setPlanCache(hotmock::PlanCacheFile);
+		HOTMOCK_CHECK(setting.initialize(hmst) == 0);
+		HOTMOCK_CHECK(setting.setPort() == 0);
+		HOTMOCK_CHECK(setting.fromCache);
+		checkPlan(setting, 1);
+	}
+
+	std::remove(plan.c_str());
+	std::remove(hmst);
+}
+
+int main(){
+	testHitMiss();
+	testRebuild();
+	return HOTMOCK_TEST_RESULT();
+}
@@ -0,0 +1,130 @@
+// -*- C++ -*-
+/*!
+ * @file  test_portpool.cpp
+ * @brief unit test of PortPool (add, remove and reuse with stable indices)
+ * @date $Date$
+ *
+ */
+
+#include <cstddef>
+
+#include "hotmock_test.h"
+
+//PortPool needs no OpenRTM; the port classes in the same header are not instantiated
+namespace RTC{ template <class T> class InPort; template <class T> class OutPort; }
+#include "dynamic_port.hpp"
+
+/*!
+ * @brief Object which counts live instances and can make its constructor throw
+ */
+struct Counted{
+	static int live;
+	static bool fail;
+	int value;
+
+	Counted(int v = 0) : value(v){
+		if(fail){
+			throw std::runtime_error("constructor failed");
+		}
+		live++;
+	}
+	~Counted(){
+		live--;
+	}
+};
+int Counted::live = 0;
+bool Counted::fail = false;
+
+/*!
+ * @brief Reserved objects are contiguous; removing an object keeps the other indices and addresses, and exists() reports the empty index
+ */
+static void testAddRemove(){
+	{
+		PortPool<Counted> pool;
+		pool.reserve(4);
+		for(int i=0;i<4;i++){
+			HOTMOCK_CHECK(pool.add(i)->value == i);
+		}
+		HOTMOCK_CHECK(pool.size() == 4 && Counted::live == 4);
+		for(unsigned int i=1;i<4;i++){
+			HOTMOCK_CHECK(pool.get(i) == pool.get(0) + i);
+		}
+
+		Counted *last = pool.get(3);
+		Counted *second = pool.get(2);
+		pool.remove(1); //middle: the index stays with NULL
+		HOTMOCK_CHECK(pool.size() == 4 && pool.get(1) == NULL && Counted::live == 3);
+		HOTMOCK_CHECK(pool.get(2) == second && pool.get(2)->value == 2);
+		HOTMOCK_CHECK(pool.exists(0) && !pool.exists(1) && pool.exists(2) && pool.exists(3) && !pool.exists(4));
+
+		pool.remove(3); //trailing: the size shrinks and the storage is reused
+		HOTMOCK_CHECK(pool.size() == 3 && Counted::live == 2);
+		HOTMOCK_CHECK(pool.add(7) == last && pool.get(3)->value == 7);
+
+		pool.remove(3);
+		pool.remove(2); //trailing NULL indices go with the last object
+		HOTMOCK_CHECK(pool.size() == 1 && pool.get(0)->value == 0);
+		HOTMOCK_CHECK(!pool.exists(1));
+
+		//more objects than the first slab holds: the old ones do not move
+		Counted *first = pool.get(0);
+		for(int i=1;i<20;i++){
+			pool.add(i);
+		}
+		HOTMOCK_CHECK(pool.size() == 20 && pool.get(0) == first && pool.get(19)->value == 19);
+	}
+	HOTMOCK_CHECK(Counted::live == 0);
+}
+
+/*!
+ * @brief create() and replace() reset an object at the same index; a throwing constructor leaves the old object
+ */
+static void testReplace(){
+	{
+		PortPool<Counted> pool;
+		for(int i=0;i<3;i++){
+			pool.add(i);
+		}
+		Counted *old = pool.get(1);
+
+		Counted *obj = pool.create(10);
+		HOTMOCK_CHECK(Counted::live == 4 && pool.size() == 3);
+		pool.replace(1, obj);
+		HOTMOCK_CHECK(pool.get(1) == obj && pool.get(1)->value == 10 && Counted::live == 3);
+		HOTMOCK_CHECK(pool.get(0)->value == 0 && pool.get(2)->value == 2);
+
+		Counted::fail = true;
+		bool thrown = false;
+		try{
+			pool.create(11);
+		}
+		catch(const std::runtime_error &){
+			thrown = true;
+		}
+		Counted::fail = false;
+		HOTMOCK_CHECK(thrown && pool.get(1) == obj && pool.get(1)->value == 10 && Counted::live == 3);
+
+		obj = pool.create(12); //storage released by replace() is reused
+		HOTMOCK_CHECK(obj == old);
+		pool.replace(1, obj);
+		HOTMOCK_CHECK(pool.get(1)->value == 12 && Counted::live == 3);
+
+		obj = pool.create(13); //not used
+		pool.discard(obj);
+		HOTMOCK_CHECK(Counted::live == 3 && pool.get(1)->value == 12);
+		HOTMOCK_CHECK(pool.create(14) == obj);
+		pool.replace(0, obj);
+		HOTMOCK_CHECK(pool.get(0)->value == 14 && Counted::live == 3);
+
+		pool.clear();
+		HOTMOCK_CHECK(pool.size() == 0 && Counted::live == 0);
+		HOTMOCK_CHECK(pool.add(5)->value == 5);
+	}
+	HOTMOCK_CHECK(Counted::live == 0);
+}
+
+int main(){
+	testAddRemove();
+	testReplace();
+	return HOTMOCK_TEST_RESULT();
+}
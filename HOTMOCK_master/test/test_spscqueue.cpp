@@ -0,0 +1,119 @@
+// -*- C++ -*-
+/*!
+ * @file  test_spscqueue.cpp
+ * @brief unit test of SPSCQueue (full, empty and wrap-around of the indices)
+ * @date $Date$
+ *
+ */
+
+#include <thread>
+
+#include "hotmock_test.h"
+#include "spscqueue.h"
+
+using hotmock::SPSCQueue;
+
+/*!
+ * @brief push() fails when full and pop() fails when empty, also after the indices wrap around the buffer
+ */
+static void testFullEmpty(){
+	SPSCQueue<int, 4> queue;
+	int value;
+
+	HOTMOCK_CHECK(queue.empty());
+	HOTMOCK_CHECK(!queue.pop(value));
+	for(int round=0;round<5;round++){ //every slot is used several times
+		for(int i=0;i<4;i++){
+			HOTMOCK_CHECK(queue.push(round*10 + i));
+		}
+		HOTMOCK_CHECK(queue.size() == 4);
+		HOTMOCK_CHECK(!queue.push(-1));
+		for(int i=0;i<4;i++){
+			HOTMOCK_CHECK(queue.pop(value) && value == round*10 + i);
+		}
+		HOTMOCK_CHECK(queue.empty());
+		HOTMOCK_CHECK(!queue.pop(value));
+	}
+
+	//partially filled queue crossing the end of the buffer
+	for(int i=0;i<3;i++){
+		queue.push(i);
+	}
+	queue.pop(value);
+	queue.pop(value);
+	for(int i=3;i<6;i++){
+		HOTMOCK_CHECK(queue.push(i));
+	}
+	HOTMOCK_CHECK(!queue.push(-1));
+	for(int i=2;i<6;i++){
+		HOTMOCK_CHECK(queue.pop(value) && value == i);
+	}
+}
+
+/*!
+ * @brief popLatest(), drain() and discard() consume the whole backlog
+ */
+static void testConsumeAll(){
+	SPSCQueue<int, 8> queue;
+	int value;
+	int out[8];
+
+	for(int i=0;i<6;i++){
+		queue.push(i);
+	}
+	HOTMOCK_CHECK(queue.popLatest(value) && value == 5);
+	HOTMOCK_CHECK(queue.empty());
+	HOTMOCK_CHECK(!queue.popLatest(value));
+
+	for(int i=0;i<7;i++){
+		queue.push(i);
+	}
+	HOTMOCK_CHECK(queue.drain(out, 3) == 3 && out[0] == 0 && out[2] == 2);
+	HOTMOCK_CHECK(queue.drain(out, 8) == 4 && out[0] == 3 && out[3] == 6);
+	HOTMOCK_CHECK(queue.empty());
+
+	for(int i=0;i<8;i++){
+		queue.push(i);
+	}
+	HOTMOCK_CHECK(queue.discard() == 8);
+	HOTMOCK_CHECK(queue.empty() && queue.push(100));
+}
+
+/*!
+ * @brief Every value pushed by the producer thread is popped once and in order
+ */
+static void testTwoThreads(){
+	static SPSCQueue<unsigned int, 64> queue;
+	const unsigned int num = 100000;
+	bool ordered = true;
+
+	std::thread producer([&](){
+		for(unsigned int i=0;i<num;){
+			if(queue.push(i)){
+				i++;
+			}else{
+				std::this_thread::yield();
+			}
+		}
+	});
+	unsigned int expected = 0;
+	while(expected < num){
+		unsigned int value;
+		if(queue.pop(value)){
+			ordered = ordered && (value == expected);
+			expected++;
+		}else{
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+	HOTMOCK_CHECK(ordered);
+	HOTMOCK_CHECK(queue.empty());
+}
+
+int main(){
+	testFullEmpty();
+	testConsumeAll();
+	testTwoThreads();
+	return HOTMOCK_TEST_RESULT();
+}
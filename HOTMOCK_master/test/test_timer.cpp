@@ -0,0 +1,171 @@
+// -*- C++ -*-
+/*!
+ * @file  test_timer.cpp
+ * @brief unit test of HotmockTimerWheel (expiry, rearm and cancel)
+ * @date $Date$
+ *
+ */
+
+#include <cstddef>
+#include <vector>
+
+#include "hotmock_test.h"
+#include "hotmocktimer.h"
+
+using hotmock::HotmockTimerNode;
+using hotmock::HotmockTimerWheel;
+
+static const unsigned long long tick_ns = 1000000ULL; //1ms
+static const unsigned long long base_ns = 1000000000000ULL; //arbitrary start time
+
+/*!
+ * @brief Record of expired timers
+ */
+struct Expired{
+	HotmockTimerWheel *wheel;
+	std::vector<int> ids;
+	unsigned long long rearm_ns; //reschedule the node this later (0: no rearm)
+	unsigned long long now_ns;
+};
+
+static void onExpire(HotmockTimerNode *node, void *context){
+	Expired *expired = (Expired *)context;
+	expired->ids.push_back(*(int *)node->data);
+	if(expired->rearm_ns > 0){
+		expired->wheel->schedule(node, expired->now_ns + expired->rearm_ns);
+	}
+}
+
+static void initNode(HotmockTimerNode &node, int &id){
+	node.prev = NULL;
+	node.next = NULL;
+	node.expire_tick = 0;
+	node.data = &id;
+}
+
+static void advance(HotmockTimerWheel &wheel, Expired &expired, unsigned long long now_ns){
+	expired.now_ns = now_ns;
+	wheel.advance(now_ns, onExpire, &expired);
+}
+
+/*!
+ * @brief Timers expire in the tick of their deadline, not earlier
+ */
+static void testExpiry(){
+	HotmockTimerWheel wheel(tick_ns);
+	wheel.reset(base_ns);
+	Expired expired = {&wheel, std::vector<int>(), 0, 0};
+	int id[3] = {0, 1, 2};
+	HotmockTimerNode node[3];
+	for(int i=0;i<3;i++){
+		initNode(node[i], id[i]);
+	}
+
+	HOTMOCK_CHECK(wheel.nextDeadline() == ~0ULL);
+	wheel.schedule(&node[0], base_ns + 5*tick_ns);
+	wheel.schedule(&node[1], base_ns + 3*tick_ns + tick_ns/2); //rounded down to its tick
+	wheel.schedule(&node[2], base_ns - tick_ns); //already past: next tick
+	HOTMOCK_CHECK(wheel.size() == 3);
+	HOTMOCK_CHECK(HotmockTimerWheel::isScheduled(&node[0]));
+	HOTMOCK_CHECK(wheel.nextDeadline() == base_ns + tick_ns);
+
+	advance(wheel, expired, base_ns + tick_ns);
+	HOTMOCK_CHECK(expired.ids.size() == 1 && expired.ids[0] == 2);
+	HOTMOCK_CHECK(!HotmockTimerWheel::isScheduled(&node[2]));
+	HOTMOCK_CHECK(wheel.nextDeadline() == base_ns + 3*tick_ns);
+
+	advance(wheel, expired, base_ns + 3*tick_ns - 1);
+	HOTMOCK_CHECK(expired.ids.size() == 1);
+	advance(wheel, expired, base_ns + 4*tick_ns); //several ticks at once
+	HOTMOCK_CHECK(expired.ids.size() == 2 && expired.ids[1] == 1);
+	advance(wheel, expired, base_ns + 5*tick_ns);
+	HOTMOCK_CHECK(expired.ids.size() == 3 && expired.ids[2] == 0);
+	HOTMOCK_CHECK(wheel.size() == 0);
+	HOTMOCK_CHECK(wheel.nextDeadline() == ~0ULL);
+}
+
+/*!
+ * @brief A timer rescheduled from the callback expires again in a later tick;
+ * cancel and reschedule move a timer
+ */
+static void testRearmCancel(){
+	HotmockTimerWheel wheel(tick_ns);
+	wheel.reset(base_ns);
+	Expired expired = {&wheel, std::vector<int>(), 2*tick_ns, 0};
+	int id[2] = {0, 1};
+	HotmockTimerNode node[2];
+	for(int i=0;i<2;i++){
+		initNode(node[i], id[i]);
+	}
+
+	wheel.schedule(&node[0], base_ns + 2*tick_ns);
+	for(unsigned long long t=1;t<=10;t++){
+		advance(wheel, expired, base_ns + t*tick_ns);
+	}
+	HOTMOCK_CHECK(expired.ids.size() == 5); //tick 2,4,6,8,10
+	HOTMOCK_CHECK(wheel.size() == 1 && HotmockTimerWheel::isScheduled(&node[0]));
+	HOTMOCK_CHECK(wheel.nextDeadline() == base_ns + 12*tick_ns);
+
+	wheel.cancel(&node[0]);
+	wheel.cancel(&node[0]); //not scheduled: nothing is done
+	HOTMOCK_CHECK(wheel.size() == 0 && !HotmockTimerWheel::isScheduled(&node[0]));
+	expired.rearm_ns = 0;
+	advance(wheel, expired, base_ns + 20*tick_ns);
+	HOTMOCK_CHECK(expired.ids.size() == 5);
+
+	wheel.schedule(&node[1], base_ns + 30*tick_ns);
+	wheel.schedule(&node[1], base_ns + 25*tick_ns); //moved, not duplicated
+	HOTMOCK_CHECK(wheel.size() == 1);
+	advance(wheel, expired, base_ns + 25*tick_ns);
+	HOTMOCK_CHECK(expired.ids.size() == 6 && expired.ids[5] == 1);
+	advance(wheel, expired, base_ns + 30*tick_ns);
+	HOTMOCK_CHECK(expired.ids.size() == 6);
+}
+
+/*!
+ * @brief Timers more than one round (slot_num ticks) ahead are not expired when their slot is visited early
+ */
+static void testLaterRound(){
+	const unsigned long long round = HotmockTimerWheel::slot_num;
+	HotmockTimerWheel wheel(tick_ns);
+	wheel.reset(base_ns);
+	Expired expired = {&wheel, std::vector<int>(), 0, 0};
+	int id[2] = {0, 1};
+	HotmockTimerNode node[2];
+	for(int i=0;i<2;i++){
+		initNode(node[i], id[i]);
+	}
+
+	wheel.schedule(&node[0], base_ns + (round + 10)*tick_ns);
+	wheel.schedule(&node[1], base_ns + 10*tick_ns); //same slot, this round
+	advance(wheel, expired, base_ns + 10*tick_ns);
+	HOTMOCK_CHECK(expired.ids.size() == 1 && expired.ids[0] == 1);
+	//the earliest timer is out of this round: the end of the round is returned
+	HOTMOCK_CHECK(wheel.nextDeadline() == base_ns + (10 + round)*tick_ns);
+
+	advance(wheel, expired, base_ns + (round + 9)*tick_ns);
+	HOTMOCK_CHECK(expired.ids.size() == 1);
+	advance(wheel, expired, base_ns + (3*round)*tick_ns); //jump over more than a round
+	HOTMOCK_CHECK(expired.ids.size() == 2 && expired.ids[1] == 0);
+	HOTMOCK_CHECK(wheel.size() == 0);
+}
+
+/*!
+ * @brief timeoutMilliseconds() rounds up so that a wait never ends before the deadline
+ */
+static void testTimeout(){
+	HOTMOCK_CHECK(hotmock::timeoutMilliseconds(base_ns, base_ns) == 0);
+	HOTMOCK_CHECK(hotmock::timeoutMilliseconds(base_ns - 1, base_ns) == 0);
+	HOTMOCK_CHECK(hotmock::timeoutMilliseconds(base_ns + 1, base_ns) == 1);
+	HOTMOCK_CHECK(hotmock::timeoutMilliseconds(base_ns + tick_ns, base_ns) == 1);
+	HOTMOCK_CHECK(hotmock::timeoutMilliseconds(base_ns + tick_ns + 1, base_ns) == 2);
+	HOTMOCK_CHECK(hotmock::timeoutMilliseconds(~0ULL, 0) == 0x7fffffff);
+}
+
+int main(){
+	testExpiry();
+	testRearmCancel();
+	testLaterRound();
+	testTimeout();
+	return HOTMOCK_TEST_RESULT();
+}
@@ -0,0 +1,564 @@
+// -*- C++ -*-
+/*!
+ * @file  hotmock_bench.cpp
+ * @brief end-to-end latency and throughput benchmark of HotmockClient against hotmock_server
+ * @date $Date$
+ *
+ * Starts hotmock_server --timestamp on loopback and runs the execution cycle of HOTMOCK_master::onExecute()
+ * (DO output, REQUEST of AI/PI/TS/GS, receive, take out the data of every connector, flush) without OpenRTM.
+ * The moment a sample is taken out of HotmockData stands for the OutPort write.
+ *
+ * Results are written as JSON:
+ * - samples_per_second: sustained samples per connector type
+ * - latency_us: p50/p99/p999/max from the server send() to the take-out (AI, PI, TS, GS)
+ * - cpu_us_per_cycle: CPU time of the cycle thread per cycle, and of the whole process per cycle
+ * - allocations_per_cycle: operator new calls of the process per cycle (counting operator new)
+ *
+ * Usage: hotmock_bench [--server <path>|none] [--port 18888] [--board digital|analog] [--duration <s>]
+ *        [--warmup <s>] [--period <us>] [--window <1-8>] [--io-thread <0|1>] [--stream-rate <Hz>]
+ *        [--di-rate <events/s>] [--burst <frames>] [--latency <ms>] [--output <file>]
+ *
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <ctime>
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "hotmockclient.h"
+
+/*!
+ * @name counting operator new
+ * Every allocation of the process is counted to report allocations per cycle
+ */
+/* @{ */
+static std::atomic<unsigned long long> allocation_count(0);
+
+void *operator new(std::size_t size){
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	void *p = std::malloc(size ? size : 1);
+	if(p == NULL){
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void *operator new[](std::size_t size){
+	return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept{
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept{
+	return operator new(size, tag);
+}
+
+void operator delete(void *p) noexcept{
+	std::free(p);
+}
+
+void operator delete[](void *p) noexcept{
+	std::free(p);
+}
+/* @} */
+
+namespace hotmock{
+
+	/*!
+	 * @brief CPU time of the calling thread
+	 * @return CPU time [ns]
+	 */
+	static unsigned long long threadCPUNanoseconds(){
+		struct timespec ts;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+		return (unsigned long long)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+	}
+
+	/*!
+	 * @brief CPU time of the process (all threads)
+	 * @return CPU time [ns]
+	 */
+	static unsigned long long processCPUNanoseconds(){
+		struct timespec ts;
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+		return (unsigned long long)ts.tv_sec*1000000000ULL + ts.tv_nsec;
+	}
+
+	/*!
+	 * @class HotmockBenchOptions
+	 * @brief Command line options of the benchmark
+	 */
+	class HotmockBenchOptions{
+	public:
+		std::string server; /*!< Path of hotmock_server ("none": already running) */
+		int port; /*!< Port of the server */
+		HotmockBoardType board; /*!< Emulated board */
+		double duration_s; /*!< Measurement time [s] */
+		double warmup_s; /*!< Time before measurement [s] */
+		unsigned int period_us; /*!< Cycle period [us] (0: no sleep) */
+		unsigned int window; /*!< RequestWindow */
+		bool io_thread; /*!< IOThread */
+		double stream_rate; /*!< --stream-rate of the server */
+		double di_rate; /*!< --di-rate of the server */
+		unsigned int burst; /*!< --burst of the server */
+		double latency_ms; /*!< --latency of the server */
+		std::string output; /*!< JSON file (empty: stdout) */
+
+		HotmockBenchOptions() : port(18888), board(Digital), duration_s(5), warmup_s(1), period_us(1000), window(1),
+			io_thread(false), stream_rate(0), di_rate(0), burst(1), latency_ms(0) {}
+
+		int parse(int argc, char **argv);
+	};
+
+	/*!
+	 * @class HotmockLatencyRecorder
+	 * @brief Latencies of one connector type. Memory is reserved before measurement
+	 */
+	class HotmockLatencyRecorder{
+	public:
+		std::vector<double> latency_us; /*!< Recorded latencies [us] */
+		unsigned long long samples; /*!< # of samples (including the ones not recorded) */
+
+		HotmockLatencyRecorder() : samples(0) {}
+
+		/*!
+		 * @brief Record one sample
+		 * @param sent_ns send time written by the server [ns]
+		 * @param now_ns take-out time [ns]
+		 */
+		void add(double sent_ns, unsigned long long now_ns){
+			samples++;
+			if(latency_us.size() < latency_us.capacity()){ //never reallocate while measuring
+				latency_us.push_back(((double)now_ns - sent_ns) * 1e-3);
+			}
+		}
+	};
+
+	/*!
+	 * @brief Get percentile of sorted values
+	 * @param sorted sorted values
+	 * @param p percentile (0-1)
+	 * @return value, 0 if empty
+	 */
+	static double percentile(const std::vector<double> &sorted, double p){
+		if(sorted.empty()){
+			return 0;
+		}
+		std::size_t index = (std::size_t)(p * (sorted.size() - 1) + 0.5);
+		return sorted[std::min(index, sorted.size() - 1)];
+	}
+
+	/*!
+	 * @brief Write {"count":..,"p50":..,"p99":..,"p999":..,"max":..}
+	 * @param os Destination
+	 * @param values values (sorted in place)
+	 */
+	static void writeDistribution(std::ostream &os, std::vector<double> &values){
+		std::sort(values.begin(), values.end());
+		os << "{\"count\": " << values.size()
+			<< ", \"p50\": " << percentile(values, 0.5)
+			<< ", \"p99\": " << percentile(values, 0.99)
+			<< ", \"p999\": " << percentile(values, 0.999)
+			<< ", \"max\": " << (values.empty() ? 0 : values.back()) << "}";
+	}
+
+	/*!
+	 * @brief Parse command line
+	 * @param argc # of arguments
+	 * @param argv arguments
+	 * @return 0 if no error, -1 if invalid option
+	 */
+	int HotmockBenchOptions::parse(int argc, char **argv){
+		//default: hotmock_server next to this executable
+		std::string self = argv[0];
+		std::string::size_type slash = self.rfind('/');
+		server = (slash == std::string::npos) ? "hotmock_server" : self.substr(0, slash+1) + "hotmock_server";
+
+		for(int i=1;i+1<argc;i+=2){
+			std::string name = argv[i];
+			const char *value = argv[i+1];
+			if(name == "--server"){
+				server = value;
+			}else if(name == "--port"){
+				port = std::atoi(value);
+			}else if(name == "--board"){
+				board = (std::strcmp(value, "analog") == 0) ? Analog : Digital;
+			}else if(name == "--duration"){
+				duration_s = std::atof(value);
+			}else if(name == "--warmup"){
+				warmup_s = std::atof(value);
+			}else if(name == "--period"){
+				period_us = (unsigned int)std::atoi(value);
+			}else if(name == "--window"){
+				window = (unsigned int)std::atoi(value);
+			}else if(name == "--io-thread"){
+				io_thread = std::atoi(value) == 1;
+			}else if(name == "--stream-rate"){
+				stream_rate = std::atof(value);
+			}else if(name == "--di-rate"){
+				di_rate = std::atof(value);
+			}else if(name == "--burst"){
+				burst = (unsigned int)std::atoi(value);
+			}else if(name == "--latency"){
+				latency_ms = std::atof(value);
+			}else if(name == "--output"){
+				output = value;
+			}else{
+				std::cerr << "unknown option: " << name << std::endl;
+				return -1;
+			}
+		}
+		if(argc % 2 == 0 || duration_s <= 0 || warmup_s < 0 || burst < 1){
+			std::cerr << "invalid option" << std::endl;
+			return -1;
+		}
+		return 0;
+	}
+
+	/*!
+	 * @brief Start hotmock_server --timestamp
+	 * @param opt options
+	 * @return process ID, 0 if the server is not started, -1 if error
+	 */
+	static pid_t startServer(const HotmockBenchOptions &opt){
+		if(opt.server == "none"){
+			return 0;
+		}
+
+		std::vector<std::string> args;
+		std::ostringstream num;
+		args.push_back(opt.server);
+		args.push_back("--timestamp");
+		args.push_back("--port");
+		num << opt.port;
+		args.push_back(num.str());
+		args.push_back("--board");
+		args.push_back(opt.board == Analog ? "analog" : "digital");
+		num.str("");
+		num << opt.stream_rate;
+		args.push_back("--stream-rate");
+		args.push_back(num.str());
+		num.str("");
+		num << opt.di_rate;
+		args.push_back("--di-rate");
+		args.push_back(num.str());
+		num.str("");
+		num << opt.burst;
+		args.push_back("--burst");
+		args.push_back(num.str());
+		num.str("");
+		num << opt.latency_ms;
+		args.push_back("--latency");
+		args.push_back(num.str());
+
+		std::vector<char *> argv;
+		for(std::size_t i=0;i<args.size();i++){
+			argv.push_back(const_cast<char *>(args[i].c_str()));
+		}
+		argv.push_back(NULL);
+
+		pid_t pid = fork();
+		if(pid == 0){
+			execv(argv[0], &argv[0]);
+			std::perror("execv");
+			_exit(127);
+		}
+		if(pid == -1){
+			std::perror("fork");
+		}
+		return pid;
+	}
+
+	/*!
+	 * @class HotmockBench
+	 * @brief One cycle of HOTMOCK_master::onExecute() and its measurement
+	 */
+	class HotmockBench{
+	private:
+		static const std::size_t max_drain = 64;
+
+		const HotmockBenchOptions &opt;
+		HotmockConnectorInformation info;
+		HotmockClient &hmc;
+		bool measuring;
+		unsigned long long cycle;
+		short DO;
+
+		double values[max_drain];
+		Vector3d vectors[max_drain];
+
+		/*!
+		 * @brief Take out the data of the connectors of a type (as many as received)
+		 * @param data Buffer of the connector type
+		 * @param type Connector type
+		 * @param first first connector ID
+		 * @param num # of connectors
+		 */
+		void takeOut(HotmockData<double> &data, HotmockConnectorType type, unsigned short first, unsigned int num){
+			for(unsigned int i=0;i<num;i++){
+				hmc.sendCommandToHotmock(REQUEST, type, first + i, REQUEST_RAW);
+				std::size_t n = data.drain(first + i, values, max_drain);
+				unsigned long long now_ns = monotonicNanoseconds();
+				for(std::size_t k=0;k<n && measuring;k++){
+					latency[type].add(values[k], now_ns);
+				}
+			}
+		}
+
+	public:
+		HotmockLatencyRecorder latency[6]; /*!< per HotmockConnectorType (DI: count only) */
+		std::vector<double> cycle_cpu_us; /*!< CPU time of each measured cycle [us] */
+
+		HotmockBench(const HotmockBenchOptions &options, HotmockClient &client) : opt(options), info(options.board), hmc(client){
+			measuring = false;
+			cycle = 0;
+			DO = DO_OFF;
+		}
+
+		/*!
+		 * @brief Reserve memory of the results
+		 * @param cycles expected # of cycles
+		 */
+		void reserve(std::size_t cycles){
+			for(int t=0;t<6;t++){
+				latency[t].latency_us.reserve(4000000);
+			}
+			cycle_cpu_us.reserve(cycles);
+		}
+
+		/*!
+		 * @brief Start or stop recording
+		 * @param enable true to record
+		 */
+		void setMeasuring(bool enable) {measuring = enable;}
+
+		/*!
+		 * @brief One execution cycle (same order as HOTMOCK_master::onExecute())
+		 */
+		void run(){
+			unsigned long long cpu_ns = threadCPUNanoseconds();
+
+			hmc.beginBatch();
+
+			//DO: toggle the first output every 100 cycles
+			if(info.DOConnectorNum > 0 && cycle % 100 == 0){
+				DO = (DO == DO_ON) ? DO_OFF : DO_ON;
+				hmc.sendCommandToHotmock(OUTPUT, hotmock::DO, info.DOFirstConnectorID, DO);
+			}
+
+			hmc.recvDataFromHotmock();
+
+			//DI
+			for(unsigned int i=0;i<info.DIConnectorNum;i++){
+				while(hmc.DIData.isNew(info.DIFirstConnectorID + i)){
+					hmc.DIData.getNextData(info.DIFirstConnectorID + i);
+					if(measuring){
+						latency[DI].samples++;
+					}
+				}
+			}
+
+			//AI, PI, TS
+			takeOut(hmc.AIData, AI, info.AIFirstConnectorID, info.AIConnectorNum);
+			takeOut(hmc.PIData, PI, info.PIFirstConnectorID, info.PIConnectorNum);
+			takeOut(hmc.TSData, TS, info.TSFirstConnectorID, info.TSConnectorNum);
+
+			//GS
+			for(unsigned int i=0;i<info.GSConnectorNum;i++){
+				hmc.sendCommandToHotmock(REQUEST, GS, info.GSFirstConnectorID + i, REQUEST_RAW);
+				std::size_t n = hmc.GSData.drain(info.GSFirstConnectorID + i, vectors, max_drain);
+				unsigned long long now_ns = monotonicNanoseconds();
+				for(std::size_t k=0;k<n && measuring;k++){
+					latency[GS].add(vectors[k].x, now_ns);
+				}
+			}
+
+			hmc.flush();
+
+			if(measuring && cycle_cpu_us.size() < cycle_cpu_us.capacity()){
+				cycle_cpu_us.push_back((threadCPUNanoseconds() - cpu_ns) * 1e-3);
+			}
+			cycle++;
+		}
+	};
+
+};
+
+int main(int argc, char **argv){
+	using namespace hotmock;
+	static const char *type_name[] = {"DI", "DO", "AI", "PI", "GS", "TS"};
+	HotmockBenchOptions opt;
+
+	if(opt.parse(argc, argv) < 0){
+		std::cerr << "usage: " << argv[0] << " [--server <path>|none] [--port 18888] [--board digital|analog]"
+			" [--duration <s>] [--warmup <s>] [--period <us>] [--window <1-8>] [--io-thread <0|1>]"
+			" [--stream-rate <Hz>] [--di-rate <events/s>] [--burst <frames>] [--latency <ms>] [--output <file>]" << std::endl;
+		return 1;
+	}
+	AsyncLogger::setLevel(LOG_WARN);
+
+	pid_t server = startServer(opt);
+	if(server < 0){
+		return 1;
+	}
+
+	HotmockClient hmc;
+	hmc.setIOThreadMode(opt.io_thread);
+	hmc.setRequestWindow(opt.window);
+	if(hmc.initialize(opt.board, "127.0.0.1", opt.port) < 0){
+		return 1;
+	}
+
+	//wait for the server
+	unsigned long long deadline = monotonicNanoseconds() + 5000000000ULL;
+	while(!hmc.isConnected() && monotonicNanoseconds() < deadline){
+		hmc.recvDataFromHotmock();
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	if(!hmc.isConnected()){
+		std::cerr << "cannot connect to the server" << std::endl;
+		if(server > 0){
+			kill(server, SIGTERM);
+			waitpid(server, NULL, 0);
+		}
+		return 1;
+	}
+
+	HotmockBench bench(opt, hmc);
+	std::size_t expected_cycles = (std::size_t)(opt.duration_s * 1e6 / (opt.period_us > 0 ? opt.period_us : 1)) + 1;
+	bench.reserve(std::min(expected_cycles, (std::size_t)10000000));
+
+	unsigned long long period_ns = opt.period_us * 1000ULL;
+	unsigned long long start_ns = monotonicNanoseconds();
+	unsigned long long measure_ns = start_ns + (unsigned long long)(opt.warmup_s*1e9);
+	unsigned long long end_ns = measure_ns + (unsigned long long)(opt.duration_s*1e9);
+	unsigned long long next_ns = start_ns;
+	unsigned long long cycles = 0, cpu_begin = 0, alloc_begin = 0;
+	unsigned long reconnect_begin = 0;
+	bool measuring = false;
+
+	for(;;){
+		unsigned long long now_ns = monotonicNanoseconds();
+		if(!measuring && now_ns >= measure_ns){
+			measuring = true;
+			bench.setMeasuring(true);
+			measure_ns = now_ns;
+			cpu_begin = processCPUNanoseconds();
+			alloc_begin = allocation_count.load();
+			reconnect_begin = hmc.getReconnectCount();
+		}
+		if(now_ns >= end_ns){
+			break;
+		}
+
+		bench.run();
+		if(measuring){
+			cycles++;
+		}
+
+		if(period_ns > 0){
+			next_ns += period_ns;
+			now_ns = monotonicNanoseconds();
+			if(next_ns > now_ns){
+				std::this_thread::sleep_for(std::chrono::nanoseconds(next_ns - now_ns));
+			}else{
+				next_ns = now_ns; //overrun: do not try to catch up
+			}
+		}
+	}
+	unsigned long long elapsed_ns = monotonicNanoseconds() - measure_ns;
+	unsigned long long cpu_ns = processCPUNanoseconds() - cpu_begin;
+	unsigned long long allocations = allocation_count.load() - alloc_begin;
+	unsigned long reconnects = hmc.getReconnectCount() - reconnect_begin;
+
+	//statistics of the client
+	HotmockConnectorInformation info(opt.board);
+	unsigned long timeouts = 0, dropped = 0;
+	for(unsigned int i=0;i<info.AIConnectorNum;i++){
+		timeouts += hmc.getTimeoutCount(AI, info.AIFirstConnectorID + i);
+		dropped += hmc.getDroppedRequestCount(AI, info.AIFirstConnectorID + i);
+	}
+	for(unsigned int i=0;i<info.PIConnectorNum;i++){
+		timeouts += hmc.getTimeoutCount(PI, info.PIFirstConnectorID + i);
+		dropped += hmc.getDroppedRequestCount(PI, info.PIFirstConnectorID + i);
+	}
+	timeouts += hmc.getTimeoutCount(GS, info.GSFirstConnectorID) + hmc.getTimeoutCount(TS, info.TSFirstConnectorID);
+	dropped += hmc.getDroppedRequestCount(GS, info.GSFirstConnectorID) + hmc.getDroppedRequestCount(TS, info.TSFirstConnectorID);
+
+	hmc.finalize();
+	if(server > 0){
+		kill(server, SIGTERM);
+		waitpid(server, NULL, 0);
+	}
+
+	//JSON
+	std::ostringstream json;
+	double seconds = elapsed_ns * 1e-9;
+	std::vector<double> all_latency;
+	json << "{" << std::endl;
+	json << "  \"benchmark\": \"hotmock_bench\"," << std::endl;
+	json << "  \"config\": {\"board\": \"" << (opt.board == Analog ? "analog" : "digital") << "\", \"period_us\": " << opt.period_us
+		<< ", \"request_window\": " << opt.window << ", \"io_thread\": " << (opt.io_thread ? 1 : 0)
+		<< ", \"stream_rate\": " << opt.stream_rate << ", \"di_rate\": " << opt.di_rate << ", \"burst\": " << opt.burst
+		<< ", \"server_latency_ms\": " << opt.latency_ms << "}," << std::endl;
+	json << "  \"duration_s\": " << seconds << "," << std::endl;
+	json << "  \"cycles\": " << cycles << "," << std::endl;
+	json << "  \"samples_per_second\": {";
+	const char *separator = "";
+	for(int t=0;t<6;t++){
+		if(t == hotmock::DO){
+			continue;
+		}
+		json << separator << "\"" << type_name[t] << "\": " << bench.latency[t].samples / seconds;
+		separator = ", ";
+	}
+	json << "}," << std::endl;
+	json << "  \"latency_us\": {" << std::endl;
+	for(int t=AI;t<6;t++){
+		all_latency.insert(all_latency.end(), bench.latency[t].latency_us.begin(), bench.latency[t].latency_us.end());
+		json << "    \"" << type_name[t] << "\": ";
+		writeDistribution(json, bench.latency[t].latency_us);
+		json << "," << std::endl;
+	}
+	json << "    \"all\": ";
+	writeDistribution(json, all_latency);
+	json << std::endl << "  }," << std::endl;
+	json << "  \"cpu_us_per_cycle\": {\"cycle_thread\": ";
+	writeDistribution(json, bench.cycle_cpu_us);
+	json << ", \"process_mean\": " << (cycles > 0 ? cpu_ns * 1e-3 / cycles : 0) << "}," << std::endl;
+	json << "  \"allocations_per_cycle\": " << (cycles > 0 ? (double)allocations / cycles : 0) << "," << std::endl;
+	json << "  \"request_timeouts\": " << timeouts << "," << std::endl;
+	json << "  \"dropped_requests\": " << dropped << "," << std::endl;
+	json << "  \"reconnects\": " << reconnects << std::endl;
+	json << "}" << std::endl;
+
+	if(opt.output.empty()){
+		std::cout << json.str();
+	}else{
+		std::ofstream file(opt.output.c_str());
+		if(!file){
+			std::cerr << "cannot open " << opt.output << std::endl;
+			return 1;
+		}
+		file << json.str();
+	}
+	return 0;
+}
@@ -0,0 +1,679 @@
+// -*- C++ -*-
+/*!
+ * @file  hotmock_server.cpp
+ * @brief stand-in for HOTMOCK Setting: serves the hotmock text protocol on loopback with synthetic data
+ * @date $Date$
+ *
+ * Emulates the connector map of a Digital or Analog board (HotmockConnectorInformation) without
+ * HOTMOCK devices, so that HotmockClient and HOTMOCK_master can be tested and benchmarked on a plain
+ * Linux machine.
+ *
+ * - "REQUEST,<type><ID>,<param>&" (AI,PI,GS,TS) is answered by "<type><ID>,<value>&"
+ *   (param 0: raw value, 1: processed value), optionally after an injected latency
+ * - "OUTPUT,DO<ID>,<0|1>&" sets the digital output, "INIT,PI<ID>,<param>&" resets the pulse count
+ * - DI edges ("DI<ID>,1&" press / "DI<ID>,2&" release) are generated at --di-rate
+ * - AI/PI/GS/TS frames are pushed without request at --stream-rate (load generator)
+ * - with --timestamp, every AI/PI/GS/TS value is the monotonic send time [ns] (hotmock::monotonicNanoseconds())
+ *   so that a client on the same machine can measure the latency (used by hotmock_bench)
+ *
+ * Usage: hotmock_server [--port 8888] [--board digital|analog] [--di-rate <events/s>]
+ *        [--stream-rate <Hz>] [--burst <frames>] [--latency <ms>] [--jitter <ms>]
+ *        [--duration <s>] [--seed <n>] [--timestamp] [--verbose]
+ *
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "hotmockclient.h"
+
+namespace hotmock{
+
+	/*!
+	 * @class HotmockServerOptions
+	 * @brief Command line options of the stand-in server
+	 */
+	class HotmockServerOptions{
+	public:
+		std::string bind_ip; /*!< Address to listen on */
+		int port; /*!< Port to listen on */
+		HotmockBoardType board; /*!< Emulated board */
+		double di_rate; /*!< DI edges per second (0: none) */
+		double stream_rate; /*!< Unsolicited AI/PI/GS/TS rounds per second (0: none) */
+		unsigned int burst; /*!< Frames per connector and round (DI: edges per event) */
+		double latency_ms; /*!< Delay before a REQUEST is answered [ms] */
+		double jitter_ms; /*!< Random delay added to latency_ms [ms] (0 to jitter_ms) */
+		double duration_s; /*!< Run time [s] (0: until SIGINT) */
+		unsigned int seed; /*!< Seed of the random delay */
+		bool timestamp; /*!< Send the send time instead of synthetic values */
+		bool verbose; /*!< Print every command */
+
+		HotmockServerOptions() : bind_ip("127.0.0.1"), port(8888), board(Digital), di_rate(0), stream_rate(0),
+			burst(1), latency_ms(0), jitter_ms(0), duration_s(0), seed(1), timestamp(false), verbose(false) {}
+
+		int parse(int argc, char **argv);
+	};
+
+	/*!
+	 * @class HotmockServerStatus
+	 * @brief Statistics of the stand-in server
+	 */
+	class HotmockServerStatus{
+	public:
+		unsigned long long commands; /*!< # of commands received */
+		unsigned long long requests; /*!< # of REQUEST commands received */
+		unsigned long long invalid; /*!< # of invalid commands */
+		unsigned long long responses; /*!< # of frames answering REQUEST */
+		unsigned long long di_edges; /*!< # of DI frames */
+		unsigned long long stream_frames; /*!< # of unsolicited AI/PI/GS/TS frames */
+		unsigned long long bytes_sent; /*!< # of bytes sent */
+		unsigned long long bytes_received; /*!< # of bytes received */
+		unsigned long long connections; /*!< # of accepted connections */
+	};
+
+	/*!
+	 * @class HotmockStandInServer
+	 * @brief Single-client server speaking the hotmock text protocol
+	 */
+	class HotmockStandInServer{
+	private:
+		static const std::string::size_type max_send_buffer = 1 << 20; //generators pause while the client lags behind
+
+		HotmockServerOptions opt;
+		HotmockConnectorInformation info;
+		HotmockServerStatus status;
+
+		int listen_sock;
+		int client_sock;
+		std::string recv_buffer; //incomplete command carried over to the next recv()
+		std::string send_buffer; //frames not sent yet
+		std::multimap<unsigned long long, HotmockSample> delayed; //responses waiting for injected latency (value[0]: param)
+
+		unsigned long long start_ns;
+		unsigned long long next_di_ns;
+		unsigned long long next_stream_ns;
+		unsigned int next_di; //index of the DI connector of the next edge
+		std::vector<bool> di_pressed;
+		std::vector<int> do_state;
+		std::vector<double> pi_offset; //pulse count at the last INIT
+		unsigned int random_state;
+
+		HotmockStandInServer(const HotmockStandInServer &);
+		HotmockStandInServer &operator=(const HotmockStandInServer &);
+
+		double elapsed(unsigned long long now_ns) const {return (now_ns - start_ns) * 1e-9;}
+		unsigned int random();
+		bool getConnectorRange(HotmockConnectorType type, unsigned short &first, unsigned int &num) const;
+		void appendValue(std::string &frame, HotmockConnectorType type, unsigned int id, int param, unsigned long long now_ns) const;
+		void appendFrame(std::string &out, HotmockConnectorType type, unsigned int id, int param, unsigned long long now_ns) const;
+		void handleCommand(const char *begin, const char *end, unsigned long long now_ns);
+		void generate(unsigned long long now_ns);
+		int receive(unsigned long long now_ns);
+		int flush();
+		void closeClient();
+
+	public:
+		HotmockStandInServer(const HotmockServerOptions &options);
+		~HotmockStandInServer();
+
+		int open();
+		int run(volatile std::sig_atomic_t &stop);
+		void printStatus(std::ostream &os) const;
+	};
+
+	/*!
+	 * @brief Parse command line
+	 * @param argc # of arguments
+	 * @param argv arguments
+	 * @return 0 if no error, -1 if invalid option
+	 */
+	int HotmockServerOptions::parse(int argc, char **argv){
+		for(int i=1;i<argc;i++){
+			std::string name = argv[i];
+			if(name == "--verbose"){
+				verbose = true;
+				continue;
+			}else if(name == "--timestamp"){
+				timestamp = true;
+				continue;
+			}
+			if(i+1 >= argc){
+				std::cerr << "missing value of " << name << std::endl;
+				return -1;
+			}
+			const char *value = argv[++i];
+			if(name == "--bind"){
+				bind_ip = value;
+			}else if(name == "--port"){
+				port = std::atoi(value);
+			}else if(name == "--board"){
+				if(std::strcmp(value, "digital") == 0){
+					board = Digital;
+				}else if(std::strcmp(value, "analog") == 0){
+					board = Analog;
+				}else{
+					std::cerr << "unknown board: " << value << std::endl;
+					return -1;
+				}
+			}else if(name == "--di-rate"){
+				di_rate = std::atof(value);
+			}else if(name == "--stream-rate"){
+				stream_rate = std::atof(value);
+			}else if(name == "--burst"){
+				burst = (unsigned int)std::atoi(value);
+			}else if(name == "--latency"){
+				latency_ms = std::atof(value);
+			}else if(name == "--jitter"){
+				jitter_ms = std::atof(value);
+			}else if(name == "--duration"){
+				duration_s = std::atof(value);
+			}else if(name == "--seed"){
+				seed = (unsigned int)std::strtoul(value, NULL, 10);
+			}else{
+				std::cerr << "unknown option: " << name << std::endl;
+				return -1;
+			}
+		}
+		if(port <= 0 || port > 65535 || di_rate < 0 || stream_rate < 0 || burst < 1 || latency_ms < 0 || jitter_ms < 0 || duration_s < 0){
+			std::cerr << "invalid option value" << std::endl;
+			return -1;
+		}
+		return 0;
+	}
+
+	/*!
+	 * @brief Constuctor
+	 * @param options Command line options
+	 */
+	HotmockStandInServer::HotmockStandInServer(const HotmockServerOptions &options) : opt(options), info(options.board){
+		std::memset(&status, 0, sizeof(status));
+		listen_sock = -1;
+		client_sock = -1;
+		start_ns = monotonicNanoseconds();
+		next_di_ns = start_ns;
+		next_stream_ns = start_ns;
+		next_di = 0;
+		di_pressed.assign(info.DIConnectorNum, false);
+		do_state.assign(info.DOConnectorNum, DO_OFF);
+		pi_offset.assign(info.PIConnectorNum, 0.0);
+		random_state = opt.seed ? opt.seed : 1;
+	}
+
+	/*!
+	 * @brief Destructor
+	 */
+	HotmockStandInServer::~HotmockStandInServer(){
+		closeClient();
+		if(listen_sock != -1){
+			::close(listen_sock);
+		}
+	}
+
+	/*!
+	 * @brief Pseudo random number (xorshift)
+	 * @return random number
+	 */
+	unsigned int HotmockStandInServer::random(){
+		random_state ^= random_state << 13;
+		random_state ^= random_state >> 17;
+		random_state ^= random_state << 5;
+		return random_state;
+	}
+
+	/*!
+	 * @brief Get connector range of the emulated board
+	 * @param type Connector type
+	 * @param first first connector ID
+	 * @param num # of connectors
+	 * @return true if the type exists on the board
+	 */
+	bool HotmockStandInServer::getConnectorRange(HotmockConnectorType type, unsigned short &first, unsigned int &num) const{
+		switch(type){
+			case DI:
+				first = info.DIFirstConnectorID;
+				num = info.DIConnectorNum;
+				break;
+			case DO:
+				first = info.DOFirstConnectorID;
+				num = info.DOConnectorNum;
+				break;
+			case AI:
+				first = info.AIFirstConnectorID;
+				num = info.AIConnectorNum;
+				break;
+			case PI:
+				first = info.PIFirstConnectorID;
+				num = info.PIConnectorNum;
+				break;
+			case GS:
+				first = info.GSFirstConnectorID;
+				num = info.GSConnectorNum;
+				break;
+			case TS:
+				first = info.TSFirstConnectorID;
+				num = info.TSConnectorNum;
+				break;
+			default:
+				return false;
+		}
+		return num > 0;
+	}
+
+	/*!
+	 * @brief Append synthetic value of a connector. The values are smooth functions of time so that
+	 * consecutive samples can be checked by the client
+	 * @param frame Destination
+	 * @param type Connector type (AI, PI, GS or TS)
+	 * @param id Connector ID
+	 * @param param REQUEST_RAW or REQUEST_PROCESSED
+	 * @param now_ns current time [ns]
+	 */
+	void HotmockStandInServer::appendValue(std::string &frame, HotmockConnectorType type, unsigned int id, int param, unsigned long long now_ns) const{
+		static const double pi = 3.14159265358979323846;
+		double t = elapsed(now_ns);
+		char value[96];
+
+		if(opt.timestamp && type != DI){
+			std::snprintf(value, sizeof(value), (type == GS) ? "%llu,%llu,%llu" : "%llu", now_ns, now_ns, now_ns);
+			frame.append(value);
+			return;
+		}
+
+		switch(type){
+			case AI:{ //10 bit ADC, 0-5V
+				double raw = std::floor(511.5 + 511.5*std::sin(2*pi*0.5*t + id));
+				if(param == REQUEST_PROCESSED){
+					std::snprintf(value, sizeof(value), "%.4f", raw*5.0/1023.0);
+				}else{
+					std::snprintf(value, sizeof(value), "%.0f", raw);
+				}
+				break;
+			}
+			case PI:{ //10 pulses/s per connector since the last INIT
+				unsigned short first;
+				unsigned int num;
+				getConnectorRange(PI, first, num);
+				double count = std::floor(10.0*t) - pi_offset[id - first];
+				std::snprintf(value, sizeof(value), "%.0f", count < 0 ? 0 : count);
+				break;
+			}
+			case GS:{ //acceleration [G] on a slowly tilting board
+				double g[3] = {0.1*std::sin(2*pi*0.2*t), 0.1*std::cos(2*pi*0.2*t), 1.0};
+				if(param == REQUEST_PROCESSED){
+					std::snprintf(value, sizeof(value), "%.4f,%.4f,%.4f", g[0], g[1], g[2]);
+				}else{
+					std::snprintf(value, sizeof(value), "%.0f,%.0f,%.0f", 512+g[0]*256, 512+g[1]*256, 512+g[2]*256);
+				}
+				break;
+			}
+			case TS:{ //temperature [degC]
+				double temp = 25.0 + 0.5*std::sin(2*pi*0.01*t);
+				if(param == REQUEST_PROCESSED){
+					std::snprintf(value, sizeof(value), "%.2f", temp);
+				}else{
+					std::snprintf(value, sizeof(value), "%.0f", temp*10.0 + 500.0);
+				}
+				break;
+			}
+			default:
+				value[0] = '0';
+				value[1] = '\0';
+				break;
+		}
+		frame.append(value);
+	}
+
+	/*!
+	 * @brief Append frame "<type><2 digit ID>,<value>&"
+	 * @param out Destination
+	 * @param type Connector type (AI, PI, GS or TS)
+	 * @param id Connector ID
+	 * @param param REQUEST_RAW or REQUEST_PROCESSED
+	 * @param now_ns current time [ns]
+	 */
+	void HotmockStandInServer::appendFrame(std::string &out, HotmockConnectorType type, unsigned int id, int param, unsigned long long now_ns) const{
+		static const char *type_str[] = {"DI", "DO", "AI", "PI", "GS", "TS"};
+		out.append(type_str[type]);
+		out.push_back((char)('0' + (id/10)%10));
+		out.push_back((char)('0' + id%10));
+		out.push_back(',');
+		appendValue(out, type, id, param, now_ns);
+		out.push_back('&');
+	}
+
+	/*!
+	 * @brief Execute one command "<command>,<type><ID>,<param>" (without the delimiter '&')
+	 * @param begin Beginning of the command
+	 * @param end End of the command
+	 * @param now_ns current time [ns]
+	 */
+	void HotmockStandInServer::handleCommand(const char *begin, const char *end, unsigned long long now_ns){
+		std::string command(begin, end);
+		char cmd[16];
+		char type_str[3];
+		unsigned int id;
+		int param;
+		int consumed = 0;
+		HotmockConnectorType type;
+		unsigned short first;
+		unsigned int num;
+
+		status.commands++;
+		if(opt.verbose){
+			std::cout << "received: " << command << '&' << std::endl;
+		}
+
+		if(std::sscanf(command.c_str(), "%15[A-Z],%2[A-Z]%u,%d%n", cmd, type_str, &id, &param, &consumed) != 4 || consumed != (int)command.size()){
+			std::cerr << "invalid command: " << command << std::endl;
+			status.invalid++;
+			return;
+		}
+		if(std::strcmp(type_str, "DO") == 0){
+			type = DO;
+		}else if(std::strcmp(type_str, "AI") == 0){
+			type = AI;
+		}else if(std::strcmp(type_str, "PI") == 0){
+			type = PI;
+		}else if(std::strcmp(type_str, "GS") == 0){
+			type = GS;
+		}else if(std::strcmp(type_str, "TS") == 0){
+			type = TS;
+		}else{
+			type = DI; //DI does not accept commands
+		}
+		if(type == DI || !getConnectorRange(type, first, num) || id < first || id >= first + num){
+			std::cerr << "connector not on the board: " << command << std::endl;
+			status.invalid++;
+			return;
+		}
+
+		if(std::strcmp(cmd, "REQUEST") == 0 && type != DO){
+			status.requests++;
+			if(opt.latency_ms <= 0 && opt.jitter_ms <= 0){
+				appendFrame(send_buffer, type, id, param, now_ns);
+				status.responses++;
+			}else{
+				//the value is sampled when the response is sent
+				HotmockSample request;
+				double delay_ms = opt.latency_ms + (opt.jitter_ms > 0 ? opt.jitter_ms * (random() % 10001) / 10000.0 : 0);
+				request.type = type;
+				request.connectorID = (unsigned short)id;
+				request.value[0] = param;
+				delayed.insert(std::make_pair(now_ns + (unsigned long long)(delay_ms*1e6), request));
+			}
+		}else if(std::strcmp(cmd, "OUTPUT") == 0 && type == DO){
+			do_state[id - first] = param;
+		}else if(std::strcmp(cmd, "INIT") == 0 && type == PI){
+			pi_offset[id - first] = std::floor(10.0*elapsed(now_ns));
+		}else{
+			std::cerr << "invalid combination of command and connector: " << command << std::endl;
+			status.invalid++;
+		}
+	}
+
+	/*!
+	 * @brief Move responses whose latency has passed, DI edges and stream frames to the send buffer
+	 * @param now_ns current time [ns]
+	 */
+	void HotmockStandInServer::generate(unsigned long long now_ns){
+		while(!delayed.empty() && delayed.begin()->first <= now_ns){
+			const HotmockSample &request = delayed.begin()->second;
+			appendFrame(send_buffer, request.type, request.connectorID, (int)request.value[0], now_ns);
+			delayed.erase(delayed.begin());
+			status.responses++;
+		}
+
+		if(send_buffer.size() >= max_send_buffer){
+			return;
+		}
+
+		//DI: each event toggles the next switch (press, release, press...) burst times
+		if(opt.di_rate > 0 && info.DIConnectorNum > 0){
+			unsigned long long period_ns = (unsigned long long)(1e9 / opt.di_rate);
+			for(int rounds=0;next_di_ns <= now_ns && rounds < 1000;rounds++){
+				for(unsigned int b=0;b<opt.burst;b++){
+					unsigned int id = info.DIFirstConnectorID + next_di;
+					di_pressed[next_di] = !di_pressed[next_di];
+					send_buffer.append("DI");
+					send_buffer.push_back((char)('0' + (id/10)%10));
+					send_buffer.push_back((char)('0' + id%10));
+					send_buffer.append(di_pressed[next_di] ? ",1&" : ",2&");
+					next_di = (next_di + 1) % info.DIConnectorNum;
+					status.di_edges++;
+				}
+				next_di_ns += (period_ns > 0) ? period_ns : 1;
+			}
+			if(next_di_ns <= now_ns){ //too slow to catch up: skip
+				next_di_ns = now_ns;
+			}
+		}
+
+		//AI/PI/GS/TS: every connector burst times per round
+		if(opt.stream_rate > 0 && next_stream_ns <= now_ns){
+			static const HotmockConnectorType stream_types[] = {AI, PI, GS, TS};
+			for(unsigned int b=0;b<opt.burst;b++){
+				for(int t=0;t<4;t++){
+					unsigned short first;
+					unsigned int num;
+					if(!getConnectorRange(stream_types[t], first, num)){
+						continue;
+					}
+					for(unsigned int i=0;i<num;i++){
+						appendFrame(send_buffer, stream_types[t], first + i, REQUEST_RAW, now_ns);
+						status.stream_frames++;
+					}
+				}
+			}
+			next_stream_ns += (unsigned long long)(1e9 / opt.stream_rate);
+			if(next_stream_ns <= now_ns){
+				next_stream_ns = now_ns + 1;
+			}
+		}
+	}
+
+	/*!
+	 * @brief Start listening
+	 * @return 0 if no error, -1 if error
+	 */
+	int HotmockStandInServer::open(){
+		struct sockaddr_in addr;
+		int yes = 1;
+
+		listen_sock = socket(AF_INET, SOCK_STREAM, 0);
+		if(listen_sock == -1){
+			std::cerr << "error in socket: " << std::strerror(errno) << std::endl;
+			return -1;
+		}
+		setsockopt(listen_sock, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(opt.port);
+		if(inet_pton(AF_INET, opt.bind_ip.c_str(), &addr.sin_addr) != 1){
+			std::cerr << "error in address: " << opt.bind_ip << std::endl;
+			return -1;
+		}
+		if(bind(listen_sock, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(listen_sock, 1) == -1){
+			std::cerr << "error in bind/listen: " << std::strerror(errno) << std::endl;
+			return -1;
+		}
+		std::cerr << "hotmock_server: " << (opt.board == Analog ? "analog" : "digital") << " board on "
+			<< opt.bind_ip << ":" << opt.port << std::endl;
+		return 0;
+	}
+
+	/*!
+	 * @brief Close the client connection and discard its state
+	 */
+	void HotmockStandInServer::closeClient(){
+		if(client_sock != -1){
+			::close(client_sock);
+			client_sock = -1;
+		}
+		recv_buffer.clear();
+		send_buffer.clear();
+		delayed.clear();
+	}
+
+	/*!
+	 * @brief Receive and execute commands
+	 * @param now_ns current time [ns]
+	 * @return 0 if no error, -1 if connection closed
+	 */
+	int HotmockStandInServer::receive(unsigned long long now_ns){
+		char buf[4096];
+		ssize_t res = ::recv(client_sock, buf, sizeof(buf), MSG_DONTWAIT);
+
+		if(res == 0 || (res == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)){
+			return -1;
+		}
+		if(res < 0){
+			return 0;
+		}
+		status.bytes_received += res;
+
+		recv_buffer.append(buf, res);
+		std::string::size_type begin = 0, end;
+		while((end = recv_buffer.find('&', begin)) != std::string::npos){
+			handleCommand(recv_buffer.data() + begin, recv_buffer.data() + end, now_ns);
+			begin = end + 1;
+		}
+		recv_buffer.erase(0, begin);
+		return 0;
+	}
+
+	/*!
+	 * @brief Send as much of the send buffer as the socket accepts
+	 * @return 0 if no error, -1 if connection closed
+	 */
+	int HotmockStandInServer::flush(){
+		while(!send_buffer.empty()){
+			ssize_t res = ::send(client_sock, send_buffer.data(), send_buffer.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+			if(res == -1){
+				if(errno == EINTR){
+					continue;
+				}
+				return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+			}
+			status.bytes_sent += res;
+			send_buffer.erase(0, res);
+		}
+		return 0;
+	}
+
+	/*!
+	 * @brief Serve clients one at a time until stop is set or the duration has passed
+	 * @param stop set by the signal handler
+	 * @return 0
+	 */
+	int HotmockStandInServer::run(volatile std::sig_atomic_t &stop){
+		unsigned long long end_ns = (opt.duration_s > 0) ? start_ns + (unsigned long long)(opt.duration_s*1e9) : 0;
+
+		while(!stop){
+			unsigned long long now_ns = monotonicNanoseconds();
+			if(end_ns != 0 && now_ns >= end_ns){
+				break;
+			}
+
+			//wait for the next connection, command, writable socket or generator tick (at most 1 ms)
+			struct pollfd pfd;
+			pfd.fd = (client_sock != -1) ? client_sock : listen_sock;
+			pfd.events = POLLIN;
+			if(client_sock != -1 && !send_buffer.empty()){
+				pfd.events |= POLLOUT;
+			}
+			pfd.revents = 0;
+			if(poll(&pfd, 1, 1) == -1 && errno != EINTR){
+				std::cerr << "error in poll: " << std::strerror(errno) << std::endl;
+				break;
+			}
+			now_ns = monotonicNanoseconds();
+
+			if(client_sock == -1){
+				if(pfd.revents & POLLIN){
+					client_sock = accept(listen_sock, NULL, NULL);
+					if(client_sock != -1){
+						int yes = 1;
+						setsockopt(client_sock, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+						status.connections++;
+						next_di_ns = now_ns;
+						next_stream_ns = now_ns;
+						std::cerr << "hotmock_server: client connected" << std::endl;
+					}
+				}
+				continue;
+			}
+
+			int res = 0;
+			if(pfd.revents & (POLLIN | POLLHUP | POLLERR)){
+				res = receive(now_ns);
+			}
+			if(res == 0){
+				generate(now_ns);
+				res = flush();
+			}
+			if(res < 0){
+				std::cerr << "hotmock_server: client disconnected" << std::endl;
+				closeClient();
+			}
+		}
+		return 0;
+	}
+
+	/*!
+	 * @brief Print statistics
+	 * @param os Destination
+	 */
+	void HotmockStandInServer::printStatus(std::ostream &os) const{
+		os << "connections: " << status.connections << std::endl
+			<< "commands: " << status.commands << " (requests: " << status.requests << ", invalid: " << status.invalid << ")" << std::endl
+			<< "responses: " << status.responses << std::endl
+			<< "DI edges: " << status.di_edges << std::endl
+			<< "stream frames: " << status.stream_frames << std::endl
+			<< "bytes received: " << status.bytes_received << ", sent: " << status.bytes_sent << std::endl;
+	}
+
+};
+
+static volatile std::sig_atomic_t stop_requested = 0;
+
+static void onSignal(int){
+	stop_requested = 1;
+}
+
+int main(int argc, char **argv){
+	hotmock::HotmockServerOptions options;
+
+	if(options.parse(argc, argv) < 0){
+		std::cerr << "usage: " << argv[0] << " [--bind 127.0.0.1] [--port 8888] [--board digital|analog]"
+			" [--di-rate <events/s>] [--stream-rate <Hz>] [--burst <frames>] [--latency <ms>] [--jitter <ms>]"
+			" [--duration <s>] [--seed <n>] [--timestamp] [--verbose]" << std::endl;
+		return 1;
+	}
+	std::signal(SIGINT, onSignal);
+	std::signal(SIGTERM, onSignal);
+
+	hotmock::HotmockStandInServer server(options);
+	if(server.open() < 0){
+		return 1;
+	}
+	server.run(stop_requested);
+	server.printStatus(std::cerr);
+	return 0;
+}
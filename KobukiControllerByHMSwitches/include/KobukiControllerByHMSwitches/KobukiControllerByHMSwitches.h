@@ -21,6 +21,7 @@
 #include <rtm/idl/BasicDataTypeSkel.h>
 #include <rtm/idl/ExtendedDataTypesSkel.h>
 #include <rtm/idl/InterfaceDataTypesSkel.h>
+#include "hotmock/hotmocklog.h"
 
 // Service implementation headers
 // <rtc-template block="service_impl_h">
@@ -55,6 +56,8 @@ using namespace RTC;
  * Speed/double/0.2/text/Kobukiが前進・後退する時の速度。x>=0
  * RotSpeed/double/0.5/text/x>=0/Kobukiが右回転・左回転する時の速度
  * 。
+ * LogLevel/std::string/INFO/radio/ログの出力レベル。DEBUGならば押さ
+ * れたスイッチを出力する。
  *
  */
 class KobukiControllerByHMSwitches
@@ -261,6 +264,14 @@ class KobukiControllerByHMSwitches
    * - Constraint: x>=0
    */
   double m_RotSpeed;
+  /*!
+   * ログの出力レベル。
+   * DEBUGならば押されたスイッチを出力する。
+   * - Name: LogLevel LogLevel
+   * - DefaultValue: INFO
+   * - Constraint: (OFF,ERROR,WARN,INFO,DEBUG)
+   */
+  std::string m_LogLevel;
 
   // </rtc-template>
 
@@ -30,12 +30,15 @@ static const char* kobukicontrollerbyhmswitches_spec[] =
     // Configuration variables
     "conf.default.Speed", "0.2",
     "conf.default.RotSpeed", "0.5",
+    "conf.default.LogLevel", "INFO",
     // Widget
     "conf.__widget__.Speed", "text",
     "conf.__widget__.RotSpeed", "text",
+    "conf.__widget__.LogLevel", "radio",
     // Constraints
     "conf.__constraints__.Speed", "x>=0",
     "conf.__constraints__.RotSpeed", "x>=0",
+    "conf.__constraints__.LogLevel", "(OFF,ERROR,WARN,INFO,DEBUG)",
     ""
   };
 // </rtc-template>
@@ -91,6 +94,7 @@ RTC::ReturnCode_t KobukiControllerByHMSwitches::onInitialize()
   // Bind variables and configuration variable
   bindParameter("Speed", m_Speed, "0.2");
   bindParameter("RotSpeed", m_RotSpeed, "0.5");
+  bindParameter("LogLevel", m_LogLevel, "INFO");
   // </rtc-template>
   
   return RTC::RTC_OK;
@@ -123,6 +127,9 @@ RTC::ReturnCode_t KobukiControllerByHMSwitches::onShutdown(RTC::UniqueId ec_id)
 
 RTC::ReturnCode_t KobukiControllerByHMSwitches::onActivated(RTC::UniqueId ec_id)
 {
+  // ログの出力レベルを設定する
+  hotmock::AsyncLogger::setLevel(hotmock::logLevelFromString(m_LogLevel));
+
   command.vx=0;
   command.vy=0;
   command.va=0;
@@ -161,7 +168,7 @@ RTC::ReturnCode_t KobukiControllerByHMSwitches::onExecute(RTC::UniqueId ec_id)
 		command.vx = 0;
 		output = true;
 	}
-	std::cout<<"forward"<<std::endl;
+	HMLOG_DEBUG("forward");
   }
   if(m_BackIn.isNew()){  //後退指令がきたら
 	m_BackIn.read();
@@ -172,7 +179,7 @@ RTC::ReturnCode_t KobukiControllerByHMSwitches::onExecute(RTC::UniqueId ec_id)
 		command.vx = 0;
 		output = true;
 	}
-	std::cout<<"back"<<std::endl;
+	HMLOG_DEBUG("back");
   }
   if(m_RightIn.isNew()){  //右回転指令がきたら
 	m_RightIn.read();
@@ -183,7 +190,7 @@ RTC::ReturnCode_t KobukiControllerByHMSwitches::onExecute(RTC::UniqueId ec_id)
 		command.va = 0;
 		output = true;
 	}
-	std::cout<<"right"<<std::endl;
+	HMLOG_DEBUG("right");
   }
   if(m_LeftIn.isNew()){  //左回転指令がきたら
 	m_LeftIn.read();
@@ -194,7 +201,7 @@ RTC::ReturnCode_t KobukiControllerByHMSwitches::onExecute(RTC::UniqueId ec_id)
 		command.va = 0;
 		output = true;
 	}
-	std::cout<<"left"<<std::endl;
+	HMLOG_DEBUG("left");
   }
 
   if(output){
@@ -22,6 +22,7 @@
 #include <rtm/idl/ExtendedDataTypesSkel.h>
 #include <rtm/idl/InterfaceDataTypesSkel.h>
 #include "VectorConvert.h"
+#include "hotmock/hotmocklog.h"
 
 // Service implementation headers
 // <rtc-template block="service_impl_h">
@@ -59,6 +60,8 @@ using namespace RTC;
  * nPort：ShortInDataが閾値として用いられる。
  * OutDataValue/std::vector<short>/0,0,1/出力する値。値は要素数0か
  * ら順に閾値より小さい、閾値と等しい、閾値より大きいとなる。
+ * LogLevel/std::string/INFO/radio/ログの出力レベル。DEBUGならば入
+ * 力された値と出力した値を出力する。
  *
  */
 class Thresholding
@@ -274,6 +277,14 @@ class Thresholding
    * - DefaultValue: 0,0,1
    */
   std::vector<short> m_OutDataValue;
+  /*!
+   * ログの出力レベル。
+   * DEBUGならば入力された値と出力した値を出力する。
+   * - Name: LogLevel LogLevel
+   * - DefaultValue: INFO
+   * - Constraint: (OFF,ERROR,WARN,INFO,DEBUG)
+   */
+  std::string m_LogLevel;
 
   // </rtc-template>
 
@@ -31,12 +31,15 @@ static const char* thresholding_spec[] =
     "conf.default.Threshold", "50.0",
     "conf.default.Threshold_Mode", "0",
     "conf.default.OutDataValue", "0,0,1",
+    "conf.default.LogLevel", "INFO",
     // Widget
     "conf.__widget__.Threshold", "text",
     "conf.__widget__.Threshold_Mode", "radio",
     "conf.__widget__.OutDataValue", "text",
+    "conf.__widget__.LogLevel", "radio",
     // Constraints
     "conf.__constraints__.Threshold_Mode", "(0,1,2)",
+    "conf.__constraints__.LogLevel", "(OFF,ERROR,WARN,INFO,DEBUG)",
     ""
   };
 // </rtc-template>
@@ -93,6 +96,7 @@ RTC::ReturnCode_t Thresholding::onInitialize()
   bindParameter("Threshold", m_Threshold, "50.0");
   bindParameter("Threshold_Mode", m_Threshold_Mode, "0");
   bindParameter("OutDataValue", m_OutDataValue, "0,0,1");
+  bindParameter("LogLevel", m_LogLevel, "INFO");
   // </rtc-template>
   
   return RTC::RTC_OK;
@@ -125,6 +129,9 @@ RTC::ReturnCode_t Thresholding::onShutdown(RTC::UniqueId ec_id)
 
 RTC::ReturnCode_t Thresholding::onActivated(RTC::UniqueId ec_id)
 {
+  // ログの出力レベルを設定する
+  hotmock::AsyncLogger::setLevel(hotmock::logLevelFromString(m_LogLevel));
+
   while(m_DoubleInDataIn.isNew()) m_DoubleInDataIn.read();
   while(m_ShortInDataIn.isNew()) m_ShortInDataIn.read();
   while(m_DoubleThresholdIn.isNew()) m_DoubleThresholdIn.read();
@@ -163,35 +170,35 @@ RTC::ReturnCode_t Thresholding::onExecute(RTC::UniqueId ec_id)
   if(m_DoubleInDataIn.isNew()){
 	m_DoubleInDataIn.read();
 	if(m_DoubleInData.data<threshold){ //閾値より小さい場合
-		std::cout<<"InPut Data:"<<m_DoubleInData.data<<"< threshold:"<<threshold<<std::endl;
+		HMLOG_DEBUG("InPut Data:{}< threshold:{}", m_DoubleInData.data, threshold);
 		m_OutData.data=m_OutDataValue[0];
 	}
 	else if(m_DoubleInData.data==threshold){ //閾値と等しい場合
-		std::cout<<"InPut Data:"<<m_DoubleInData.data<<"= threshold:"<<threshold<<std::endl;
+		HMLOG_DEBUG("InPut Data:{}= threshold:{}", m_DoubleInData.data, threshold);
 		m_OutData.data=m_OutDataValue[1];
 	}
 	else if(m_DoubleInData.data>threshold){ //閾値より大きい場合
-		std::cout<<"InPut Data:"<<m_DoubleInData.data<<"> threshold:"<<threshold<<std::endl;
+		HMLOG_DEBUG("InPut Data:{}> threshold:{}", m_DoubleInData.data, threshold);
 		m_OutData.data=m_OutDataValue[2];
 	}
-	std::cout<<"OutData :"<<m_OutData.data<<std::endl<<std::endl;
+	HMLOG_DEBUG("OutData :{}", m_OutData.data);
 	m_OutDataOut.write();
   }
   if(m_ShortInDataIn.isNew()){
 	m_ShortInDataIn.read();
 	if(m_ShortInData.data<threshold){ //閾値より小さい場合
-		std::cout<<"InPut Data:"<<m_ShortInData.data<<"< threshold:"<<threshold<<std::endl;
+		HMLOG_DEBUG("InPut Data:{}< threshold:{}", m_ShortInData.data, threshold);
 		m_OutData.data=m_OutDataValue[0];
 	}
 	else if(m_ShortInData.data==threshold){ //閾値と等しい場合
-		std::cout<<"InPut Data:"<<m_ShortInData.data<<"= threshold:"<<threshold<<std::endl;
+		HMLOG_DEBUG("InPut Data:{}= threshold:{}", m_ShortInData.data, threshold);
 		m_OutData.data=m_OutDataValue[1];
 	}
 	else if(m_ShortInData.data>threshold){ //閾値より大きい場合
-		std::cout<<"InPut Data:"<<m_ShortInData.data<<"> threshold:"<<threshold<<std::endl;
+		HMLOG_DEBUG("InPut Data:{}> threshold:{}", m_ShortInData.data, threshold);
 		m_OutData.data=m_OutDataValue[0];
 	}
-		std::cout<<"OutData :"<<m_OutData.data<<std::endl<<std::endl;;
+		HMLOG_DEBUG("OutData :{}", m_OutData.data);
 		m_OutDataOut.write();
   }
   return RTC::RTC_OK;
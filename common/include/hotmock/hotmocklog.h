@@ -0,0 +1,465 @@
+// -*- C++ -*-
+/*!
+ * @file  hotmocklog.h
+ * @brief asynchronous logger: records are captured into a lock-free ring and written by a background thread
+ * @date $Date$
+ *
+ * Usage:
+ *   hotmock::AsyncLogger::setLevel(hotmock::logLevelFromString("INFO"));
+ *   HMLOG_DEBUG("AI Port{} : {}", id, value);
+ *
+ * The format string must be a string literal ("{}" is replaced by the arguments in order).
+ * When the level is disabled, HMLOG_* costs one relaxed load and a branch. Otherwise the arguments
+ * are copied into a fixed-size record (no allocation) and formatted by the drain thread.
+ * The drain thread sleeps while the ring is empty; the writer that fills an empty ring wakes it.
+ *
+ */
+#ifndef HOTMOCKLOG_H
+#define HOTMOCKLOG_H
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <iostream>
+
+namespace hotmock{
+
+	/*!
+	 * @enum LogLevel
+	 * @brief Log level (messages with a level larger than the current level are discarded)
+	 */
+	enum LogLevel{
+		LOG_OFF, /*!< No log */
+		LOG_ERROR, /*!< Errors */
+		LOG_WARN, /*!< Warnings (ex. disconnection) */
+		LOG_INFO, /*!< Events (ex. connection established) */
+		LOG_DEBUG /*!< Every command and data */
+	};
+
+	/*!
+	 * @brief Convert level name used in the configuration to LogLevel
+	 * @param name OFF, ERROR, WARN, INFO or DEBUG
+	 * @return log level (LOG_INFO if unknown name)
+	 */
+	inline LogLevel logLevelFromString(const std::string &name){
+		if(name == "OFF"){
+			return LOG_OFF;
+		}else if(name == "ERROR"){
+			return LOG_ERROR;
+		}else if(name == "WARN"){
+			return LOG_WARN;
+		}else if(name == "DEBUG"){
+			return LOG_DEBUG;
+		}
+		return LOG_INFO;
+	}
+
+	/*!
+	 * @class LogBytes
+	 * @brief Log argument for a byte sequence which is not terminated by '\0' (ex. received message)
+	 */
+	class LogBytes{
+	public:
+		const char *data; /*!< First byte */
+		std::size_t len; /*!< # of bytes */
+
+		LogBytes(const char *d, std::size_t l) : data(d), len(l) {}
+	};
+
+	/*!
+	 * @class LogRecord
+	 * @brief One log message before formatting
+	 */
+	class LogRecord{
+	public:
+		static const int max_args = 6; /*!< Arguments after max_args are ignored */
+		static const int text_size = 96; /*!< Bytes for string arguments (truncated if longer) */
+
+		enum ArgType{ARG_INT, ARG_UINT, ARG_DOUBLE, ARG_CHAR, ARG_BOOL, ARG_TEXT, ARG_POINTER};
+
+		/*!
+		 * @brief Captured argument
+		 */
+		struct Arg{
+			unsigned char type; //ArgType
+			union{
+				long long i;
+				unsigned long long u;
+				double d;
+				const void *p;
+				struct{unsigned short offset; unsigned short len;} text; //position in text[]
+			} value;
+		};
+
+		const char *format; /*!< Format string (string literal) */
+		unsigned char level; /*!< LogLevel */
+		unsigned char arg_num; /*!< # of captured arguments */
+		unsigned short text_len; /*!< Bytes used in text[] */
+		Arg args[max_args];
+		char text[text_size];
+
+		/*!
+		 * @brief Get slot for the next argument
+		 * @return argument, NULL if max_args arguments are already captured
+		 */
+		Arg *next(){
+			return (arg_num < max_args) ? &args[arg_num++] : NULL;
+		}
+
+		/*!
+		 * @brief Copy string argument into text[]
+		 * @param s string
+		 * @param len length of the string
+		 */
+		void addText(const char *s, std::size_t len){
+			Arg *arg = next();
+			if(arg == NULL){
+				return;
+			}
+			if(len > (std::size_t)(text_size - text_len)){
+				len = text_size - text_len;
+			}
+			std::memcpy(text + text_len, s, len);
+			arg->type = ARG_TEXT;
+			arg->value.text.offset = text_len;
+			arg->value.text.len = (unsigned short)len;
+			text_len = (unsigned short)(text_len + len);
+		}
+	};
+
+	inline void captureLogArg(LogRecord &rec, long long v){LogRecord::Arg *a = rec.next(); if(a){a->type = LogRecord::ARG_INT; a->value.i = v;}}
+	inline void captureLogArg(LogRecord &rec, unsigned long long v){LogRecord::Arg *a = rec.next(); if(a){a->type = LogRecord::ARG_UINT; a->value.u = v;}}
+	inline void captureLogArg(LogRecord &rec, double v){LogRecord::Arg *a = rec.next(); if(a){a->type = LogRecord::ARG_DOUBLE; a->value.d = v;}}
+	inline void captureLogArg(LogRecord &rec, char v){LogRecord::Arg *a = rec.next(); if(a){a->type = LogRecord::ARG_CHAR; a->value.i = v;}}
+	inline void captureLogArg(LogRecord &rec, bool v){LogRecord::Arg *a = rec.next(); if(a){a->type = LogRecord::ARG_BOOL; a->value.i = v;}}
+	inline void captureLogArg(LogRecord &rec, const void *v){LogRecord::Arg *a = rec.next(); if(a){a->type = LogRecord::ARG_POINTER; a->value.p = v;}}
+	inline void captureLogArg(LogRecord &rec, short v){captureLogArg(rec, (long long)v);}
+	inline void captureLogArg(LogRecord &rec, int v){captureLogArg(rec, (long long)v);}
+	inline void captureLogArg(LogRecord &rec, long v){captureLogArg(rec, (long long)v);}
+	inline void captureLogArg(LogRecord &rec, unsigned char v){captureLogArg(rec, (unsigned long long)v);}
+	inline void captureLogArg(LogRecord &rec, unsigned short v){captureLogArg(rec, (unsigned long long)v);}
+	inline void captureLogArg(LogRecord &rec, unsigned int v){captureLogArg(rec, (unsigned long long)v);}
+	inline void captureLogArg(LogRecord &rec, unsigned long v){captureLogArg(rec, (unsigned long long)v);}
+	inline void captureLogArg(LogRecord &rec, float v){captureLogArg(rec, (double)v);}
+	inline void captureLogArg(LogRecord &rec, const char *v){rec.addText(v ? v : "(null)", v ? std::strlen(v) : 6);}
+	inline void captureLogArg(LogRecord &rec, const std::string &v){rec.addText(v.c_str(), v.size());}
+	inline void captureLogArg(LogRecord &rec, const LogBytes &v){rec.addText(v.data, v.len);}
+
+	inline void captureLogArgs(LogRecord &){}
+
+	template <class T, class... Rest>
+	void captureLogArgs(LogRecord &rec, const T &first, const Rest&... rest){
+		captureLogArg(rec, first);
+		captureLogArgs(rec, rest...);
+	}
+
+	/*!
+	 * @brief Storage of the current log level (template so that the header needs no source file)
+	 */
+	template <class T>
+	struct LogLevelHolder{
+		static std::atomic<int> level;
+	};
+	template <class T>
+	std::atomic<int> LogLevelHolder<T>::level(LOG_INFO);
+
+	/*!
+	 * @class AsyncLogger
+	 * @brief Logger shared by the threads of the process. Any thread may write records
+	 * (multi-producer lock-free ring); the drain thread, started by the first record, formats and prints them
+	 */
+	class AsyncLogger{
+	public:
+		static const std::size_t capacity = 1024; /*!< # of records in the ring (power of 2) */
+
+	private:
+		/*!
+		 * @brief Slot of the ring. seq tells whether the slot is free for the writer of position seq
+		 * or filled for the reader of position seq-1
+		 */
+		struct Cell{
+			std::atomic<std::size_t> seq;
+			LogRecord record;
+		};
+
+		Cell cells[capacity];
+		std::atomic<std::size_t> write_pos; //next position to be reserved by a writer
+		char pad[64]; //keep writers and reader on different cache lines
+		std::size_t read_pos; //next position to be read (drain thread only)
+		std::atomic<unsigned long> dropped; //# of records discarded because the ring was full
+
+		std::mutex thread_mutex;
+		std::thread drain_thread;
+		std::atomic<bool> running;
+
+		//wakeup of the drain thread
+		std::mutex wake_mutex;
+		std::condition_variable wake_cond;
+		std::atomic<bool> sleeping; //drain thread is (about to start) waiting on wake_cond
+
+		AsyncLogger() : write_pos(0), read_pos(0), dropped(0), running(false), sleeping(false){
+			for(std::size_t i=0;i<capacity;i++){
+				cells[i].seq.store(i, std::memory_order_relaxed);
+			}
+		}
+		~AsyncLogger(){
+			stop();
+		}
+		AsyncLogger(const AsyncLogger &);
+		AsyncLogger &operator=(const AsyncLogger &);
+
+		/*!
+		 * @brief Reserve a slot, fill it and publish it to the drain thread
+		 * @param level Log level
+		 * @param format Format string
+		 * @param args Arguments
+		 */
+		template <class... Args>
+		void push(LogLevel level, const char *format, const Args&... args){
+			std::size_t pos = write_pos.load(std::memory_order_relaxed);
+			Cell *cell;
+			for(;;){
+				cell = &cells[pos & (capacity-1)];
+				std::size_t seq = cell->seq.load(std::memory_order_acquire);
+				std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+				if(diff == 0){
+					if(write_pos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed)){
+						break;
+					}
+				}else if(diff < 0){ //full
+					dropped.fetch_add(1, std::memory_order_relaxed);
+					return;
+				}else{
+					pos = write_pos.load(std::memory_order_relaxed);
+				}
+			}
+
+			LogRecord &rec = cell->record;
+			rec.format = format;
+			rec.level = (unsigned char)level;
+			rec.arg_num = 0;
+			rec.text_len = 0;
+			captureLogArgs(rec, args...);
+			cell->seq.store(pos+1, std::memory_order_seq_cst);
+
+			if(sleeping.load(std::memory_order_seq_cst)){
+				wake();
+			}
+		}
+
+		/*!
+		 * @brief Wake up the drain thread
+		 */
+		void wake(){
+			std::lock_guard<std::mutex> lock(wake_mutex);
+			wake_cond.notify_one();
+		}
+
+		/*!
+		 * @brief Check if the oldest record is ready to be taken out (drain thread only)
+		 * @return true if pop() will succeed
+		 */
+		bool ready() const{
+			return cells[read_pos & (capacity-1)].seq.load(std::memory_order_seq_cst) == read_pos+1;
+		}
+
+		/*!
+		 * @brief Take out the oldest record (drain thread only)
+		 * @param rec Destination
+		 * @return true if a record was taken out
+		 */
+		bool pop(LogRecord &rec){
+			Cell *cell = &cells[read_pos & (capacity-1)];
+			if(cell->seq.load(std::memory_order_acquire) != read_pos+1){
+				return false;
+			}
+			rec = cell->record;
+			cell->seq.store(read_pos+capacity, std::memory_order_release);
+			read_pos++;
+			return true;
+		}
+
+		/*!
+		 * @brief Format a record
+		 * @param rec Record
+		 * @param line Destination
+		 */
+		static void format(const LogRecord &rec, std::string &line){
+			static const char *level_name[] = {"", "ERROR", "WARN", "INFO", "DEBUG"};
+			char num[32];
+			int arg = 0;
+
+			line.assign("[");
+			line.append(level_name[rec.level < 5 ? rec.level : 0]);
+			line.append("] ");
+			for(const char *p=rec.format;*p!='\0';p++){
+				if(p[0] != '{' || p[1] != '}' || arg >= rec.arg_num){
+					line.push_back(*p);
+					continue;
+				}
+				const LogRecord::Arg &a = rec.args[arg++];
+				p++;
+				switch(a.type){
+					case LogRecord::ARG_INT:
+						std::snprintf(num, sizeof(num), "%lld", a.value.i);
+						line.append(num);
+						break;
+					case LogRecord::ARG_UINT:
+						std::snprintf(num, sizeof(num), "%llu", a.value.u);
+						line.append(num);
+						break;
+					case LogRecord::ARG_DOUBLE:
+						std::snprintf(num, sizeof(num), "%g", a.value.d);
+						line.append(num);
+						break;
+					case LogRecord::ARG_CHAR:
+						line.push_back((char)a.value.i);
+						break;
+					case LogRecord::ARG_BOOL:
+						line.append(a.value.i ? "true" : "false");
+						break;
+					case LogRecord::ARG_TEXT:
+						line.append(rec.text + a.value.text.offset, a.value.text.len);
+						break;
+					default:
+						std::snprintf(num, sizeof(num), "%p", a.value.p);
+						line.append(num);
+						break;
+				}
+			}
+			line.push_back('\n');
+		}
+
+		/*!
+		 * @brief Write all records in the ring
+		 * @return # of records written
+		 */
+		std::size_t drain(){
+			LogRecord rec;
+			std::string line;
+			std::size_t n = 0;
+
+			while(pop(rec)){
+				format(rec, line);
+				if(rec.level <= LOG_WARN){
+					std::cerr << line;
+				}else{
+					std::cout << line;
+				}
+				n++;
+			}
+			unsigned long lost = dropped.exchange(0, std::memory_order_relaxed);
+			if(lost > 0){
+				std::cerr << "[WARN] " << lost << " log records dropped (log ring full)" << std::endl;
+			}
+			if(n > 0){
+				std::cout.flush();
+			}
+			return n;
+		}
+
+		/*!
+		 * @brief Main loop of the drain thread
+		 */
+		void drainMain(){
+			while(running.load(std::memory_order_acquire)){
+				if(drain() > 0){
+					continue;
+				}
+				//sleep until a writer or stop() wakes us up. sleeping is set before the ring is
+				//checked again, so a record published in between is either seen here or wakes us
+				std::unique_lock<std::mutex> lock(wake_mutex);
+				sleeping.store(true, std::memory_order_seq_cst);
+				if(!ready() && running.load(std::memory_order_acquire)){
+					wake_cond.wait(lock);
+				}
+				sleeping.store(false, std::memory_order_relaxed);
+			}
+			drain();
+		}
+
+		/*!
+		 * @brief Start the drain thread if not started
+		 */
+		void start(){
+			std::lock_guard<std::mutex> lock(thread_mutex);
+			if(!drain_thread.joinable()){
+				running.store(true, std::memory_order_release);
+				drain_thread = std::thread(&AsyncLogger::drainMain, this);
+			}
+		}
+
+	public:
+		/*!
+		 * @brief Get the logger of the process
+		 * @return logger
+		 */
+		static AsyncLogger &instance(){
+			static AsyncLogger logger;
+			return logger;
+		}
+
+		/*!
+		 * @brief Check if messages of the level are written (cheap enough for the hot path)
+		 * @param level Log level
+		 * @return true if enabled
+		 */
+		static bool enabled(LogLevel level){
+			return (int)level <= LogLevelHolder<void>::level.load(std::memory_order_relaxed);
+		}
+
+		/*!
+		 * @brief Set current log level
+		 * @param level Log level (LOG_OFF: no log)
+		 */
+		static void setLevel(LogLevel level){
+			LogLevelHolder<void>::level.store(level, std::memory_order_relaxed);
+		}
+
+		/*!
+		 * @brief Write a message (use HMLOG_* macros to skip argument evaluation when disabled)
+		 * @param level Log level
+		 * @param format Format string (string literal; "{}" is replaced by the arguments in order)
+		 * @param args Arguments (integers, real numbers, char, bool, strings, LogBytes, pointers)
+		 */
+		template <class... Args>
+		void log(LogLevel level, const char *format, const Args&... args){
+			if(!running.load(std::memory_order_acquire)){
+				start();
+			}
+			push(level, format, args...);
+		}
+
+		/*!
+		 * @brief Stop the drain thread after writing all records (restarted by the next record)
+		 */
+		void stop(){
+			std::lock_guard<std::mutex> lock(thread_mutex);
+			if(drain_thread.joinable()){
+				running.store(false, std::memory_order_release);
+				wake();
+				drain_thread.join();
+			}
+		}
+	};
+
+};
+
+/*!
+ * @name log macros
+ * Arguments are not evaluated when the level is disabled
+ */
+/* @{ */
+#define HMLOG(level, ...) do{ if(::hotmock::AsyncLogger::enabled(level)){ ::hotmock::AsyncLogger::instance().log(level, __VA_ARGS__); } }while(0)
+#define HMLOG_ERROR(...) HMLOG(::hotmock::LOG_ERROR, __VA_ARGS__)
+#define HMLOG_WARN(...) HMLOG(::hotmock::LOG_WARN, __VA_ARGS__)
+#define HMLOG_INFO(...) HMLOG(::hotmock::LOG_INFO, __VA_ARGS__)
+#define HMLOG_DEBUG(...) HMLOG(::hotmock::LOG_DEBUG, __VA_ARGS__)
+/* @} */
+
+#endif